@@ -2,19 +2,25 @@
 #include <iostream>
 
 #include "src/algs/af_dome_corr_bp.h"
+#include "src/algs/ffbp_corr_bp.h"
 #include "src/algs/mstar_aggregator.h"
 #include "src/algs/sample_corr_bp.h"
+#include "src/algs/target_cp_omega_k.h"
+#include "src/utils/fft_utils.h"
 #include "src/utils/string_utils.h"
+#include "src/utils/work_queue.h"
 
 using namespace std;
 using namespace arma;
 
 int main(int argc, char* argv[])
 {
+    // "queue" shares the inputs between any number of workers through a work queue; otherwise argv gives a static partition.
+    const bool queued = argc > 1 && std::string(argv[1]) == "queue";
     int partition = 0;
     int partitionCount = 1;
 
-    if (argc > 1)
+    if (argc > 1 && !queued)
     {
         partition = std::stoi(argv[1]);
         partitionCount = std::stoi(argv[2]);
@@ -50,8 +56,27 @@ int main(int argc, char* argv[])
         to = count;
     }
 
-    //ph_mstar_corr_bp::generic_run(inputPaths, "output/mstar", from, to);
-    sample_corr_bp::generic_run(inputPaths, "output/sample", from, to);
-    // target_cp_corr_bp::generic_run(inputPaths, "output/tcp", from, to);
+    // Plans measured by earlier runs are reused, and any new ones are kept for the next run.
+    const std::string wisdomPath = dataPath + "fftw.wisdom";
+    fft_plan_cache::instance().load_wisdom(wisdomPath);
+
+    // The imager both modes run, and where its images go.
+    //using driver = ph_mstar_corr_bp; const std::string savePath = "output/mstar";
+    using driver = sample_corr_bp; const std::string savePath = "output/sample";
+    // using driver = ffbp_corr_bp; const std::string savePath = "output/ffbp";
+    // using driver = target_cp_corr_bp; const std::string savePath = "output/tcp";
+    // using driver = target_cp_omega_k; const std::string savePath = "output/tcp_omega_k";
+
+    if (queued)
+    {
+        // One pipelined run takes the queued inputs a few at a time, so loading and saving still overlap image formation.
+        work_queue queue(dataPath + "DataPaths.queue", inputPaths);
+        driver::generic_run(inputPaths, savePath, queue);
+    }
+    else
+    {
+        driver::generic_run(inputPaths, savePath, from, to);
+    }
+    fft_plan_cache::instance().save_wisdom(wisdomPath);
     return 0;
 }
\ No newline at end of file
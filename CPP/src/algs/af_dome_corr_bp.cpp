@@ -4,37 +4,46 @@
 #include <filesystem>
 #include <iostream>
 
+#include "back_projection_core.h"
 #include "../constants.h"
 #include "../polarization_types.h"
+#include "../utils/correlation_utils.h"
 #include "../utils/io_utils.h"
 #include "../utils/matrix_math.h"
+#include "../utils/phase_utils.h"
 #include "../utils/stopwatch.h"
 
 int af_dome_corr_bp::load()
 {
-    const std::string& dataPath = this->dataPath;
-    load_data(azim, dataPath, "azim");
-    load_data(polarized_phase, dataPath, polarizationToString(polarization));
-    load_data(frequencyGHz, dataPath, "fghz");
+    hdf5_reader reader(dataPath);
+    reader.read(azim, "azim");
+
+    // Only the pulses inside the azimuth bounds are read; a window through 0 degrees is two hyperslabs.
+    const arma::uvec azimuthSelector = azimuth_selector();
+    azim = azim.elem(azimuthSelector);
+    reader.read_selection(polarized_phase, polarizationToString(polarization), azimuthSelector);
+    reader.read(frequencyGHz, "fghz");
     arma::mat elevationData;
-    load_data(elevationData, dataPath, "elev");
+    reader.read(elevationData, "elev");
     elevation = arma::mat(polarized_phase.n_cols, 1, arma::fill::value(elevationData(0)));
     return 0;
 }
 
 int af_dome_corr_bp::get_image_data()
 {
-    stopwatch timer = stopwatch();
-    int numSamples = numXSamples * numYSamples;
-    arma::uvec azimuthSelector;
-    if (minAzimuth > maxAzimuth)
-    {
-        azimuthSelector = arma::find((azim >= minAzimuth) || (azim <= maxAzimuth));
-    }
-    else
+    if (precision == precision_types::SINGLE)
     {
-        azimuthSelector = arma::find((azim >= minAzimuth) % (azim <= maxAzimuth));
+        return compute_image_data<float>();
     }
+    return compute_image_data<double>();
+}
+
+template <typename T>
+int af_dome_corr_bp::compute_image_data()
+{
+    stopwatch timer = stopwatch();
+    int numSamples = numXSamples * numYSamples;
+    const arma::uvec azimuthSelector = azimuth_selector();
     const arma::vec& validAzimuth = azim.elem(azimuthSelector);
     const arma::cx_mat& validPolarized = polarized_phase.cols(azimuthSelector).eval();
     unsigned long numPulse = validPolarized.n_cols;
@@ -50,47 +59,73 @@ int af_dome_corr_bp::get_image_data()
     double deltaFrequency = arma::diff(frequencyGHz.rows(0, 1)).eval()[0] * 1e9;
 
     double maxWr = c / (2 * deltaFrequency);
-    const arma::mat& range = arma::linspace(-numFftSamp / 2.0, numFftSamp / 2.0 - 1, numFftSamp) * maxWr / numFftSamp;
-    double rangeMin = arma::min(range).eval()[0];
-    double rangeMax =  arma::max(range).eval()[0];
+    const arma::Col<T> range = arma::conv_to<arma::Col<T>>::from(
+        arma::linspace(-numFftSamp / 2.0, numFftSamp / 2.0 - 1, numFftSamp) * maxWr / numFftSamp);
 
     double minimumFrequency = arma::min(frequencyGHz).eval()[0] * 1e9;
-    arma::cx_double phaseCorrConstant(0.0, 4.0 * minimumFrequency * pi / c);
+    const double wavenumber = 4.0 * minimumFrequency * pi / c;
 
-    arma::cx_mat tmp(numPulse, numSamples);
-
-#pragma omp parallel for
-    for (int i = 0; i < numPulse; i++)
+    // Every requested lag must exist in a convolution of two numPulse-long series.
+    const long long fftLength = numPulse * 2 - 1;
+    if (!lags.is_empty() && arma::max(lags) >= fftLength)
     {
-        double azimuthValue = validAzimuth(i) * radian;
-        const arma::mat& dRData = (xGrid * cosElevation(i)* cos(azimuthValue) + yGrid * cosElevation(i) * sin(azimuthValue)).t();
-        const arma::vec& validDRData = dRData.elem(arma::find((dRData > rangeMin) % (dRData < rangeMax)));
-        arma::cx_vec timeData = cx_fftshift(arma::ifft(validPolarized.col(i), numFftSamp));
-
-        // The dual linear interpolations are currently the biggest bottleneck, representing ~60% of execution time.
-        arma::vec interpResultsReal;
-        arma::vec interpResultsImag;
-        arma::interp1(range, arma::real(timeData), validDRData, interpResultsReal);
-        arma::interp1(range, arma::imag(timeData), validDRData, interpResultsImag);
-
-        // Transposing accumulates to ~9% of the execution time here.
-        // Ideally, this could be avoided if Armadillo didn't make the distinction between row and column vectors.
-        tmp.row(i) = arma::trans(arma::cx_vec(interpResultsReal, interpResultsImag) % arma::exp(phaseCorrConstant * validDRData));
+        std::cout << "[Error] af_dome_corr_bp requested lag " << arma::max(lags) << " but only " << fftLength << " lags exist." << std::endl;
+        return -1;
     }
 
-    long long fftLength = numPulse * 2 - 1;;
-    long long fftPaddedLength = pow(2, ceil(log2(fftLength)));
-    arma::mat convResults(fftLength, numSamples);
-
-#pragma omp parallel for
-    for (int j = 0; j < numSamples; j++)
+    // Lag k pairs pulses m and k - m, so only the pulses some requested lag pairs are formed and kept; the full sum needs them all.
+    const unsigned long long lastPulse = lags.is_empty() ? numPulse - 1 : std::min<unsigned long long>(arma::max(lags), numPulse - 1);
+    const unsigned long long firstPulse = lags.is_empty() ? 0 : std::max<long long>(0, static_cast<long long>(arma::min(lags)) - static_cast<long long>(numPulse - 1));
+    const unsigned long long keptPulses = lastPulse - firstPulse + 1;
+    const arma::Mat<std::complex<T>> rangeProfiles = range_compress<T>(validPolarized.cols(firstPulse, lastPulse).eval(), numFftSamp);
+
+    // The pixel grid is a transposed mesh grid, so the range is affine down every column of dRData.
+    const arma::mat xGridT = xGrid.t();
+    const arma::mat yGridT = yGrid.t();
+    const phase_corrector phaseCorrector(phaseCorrectionMode, wavenumber, xGridT.n_rows,
+        column_affine_residual(xGridT) + column_affine_residual(yGridT),
+        arma::max(arma::max(arma::abs(xGridT) + arma::abs(yGridT))), phaseTolerance, std::numeric_limits<T>::epsilon());
+
+    const arma::vec azimuthValues = validAzimuth.subvec(firstPulse, lastPulse) * radian;
+    const arma::vec cosElevationValues = arma::vectorise(cosElevation).subvec(firstPulse, lastPulse);
+    arma::mat look(3, keptPulses, arma::fill::zeros);
+    look.row(0) = (cosElevationValues % arma::cos(azimuthValues)).t();
+    look.row(1) = (cosElevationValues % arma::sin(azimuthValues)).t();
+    const arma::vec wavenumbers = arma::ones<arma::vec>(keptPulses) * wavenumber;
+    const planar_geometry<T, false> geometry(xGridT, yGridT, arma::mat(), look);
+    const back_projection_core<T, planar_geometry<T, false>> core(geometry, range, rangeProfiles, phaseCorrector, wavenumbers);
+
+    // Without explicit lags, the full sum is |sum(x)|^2 - |x(0)|^2 and is accumulated as the pulses stream.
+    if (lags.is_empty())
     {
-        const arma::cx_vec& tmpCol = tmp.col(j);
-        const arma::cx_vec& tmpColConj = conj(tmpCol);
-        convResults.col(j) = ffftconv(tmpCol, tmpColConj, fftPaddedLength).subvec(0, fftLength - 1);
+        streaming_accumulation accumulator(numSamples);
+        core.run(accumulator);
+        arma::uvec index;
+        const arma::Col<std::complex<T>> leadingValues = core.pulse_values(0, index);
+        arma::vec leadingEnergy(numSamples, arma::fill::zeros);
+        leadingEnergy.elem(index) = arma::conv_to<arma::vec>::from(arma::square(arma::abs(leadingValues)));
+        imageData = arma::reshape(arma::square(arma::abs(accumulator.total.sum)) - leadingEnergy, numXSamples, numYSamples);
+        complexImageData = arma::reshape(accumulator.total.sum, numXSamples, numYSamples);
+        lagImageData.reset();
+    }
+    else
+    {
+        // correlation_lags works in double, so the buffer is kept in double whatever the precision of the pulses.
+        buffered_accumulation<> accumulator(keptPulses, numSamples);
+        core.run(accumulator);
+
+        // Pulses have always been stored conjugated, as they were written through a conjugating transpose. The lags are
+        // real parts of products of one pulse with the conjugate of another, which conjugating both leaves unchanged, so
+        // the buffer is correlated as it is. Its lag k - 2 * firstPulse is lag k of the whole series.
+        const arma::mat lagData = correlation_lags(accumulator.buffer, lags - 2 * firstPulse);
+        complexImageData.reset();
+        lagImageData = arma::cube(numXSamples, numYSamples, lags.n_elem);
+        for (int k = 0; k < lags.n_elem; k++)
+        {
+            lagImageData.slice(k) = arma::reshape(lagData.row(k), numXSamples, numYSamples);
+        }
+        imageData = arma::reshape(arma::sum(lagData, 0), numXSamples, numYSamples);
     }
-
-    imageData = arma::reshape(arma::sum(convResults, 0) - convResults.row(0), numXSamples, numYSamples);
     std::cout << "Successfully generated image data: " << timer.elapsed_milliseconds() << " ms elapsed" << std::endl;
     return 0;
 }
@@ -100,6 +135,8 @@ int af_dome_corr_bp::get_image_data()
 int af_dome_corr_bp::clear()
 {
     polarized_phase.clear();
+    lagImageData.clear();
+    complexImageData.clear();
     azim.clear();
     elevation.clear();
     frequencyGHz.clear();
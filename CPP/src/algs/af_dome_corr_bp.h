@@ -15,17 +15,17 @@ class af_dome_corr_bp : public base_correlated_back_projection
 
         int numFftSamp;
 
-        float centerX;
+        double centerX;
 
-        float centerY;
+        double centerY;
 
-        float sceneWidth;
+        double sceneWidth;
 
-        float sceneHeight;
+        double sceneHeight;
 
-        float minAzimuth;
+        double minAzimuth;
 
-        float maxAzimuth;
+        double maxAzimuth;
 
         polarization_types polarization;
 
@@ -37,10 +37,19 @@ class af_dome_corr_bp : public base_correlated_back_projection
 
         arma::mat frequencyGHz;
 
+        // Lags of each pixel's pulse convolution to keep. Empty selects the full sum over every lag.
+        arma::uvec lags;
+
+        // One slice per requested lag, in the order of lags. Left empty for the full sum.
+        arma::cube lagImageData;
+
+        // The complex image sum(x), in the same layout as imageData. Formed for the full sum only.
+        arma::cx_mat complexImageData;
+
         af_dome_corr_bp(const std::string &dataPath, const polarization_types polarization,
-            const float sceneWidth, const float sceneHeight,
+            const double sceneWidth, const double sceneHeight,
             const int numFftSamp, const int numXSamp, const int numYSamp,
-            const float centerX, const float centerY, const bool correlated = true)
+            const double centerX, const double centerY, const bool correlated = true)
         {
             this->dataPath = dataPath;
             this->polarization = polarization;
@@ -62,11 +71,41 @@ class af_dome_corr_bp : public base_correlated_back_projection
 
         int clear() override;
 
+        // Set before load(), which reads only the pulses inside the bounds.
         void set_azimuth_bounds(const int min, const int max)
         {
             minAzimuth = min;
             maxAzimuth = max;
         }
+
+        // Pulses inside the azimuth bounds, which wrap through 0 when minAzimuth > maxAzimuth.
+        arma::uvec azimuth_selector() const
+        {
+            if (minAzimuth > maxAzimuth)
+            {
+                return arma::find((azim >= minAzimuth) || (azim <= maxAzimuth));
+            }
+            return arma::find((azim >= minAzimuth) % (azim <= maxAzimuth));
+        }
+
+        void set_lags(const arma::uvec& lags)
+        {
+            this->lags = lags;
+        }
+
+        void set_lag_window(const unsigned long first, const unsigned long last)
+        {
+            lags = arma::regspace<arma::uvec>(first, last);
+        }
+
+        void set_full_sum()
+        {
+            lags.reset();
+        }
+
+    private:
+        template <typename T>
+        int compute_image_data();
 };
 
 
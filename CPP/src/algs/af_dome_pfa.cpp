@@ -0,0 +1,193 @@
+#include "af_dome_pfa.h"
+
+#include <armadillo>
+#include <cmath>
+#include <iostream>
+
+#include "../constants.h"
+#include "../utils/fft_utils.h"
+#include "../utils/matrix_math.h"
+#include "../utils/stopwatch.h"
+
+/*-------------------------------------------------------------------------
+ * Sizes one axis of the rectangular spectrum. The pixels are every
+ * decimation-th sample of an FFT image of fftLength samples, decimation
+ * being the smallest that keeps the spectrum [kLow, kHigh] unaliased, and
+ * fftLength making the image period at least guard times the scene.
+ *------------------------------------------------------------------------*/
+static void plan_axis(const double pixelStep, const int samples, const double kLow, const double kHigh, const double guard,
+    long long& decimation, long long& fftLength, double& kStep, long long& kSamples)
+{
+    decimation = std::max(1LL, static_cast<long long>(std::ceil((kHigh - kLow) * pixelStep / (2 * pi))));
+    fftLength = std::max(2LL, static_cast<long long>(std::ceil(guard * (samples - 1) * decimation)) + 1);
+    fftLength += fftLength % 2;
+    kStep = 2 * pi * decimation / (static_cast<double>(fftLength) * pixelStep);
+    kSamples = std::min(fftLength, static_cast<long long>(std::floor((kHigh - kLow) / kStep)) + 1);
+}
+
+int af_dome_pfa::get_image_data()
+{
+    stopwatch timer = stopwatch();
+    const arma::uvec azimuthSelector = azimuth_selector();
+    const arma::vec validAzimuth = azim.elem(azimuthSelector) * radian;
+    const arma::cx_mat validPolarized = polarized_phase.cols(azimuthSelector);
+    const long long numPulse = validPolarized.n_cols;
+    const long long numFreq = validPolarized.n_rows;
+    if (numPulse < 2 || numFreq < 2)
+    {
+        std::cout << "[Error] af_dome_pfa needs at least two pulses and two frequencies." << std::endl;
+        return -1;
+    }
+
+    // Pulses are ordered by their angle from the aperture centre, which also handles bounds wrapping through 0.
+    const double centreAzimuth = std::atan2(arma::accu(arma::sin(validAzimuth)), arma::accu(arma::cos(validAzimuth)));
+    const arma::vec relativeAzimuth = arma::atan2(arma::sin(validAzimuth - centreAzimuth), arma::cos(validAzimuth - centreAzimuth));
+    const arma::uvec order = arma::sort_index(relativeAzimuth);
+    const double azimuthStep = (relativeAzimuth.max() - relativeAzimuth.min()) / static_cast<double>(numPulse - 1);
+
+    // The keystone pass runs along whichever of x and y the aperture faces.
+    const bool primaryX = std::abs(std::cos(centreAzimuth)) >= std::abs(std::sin(centreAzimuth));
+    const double cosElevation = std::cos(elevation(0) * radian);
+    arma::vec primary(numPulse);
+    arma::vec secondary(numPulse);
+    for (long long m = 0; m < numPulse; m++)
+    {
+        const double azimuthValue = validAzimuth(order(m));
+        primary(m) = cosElevation * (primaryX ? std::cos(azimuthValue) : std::sin(azimuthValue));
+        secondary(m) = cosElevation * (primaryX ? std::sin(azimuthValue) : std::cos(azimuthValue));
+    }
+
+    if (arma::any(arma::abs(secondary) >= arma::abs(primary)) || (arma::any(primary > 0) && arma::any(primary < 0)))
+    {
+        std::cout << "[Error] af_dome_pfa needs an aperture within 45 degrees of the x or y axis; use af_dome_corr_bp for wider apertures." << std::endl;
+        return -1;
+    }
+
+    const arma::vec wavenumber = arma::vectorise(frequencyGHz).head(numFreq) * 1e9 * 4.0 * pi / c;
+    const double wavenumberStep = (wavenumber(numFreq - 1) - wavenumber(0)) / static_cast<double>(numFreq - 1);
+    const double wavenumberMin = arma::min(wavenumber);
+    const double wavenumberMax = arma::max(wavenumber);
+    const arma::vec primaryBounds = arma::join_cols(primary * wavenumberMin, primary * wavenumberMax);
+    const arma::vec secondaryBounds = arma::join_cols(secondary * wavenumberMin, secondary * wavenumberMax);
+
+    const int primarySamples = primaryX ? numXSamples : numYSamples;
+    const int secondarySamples = primaryX ? numYSamples : numXSamples;
+    const double primaryWidth = primaryX ? sceneWidth : sceneHeight;
+    const double secondaryWidth = primaryX ? sceneHeight : sceneWidth;
+    const double primaryStart = (primaryX ? centerX : centerY) - primaryWidth / 2;
+    const double secondaryStart = (primaryX ? centerY : centerX) - secondaryWidth / 2;
+    const double primaryStep = primarySamples > 1 ? primaryWidth / (primarySamples - 1) : primaryWidth;
+    const double secondaryStep = secondarySamples > 1 ? secondaryWidth / (secondarySamples - 1) : secondaryWidth;
+    const double primaryLow = primaryBounds.min();
+    const double secondaryLow = secondaryBounds.min();
+
+    long long primaryDecimation, primaryLength, primaryCount, secondaryDecimation, secondaryLength, secondaryCount;
+    double primaryKStep, secondaryKStep;
+    plan_axis(primaryStep, primarySamples, primaryLow, primaryBounds.max(), sceneGuard,
+        primaryDecimation, primaryLength, primaryKStep, primaryCount);
+    plan_axis(secondaryStep, secondarySamples, secondaryLow, secondaryBounds.max(), sceneGuard,
+        secondaryDecimation, secondaryLength, secondaryKStep, secondaryCount);
+
+    /*----- Keystone pass: every pulse onto the common grid of primary spatial frequency -----*/
+    const arma::vec primaryGrid = primaryLow + arma::regspace(0, primaryCount - 1) * primaryKStep;
+    arma::cx_mat keystone(primaryCount, numPulse);
+#pragma omp parallel for
+    for (long long m = 0; m < numPulse; m++)
+    {
+        const arma::vec query = primaryGrid / primary(m);
+        arma::cx_vec resampled = interp1_uniform(wavenumber, arma::cx_vec(validPolarized.col(order(m))), query);
+        resampled.elem(arma::find((query < wavenumberMin) + (query > wavenumberMax))).zeros();
+        keystone.col(m) = resampled;
+    }
+
+    /*----- Azimuth pass: each primary frequency onto the grid of secondary spatial frequency -----*/
+    // The 2-D inverse FFT below is unscaled; the weight turns the sum over the rectangular grid into the sum over polar samples.
+    const arma::vec secondaryGrid = secondaryLow + arma::regspace(0, secondaryCount - 1) * secondaryKStep;
+    const arma::vec slope = secondary / primary;
+    const double cellArea = primaryKStep * secondaryKStep / (cosElevation * wavenumberStep * azimuthStep * numFftSamp);
+    // Between neighbouring pulses the secondary frequency is linear in the fractional pulse index, so one real
+    // interpolation finds where each grid point falls among the pulses and the complex row is interpolated there once.
+    const arma::vec pulseIndex = arma::regspace(0, numPulse - 1);
+    arma::cx_mat spectrum(primaryLength, secondaryLength, arma::fill::zeros);
+#pragma omp parallel for
+    for (long long p = 0; p < primaryCount; p++)
+    {
+        arma::vec position = primaryGrid(p) * slope;
+        arma::vec positionIndex = pulseIndex;
+        if (position(0) > position(numPulse - 1))
+        {
+            position = arma::flipud(position);
+            positionIndex = arma::flipud(positionIndex);
+        }
+
+        arma::vec queryIndex;
+        arma::interp1(position, positionIndex, secondaryGrid, queryIndex, "*linear", -1.0);
+        const arma::cx_vec resampled = interp1_uniform(pulseIndex, arma::cx_vec(arma::strans(keystone.row(p))), queryIndex);
+        for (long long q = 0; q < secondaryCount; q++)
+        {
+            const double radius = std::hypot(primaryGrid(p), secondaryGrid(q));
+            const double shift = p * primaryKStep * primaryStart + q * secondaryKStep * secondaryStart;
+            spectrum(p, q) = resampled(q) * std::polar(cellArea / radius, shift);
+        }
+    }
+
+    /*----- Image formation: one 2-D inverse FFT, then the pixels are picked out of it -----*/
+    fft_plan_cache::instance().execute_many(spectrum.memptr(), spectrum.memptr(), primaryLength, secondaryLength, FFTW_BACKWARD);
+    arma::cx_mat transformed = arma::strans(spectrum);
+    spectrum.reset();
+    fft_plan_cache::instance().execute_many(transformed.memptr(), transformed.memptr(), secondaryLength, primaryLength, FFTW_BACKWARD);
+
+    const arma::uvec secondaryPixels = arma::regspace<arma::uvec>(0, secondarySamples - 1) * secondaryDecimation;
+    const arma::uvec primaryPixels = arma::regspace<arma::uvec>(0, primarySamples - 1) * primaryDecimation;
+    arma::cx_mat image = arma::strans(transformed.submat(secondaryPixels, primaryPixels));
+    const arma::vec primaryPosition = primaryStart + arma::regspace(0, primarySamples - 1) * primaryStep;
+    const arma::vec secondaryPosition = secondaryStart + arma::regspace(0, secondarySamples - 1) * secondaryStep;
+    for (long long b = 0; b < secondarySamples; b++)
+    {
+        for (long long a = 0; a < primarySamples; a++)
+        {
+            image(a, b) = std::conj(image(a, b) * std::polar(1.0, primaryLow * primaryPosition(a) + secondaryLow * secondaryPosition(b)));
+        }
+    }
+
+    // Pixels are laid out as in af_dome_corr_bp: the x by y image, transposed, then reshaped to x by y.
+    const arma::cx_mat imageXY = primaryX ? image : arma::strans(image);
+    complexImageData = arma::reshape(arma::strans(imageXY), numXSamples, numYSamples);
+    imageData = arma::square(arma::abs(complexImageData));
+    std::cout << "Successfully generated image data: " << timer.elapsed_milliseconds() << " ms elapsed" << std::endl;
+    return 0;
+}
+
+af_dome_pfa::back_projection_comparison af_dome_pfa::compare_with_back_projection(const af_dome_pfa& loaded)
+{
+    af_dome_pfa polar = loaded;
+    stopwatch timer;
+    const int polarStatus = polar.get_image_data();
+    const long long polarMilliseconds = timer.elapsed_milliseconds();
+
+    af_dome_corr_bp direct = loaded;
+    direct.set_full_sum();
+    timer.restart();
+    const int directStatus = direct.get_image_data();
+    const long long directMilliseconds = timer.elapsed_milliseconds();
+
+    if (polarStatus != 0 || directStatus != 0 || polar.complexImageData.n_elem != direct.complexImageData.n_elem
+        || direct.complexImageData.is_empty())
+    {
+        std::cout << "[Error] compare_with_back_projection failed for <" << loaded.dataPath << ">." << std::endl;
+        return {0, 0, false};
+    }
+
+    // The two imagers differ in phase convention, so the magnitudes are compared.
+    const arma::vec polarMagnitude = arma::abs(arma::vectorise(polar.complexImageData));
+    const arma::vec directMagnitude = arma::abs(arma::vectorise(direct.complexImageData));
+    back_projection_comparison comparison;
+    comparison.correlation = arma::dot(polarMagnitude, directMagnitude) / (arma::norm(polarMagnitude) * arma::norm(directMagnitude));
+    comparison.peakRatio = polarMagnitude.max() / directMagnitude.max();
+    comparison.peaksAgree = polarMagnitude.index_max() == directMagnitude.index_max();
+    std::cout << "[PFA] " << loaded.dataPath << std::endl;
+    std::cout << "    back-projection: " << directMilliseconds << " ms, polar format: " << polarMilliseconds << " ms" << std::endl;
+    std::cout << "    magnitude correlation: " << comparison.correlation << ", peak ratio: " << comparison.peakRatio
+        << ", peaks " << (comparison.peaksAgree ? "on the same pixel" : "on different pixels") << std::endl;
+    return comparison;
+}
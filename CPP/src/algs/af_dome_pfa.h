@@ -0,0 +1,60 @@
+#ifndef AF_DOME_PFA_H
+#define AF_DOME_PFA_H
+
+#include "af_dome_corr_bp.h"
+
+#include <armadillo>
+
+
+/*-------------------------------------------------------------------------
+ * Polar format imager over the af_dome_corr_bp inputs.
+ *
+ * With planar wavefronts each pulse samples the scene spectrum along a
+ * line through the origin, so the phase history lies on a polar grid in
+ * (kx, ky). It is resampled onto a rectangular grid in two separable
+ * passes: a keystone pass along frequency that puts every pulse on the
+ * same grid of the dominant spatial frequency, then a pass across pulses
+ * onto a grid of the other. A single 2-D inverse FFT then forms the
+ * image, which is sampled at the af_dome_corr_bp pixel grid.
+ *
+ * The selected aperture must lie within 45 degrees of the x or y axis.
+ * imageData is the power image |sum|^2, in the af_dome_corr_bp layout;
+ * per-pulse terms are not available to remove as the direct imager does.
+ * compare_with_back_projection checks the image against the direct one.
+ *------------------------------------------------------------------------*/
+class af_dome_pfa : public af_dome_corr_bp
+{
+    public:
+        // Period of the FFT image, as a multiple of the scene extent, so energy from outside the scene does not wrap into it.
+        double sceneGuard = 2;
+
+        // Agreement of the polar format image with the af_dome_corr_bp image of the same inputs.
+        struct back_projection_comparison
+        {
+            // Normalised correlation of the two magnitude images; 1 when they agree up to scale.
+            double correlation;
+
+            // Largest polar format magnitude over the largest back-projection magnitude.
+            double peakRatio;
+
+            bool peaksAgree;
+        };
+
+        af_dome_pfa(const std::string &dataPath, const polarization_types polarization,
+            const double sceneWidth, const double sceneHeight,
+            const int numFftSamp, const int numXSamp, const int numYSamp,
+            const double centerX, const double centerY, const bool correlated = true)
+            : af_dome_corr_bp(dataPath, polarization, sceneWidth, sceneHeight, numFftSamp, numXSamp, numYSamp, centerX, centerY, correlated)
+        {
+        }
+
+        int get_image_data() override;
+
+        // Images a loaded imager with the polar format and with af_dome_corr_bp's full sum, and prints the run times and
+        // how closely the magnitude images agree.
+        static back_projection_comparison compare_with_back_projection(const af_dome_pfa& loaded);
+};
+
+
+
+#endif //AF_DOME_PFA_H
@@ -0,0 +1,410 @@
+#ifndef BACK_PROJECTION_CORE_H
+#define BACK_PROJECTION_CORE_H
+
+#include <algorithm>
+#include <armadillo>
+#include <complex>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <omp.h>
+#include <vector>
+
+#include "../utils/correlation_utils.h"
+#include "../utils/matrix_math.h"
+#include "../utils/phase_utils.h"
+#include "../utils/work_stealing_queue.h"
+
+/*-------------------------------------------------------------------------
+ * The pulse loop shared by the back-projection imagers.
+ *
+ * For every pulse the core forms the differential range of each pixel,
+ * keeps the pixels inside the range gate, interpolates the range profile
+ * there, applies the phase correction exp(i k dR) and hands the result to
+ * an accumulation policy. What differs between imagers is supplied as
+ * template parameters, so each combination is compiled and inlined on its
+ * own, with no virtual calls in the loop:
+ *
+ *   Geometry       differential_range(pulse, firstCol, lastCol) over a
+ *                  range of grid columns
+ *   Interpolation  evaluate(grid, profile, query) on the range profile
+ *   Accumulation   tile_local(offset, pixels), accumulate(local, pulse,
+ *                  index, values) with tile-relative indices, and
+ *                  merge(local), called under the tile's lock
+ *
+ * T is the scalar precision (float or double).
+ *------------------------------------------------------------------------*/
+
+/*----- Geometry policies -----*/
+
+// dR = x * ux + y * uy (+ z * uz) for the look vector u of each pulse: plane-wave imagers.
+template <typename T, bool WithHeight>
+class planar_geometry
+{
+    public:
+        // look holds one (ux, uy, uz) column per pulse; z is ignored without height.
+        planar_geometry(const arma::mat& x, const arma::mat& y, const arma::mat& z, const arma::mat& lookVectors)
+            : gridX(arma::conv_to<arma::Mat<T>>::from(x)), gridY(arma::conv_to<arma::Mat<T>>::from(y)),
+              gridZ(WithHeight ? arma::conv_to<arma::Mat<T>>::from(z) : arma::Mat<T>()), look(arma::conv_to<arma::Mat<T>>::from(lookVectors))
+        {
+        }
+
+        arma::uword rows() const
+        {
+            return gridX.n_rows;
+        }
+
+        arma::uword cols() const
+        {
+            return gridX.n_cols;
+        }
+
+        arma::Mat<T> differential_range(const arma::uword pulse, const arma::uword firstCol, const arma::uword lastCol) const
+        {
+            if constexpr (WithHeight)
+            {
+                return gridX.cols(firstCol, lastCol) * look(0, pulse) + gridY.cols(firstCol, lastCol) * look(1, pulse)
+                    + gridZ.cols(firstCol, lastCol) * look(2, pulse);
+            }
+            else
+            {
+                return gridX.cols(firstCol, lastCol) * look(0, pulse) + gridY.cols(firstCol, lastCol) * look(1, pulse);
+            }
+        }
+
+    private:
+        arma::Mat<T> gridX;
+
+        arma::Mat<T> gridY;
+
+        arma::Mat<T> gridZ;
+
+        arma::Mat<T> look;
+};
+
+// dR = |antenna - pixel| - r0 for pixels on z = 0: spherical wavefronts.
+template <typename T>
+class spherical_geometry
+{
+    public:
+        // antenna holds one (x, y, z) column per pulse.
+        spherical_geometry(const arma::mat& x, const arma::mat& y, const arma::mat& antennaPositions, const arma::vec& referenceRanges)
+            : gridX(arma::conv_to<arma::Mat<T>>::from(x)), gridY(arma::conv_to<arma::Mat<T>>::from(y)),
+              antenna(arma::conv_to<arma::Mat<T>>::from(antennaPositions)), radius(arma::conv_to<arma::Col<T>>::from(referenceRanges))
+        {
+        }
+
+        arma::uword rows() const
+        {
+            return gridX.n_rows;
+        }
+
+        arma::uword cols() const
+        {
+            return gridX.n_cols;
+        }
+
+        arma::Mat<T> differential_range(const arma::uword pulse, const arma::uword firstCol, const arma::uword lastCol) const
+        {
+            return arma::sqrt(arma::square(antenna(0, pulse) - gridX.cols(firstCol, lastCol))
+                + arma::square(antenna(1, pulse) - gridY.cols(firstCol, lastCol))
+                + antenna(2, pulse) * antenna(2, pulse)) - radius(pulse);
+        }
+
+    private:
+        arma::Mat<T> gridX;
+
+        arma::Mat<T> gridY;
+
+        arma::Mat<T> antenna;
+
+        arma::Col<T> radius;
+};
+
+/*----- Interpolation policies -----*/
+
+// Linear interpolation of the range profile, whose grid is a uniform linspace.
+class linear_interpolation
+{
+    public:
+        template <typename T>
+        static arma::Col<std::complex<T>> evaluate(const arma::Col<T>& grid, const arma::Col<std::complex<T>>& profile, const arma::Col<T>& query)
+        {
+            return interp1_uniform(grid, profile, query);
+        }
+};
+
+/*----- Accumulation policies -----*/
+
+// Per-tile |sum|^2 - sum(|x|^2) accumulators, added to the image sums once per tile visit.
+class streaming_accumulation
+{
+    public:
+        // Pulse blocks of one tile may run on several threads at once, as each keeps its own sums.
+        static constexpr bool splitsPulses = true;
+
+        streaming_correlator total;
+
+        struct tile
+        {
+            unsigned long long offset;
+
+            streaming_correlator sums;
+        };
+
+        explicit streaming_accumulation(const unsigned long long sampleCount) : total(sampleCount)
+        {
+        }
+
+        static tile tile_local(const unsigned long long offset, const unsigned long long pixelCount)
+        {
+            return {offset, streaming_correlator(pixelCount)};
+        }
+
+        template <typename T>
+        static void accumulate(tile& local, const arma::uword pulse, const arma::uvec& index, const arma::Col<std::complex<T>>& values)
+        {
+            local.sums.accumulate(index, values);
+        }
+
+        void merge(const tile& local)
+        {
+            total.merge(local.sums, local.offset);
+        }
+};
+
+/*-------------------------------------------------------------------------
+ * The whole pulse-by-pixel buffer, for the FFT and selected-lag
+ * correlations. Each pixel is one buffer column, so a tile owns whole
+ * columns, and every pulse of a tile is written by the thread that holds
+ * it. Columns are padded with zero rows to whole cache lines and the
+ * storage is cache-line aligned, so no two tiles share a line. The buffer
+ * holds the precision the pulses were formed in, so the correlations of a
+ * single precision run stay in single precision.
+ *------------------------------------------------------------------------*/
+template <typename T = double>
+class buffered_accumulation
+{
+    public:
+        static constexpr bool splitsPulses = false;
+
+        // pulseCount rows per pixel, then zero padding.
+        arma::Mat<std::complex<T>> buffer;
+
+        struct tile
+        {
+            unsigned long long offset;
+        };
+
+        buffered_accumulation(const unsigned long long pulseCount, const unsigned long long sampleCount)
+            : buffer(allocate(padded_rows(pulseCount) * sampleCount), padded_rows(pulseCount), sampleCount, false, true),
+              storage(buffer.memptr())
+        {
+            buffer.zeros();
+        }
+
+        buffered_accumulation(const buffered_accumulation&) = delete;
+
+        buffered_accumulation& operator=(const buffered_accumulation&) = delete;
+
+        static tile tile_local(const unsigned long long offset, const unsigned long long pixelCount)
+        {
+            return {offset};
+        }
+
+        template <typename V>
+        void accumulate(tile& local, const arma::uword pulse, const arma::uvec& index, const arma::Col<std::complex<V>>& values)
+        {
+            for (arma::uword k = 0; k < index.n_elem; k++)
+            {
+                buffer.at(pulse, local.offset + index(k)) = std::complex<T>(values(k));
+            }
+        }
+
+        static void merge(const tile&)
+        {
+        }
+
+    private:
+        static constexpr unsigned long long cacheLineBytes = 64;
+
+        static constexpr unsigned long long valuesPerLine = cacheLineBytes / sizeof(std::complex<T>);
+
+        struct aligned_free
+        {
+            void operator()(std::complex<T>* memory) const
+            {
+                std::free(memory);
+            }
+        };
+
+        std::unique_ptr<std::complex<T>[], aligned_free> storage;
+
+        static unsigned long long padded_rows(const unsigned long long pulseCount)
+        {
+            return (pulseCount + valuesPerLine - 1) / valuesPerLine * valuesPerLine;
+        }
+
+        static std::complex<T>* allocate(const unsigned long long count)
+        {
+            void* memory = std::aligned_alloc(cacheLineBytes, std::max<unsigned long long>(count, valuesPerLine) * sizeof(std::complex<T>));
+            if (memory == nullptr)
+            {
+                throw std::bad_alloc();
+            }
+            return static_cast<std::complex<T>*>(memory);
+        }
+};
+
+/*----- Work decomposition -----*/
+
+/*-------------------------------------------------------------------------
+ * The image is split into tiles of whole grid columns, so the phase
+ * recurrence still sees complete columns, sized so the per-pulse working
+ * set of a tile (differential range, gate, interpolated values, phases and
+ * the tile's sums) stays in cache. Each work item is one tile against a
+ * block of consecutive pulses; blocks are sized so there are several items
+ * per worker to steal. Accumulations whose tiles cannot be shared between
+ * threads get one block of every pulse per tile, and narrower tiles instead.
+ *------------------------------------------------------------------------*/
+struct tile_layout
+{
+    arma::uword tileCols;
+
+    arma::uword pulseBlock;
+
+    static constexpr unsigned long long cacheBytes = 256 * 1024;
+
+    static constexpr unsigned long long itemsPerWorker = 4;
+
+    template <typename T>
+    static tile_layout fit(const arma::uword rows, const arma::uword cols, const arma::uword pulses, const unsigned long long workers,
+        const bool splitPulses = true)
+    {
+        const unsigned long long bytesPerPixel = 6 * sizeof(T) + 1 + sizeof(arma::cx_double) + sizeof(double);
+        const arma::uword tileCols = std::clamp<arma::uword>(cacheBytes / (std::max<arma::uword>(rows, 1) * bytesPerPixel), 1, std::max<arma::uword>(cols, 1));
+        if (!splitPulses)
+        {
+            const arma::uword balancedCols = std::max<arma::uword>(cols / (itemsPerWorker * workers), 1);
+            return {std::min(tileCols, balancedCols), std::max<arma::uword>(pulses, 1)};
+        }
+
+        const unsigned long long tileCount = (cols + tileCols - 1) / tileCols;
+        const unsigned long long blocksPerTile = (itemsPerWorker * workers + tileCount - 1) / std::max<unsigned long long>(tileCount, 1);
+        return {tileCols, std::max<arma::uword>(pulses / std::max<unsigned long long>(blocksPerTile, 1), 1)};
+    }
+};
+
+/*----- Core -----*/
+
+template <typename T, typename Geometry, typename Interpolation = linear_interpolation>
+class back_projection_core
+{
+    public:
+        // wavenumbers holds the phase correction wavenumber k of each pulse, applied as exp(i k dR).
+        back_projection_core(const Geometry& geometry, const arma::Col<T>& rangeGrid, const arma::Mat<std::complex<T>>& rangeProfiles,
+            const phase_corrector& phaseCorrector, const arma::vec& wavenumbers)
+            : geometry(geometry), rangeGrid(rangeGrid), rangeProfiles(rangeProfiles), phaseCorrector(phaseCorrector), wavenumbers(wavenumbers),
+              rangeMin(rangeGrid(0)), rangeMax(rangeGrid(rangeGrid.n_elem - 1))
+        {
+        }
+
+        arma::uword pulse_count() const
+        {
+            return rangeProfiles.n_cols;
+        }
+
+        // Contribution of one pulse to grid columns firstCol..lastCol; index receives the gated pixels, relative to firstCol.
+        arma::Col<std::complex<T>> pulse_values(const arma::uword pulse, const arma::uword firstCol, const arma::uword lastCol, arma::uvec& index) const
+        {
+            const arma::Mat<T> dRData = geometry.differential_range(pulse, firstCol, lastCol);
+            index = arma::find((dRData > rangeMin) % (dRData < rangeMax));
+            const arma::Col<T> validDRData = dRData.elem(index);
+            const arma::Col<std::complex<T>> phaseCorr = phaseCorrector.evaluate(wavenumbers(pulse), dRData, index, validDRData);
+            const arma::Col<std::complex<T>> profile = rangeProfiles.unsafe_col(pulse);
+            return Interpolation::evaluate(rangeGrid, profile, validDRData) % phaseCorr;
+        }
+
+        arma::Col<std::complex<T>> pulse_values(const arma::uword pulse, arma::uvec& index) const
+        {
+            return pulse_values(pulse, 0, geometry.cols() - 1, index);
+        }
+
+        // Runs every pulse over the whole grid, with the tile layout fitted to the grid and the thread count.
+        template <typename Accumulation>
+        void run(Accumulation& accumulation) const
+        {
+            run(accumulation, tile_layout::fit<T>(geometry.rows(), geometry.cols(), pulse_count(), omp_get_max_threads(), Accumulation::splitsPulses));
+        }
+
+        // Threads take (tile, pulse block) items from a work-stealing queue, in tile-major order, and keep one
+        // thread-private accumulator per tile they visit; it is merged under that tile's lock when they move on.
+        template <typename Accumulation>
+        void run(Accumulation& accumulation, const tile_layout& layout) const
+        {
+            const unsigned long long rows = geometry.rows();
+            const unsigned long long cols = geometry.cols();
+            const unsigned long long pulseCount = pulse_count();
+            const unsigned long long pulseBlock = Accumulation::splitsPulses ? layout.pulseBlock : std::max<unsigned long long>(pulseCount, 1);
+            const unsigned long long tileCount = (cols + layout.tileCols - 1) / layout.tileCols;
+            const unsigned long long blockCount = (pulseCount + pulseBlock - 1) / pulseBlock;
+            work_stealing_queue queue(tileCount * blockCount, omp_get_max_threads());
+            std::vector<std::mutex> tileLocks(tileCount);
+#pragma omp parallel
+            {
+                const unsigned long long worker = omp_get_thread_num();
+                auto local = accumulation.tile_local(0, 0);
+                unsigned long long currentTile = tileCount;
+                unsigned long long item;
+                while (queue.next(worker, item))
+                {
+                    const unsigned long long tileIndex = item / blockCount;
+                    const arma::uword firstCol = tileIndex * layout.tileCols;
+                    const arma::uword lastCol = std::min<unsigned long long>(firstCol + layout.tileCols, cols) - 1;
+                    if (tileIndex != currentTile)
+                    {
+                        if (currentTile < tileCount)
+                        {
+                            std::lock_guard<std::mutex> lock(tileLocks[currentTile]);
+                            accumulation.merge(local);
+                        }
+                        local = accumulation.tile_local(firstCol * rows, (lastCol - firstCol + 1) * rows);
+                        currentTile = tileIndex;
+                    }
+
+                    const unsigned long long firstPulse = item % blockCount * pulseBlock;
+                    const unsigned long long lastPulse = std::min<unsigned long long>(firstPulse + pulseBlock, pulseCount);
+                    for (unsigned long long j = firstPulse; j < lastPulse; j++)
+                    {
+                        arma::uvec index;
+                        const arma::Col<std::complex<T>> values = pulse_values(j, firstCol, lastCol, index);
+                        accumulation.accumulate(local, j, index, values);
+                    }
+                }
+
+                if (currentTile < tileCount)
+                {
+                    std::lock_guard<std::mutex> lock(tileLocks[currentTile]);
+                    accumulation.merge(local);
+                }
+            }
+        }
+
+    private:
+        const Geometry& geometry;
+
+        const arma::Col<T>& rangeGrid;
+
+        const arma::Mat<std::complex<T>>& rangeProfiles;
+
+        const phase_corrector& phaseCorrector;
+
+        const arma::vec& wavenumbers;
+
+        T rangeMin;
+
+        T rangeMax;
+};
+
+#endif //BACK_PROJECTION_CORE_H
@@ -3,8 +3,12 @@
 
 #include <armadillo>
 #include <filesystem>
+#include <sstream>
 #include <string>
 
+#include "../output_encodings.h"
+#include "../phase_correction_modes.h"
+#include "../precision_types.h"
 #include "../utils/io_utils.h"
 
 
@@ -17,17 +21,48 @@ class base_correlated_back_projection
 
         arma::mat imageData;
 
+        // RECURRENCE is opt-in, through set_phase_correction. Imagers whose differential range is not affine in pixel
+        // position always evaluate the phase exactly.
+        phase_correction_modes phaseCorrectionMode = phase_correction_modes::EXACT;
+
+        // Largest phase error, in radians, the recurrence may introduce before falling back to exact evaluation.
+        double phaseTolerance = 1e-6;
+
+        // Precision of the per-pulse work; imagers that are not templated on it always run in double.
+        precision_types precision = precision_types::DOUBLE;
+
         virtual int load() = 0;
 
         virtual int get_image_data() = 0;
 
-        bool save_image_data(const std::string& savePath, const std::string& saveName) const
+        bool save_image_data(const std::string& savePath, const std::string& saveName,
+            const output_encodings encoding = output_encodings::NATIVE) const
         {
-            return save_data(imageData, savePath, saveName);
+            return save_data(imageData, savePath, saveName, encoding);
         }
 
         virtual int clear() = 0;
 
+        // The settings that shape the image, as recorded in a run manifest; imagers append their own.
+        virtual std::string parameter_string() const
+        {
+            std::ostringstream stream;
+            stream << "phaseCorrectionMode=" << static_cast<int>(phaseCorrectionMode) << " phaseTolerance=" << phaseTolerance
+                << " precision=" << static_cast<int>(precision);
+            return stream.str();
+        }
+
+        void set_phase_correction(const phase_correction_modes mode, const double tolerance = 1e-6)
+        {
+            phaseCorrectionMode = mode;
+            phaseTolerance = tolerance;
+        }
+
+        void set_precision(const precision_types precision)
+        {
+            this->precision = precision;
+        }
+
         virtual ~base_correlated_back_projection() = default;
 };
 
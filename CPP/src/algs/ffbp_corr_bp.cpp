@@ -0,0 +1,350 @@
+#include "ffbp_corr_bp.h"
+#include "sample_corr_bp.h"
+#include "../constants.h"
+#include "../utils/io_utils.h"
+#include "../utils/matrix_math.h"
+#include "../utils/phase_utils.h"
+#include "../utils/pipeline_utils.h"
+#include "../utils/stopwatch.h"
+
+namespace
+{
+    std::unique_ptr<ffbp_corr_bp> create_imager(const std::string& path)
+    {
+        return std::make_unique<ffbp_corr_bp>(path, true);
+    }
+
+    // The images a batch run keeps of each input.
+    const auto keptImages = [](const ffbp_corr_bp& imager, const auto& write)
+    {
+        write("image", "", imager.finalImage);
+        if (imager.correlated)
+        {
+            write("corr", "_Corr", imager.finalCorrImage);
+        }
+    };
+}
+
+int ffbp_corr_bp::load()
+{
+    hdf5_reader reader(dataPath);
+    const bool loaded = reader.read(numXSamples, "numXSamples")
+        && reader.read(numYSamples, "numYSamples")
+        && reader.read(frequencyStepSize, "deltaF")
+        && reader.read(freqMin, "minF")
+        && reader.read(freqMax, "maxF")
+        && reader.read(pixelX, "x_mat")
+        && reader.read(pixelY, "y_mat")
+        && reader.read(pixelZ, "z_mat")
+        && reader.read(antAzim, "AntAzim")
+        && reader.read(antElev, "AntElev")
+        && reader.read(phase, "phdata");
+    return loaded ? 0 : -1;
+}
+
+void ffbp_corr_bp::orient(subimage& image)
+{
+    const double length = std::sqrt(image.sumX * image.sumX + image.sumY * image.sumY);
+    image.axisX = length > 0 ? image.sumX / length : 1.0;
+    image.axisY = length > 0 ? image.sumY / length : 0.0;
+    image.scale = length / static_cast<double>(image.pulseCount);
+}
+
+void ffbp_corr_bp::frame(subimage& image, const double rangeStep, const double maxWavenumber) const
+{
+    const double cornerX[4] = {sceneXMin, sceneXMax, sceneXMin, sceneXMax};
+    const double cornerY[4] = {sceneYMin, sceneYMin, sceneYMax, sceneYMax};
+    double rangeLow = std::numeric_limits<double>::max();
+    double rangeHigh = std::numeric_limits<double>::lowest();
+    double crossLow = std::numeric_limits<double>::max();
+    double crossHigh = std::numeric_limits<double>::lowest();
+    for (int i = 0; i < 4; i++)
+    {
+        const double range = cornerX[i] * image.axisX + cornerY[i] * image.axisY;
+        const double cross = cornerY[i] * image.axisX - cornerX[i] * image.axisY;
+        rangeLow = std::min(rangeLow, range);
+        rangeHigh = std::max(rangeHigh, range);
+        crossLow = std::min(crossLow, cross);
+        crossHigh = std::max(crossHigh, cross);
+    }
+
+    // Look vectors within halfAngle of the range axis put at most maxWavenumber * sin(halfAngle) of bandwidth along cross-range.
+    const double crossBandwidth = maxWavenumber * std::sin(std::min(image.halfAngle, pi / 2));
+    double crossStep = crossBandwidth > 0 ? pi / (crossRangeOversampling * crossBandwidth) : crossHigh - crossLow;
+    crossStep = std::max(crossStep, rangeStep);
+
+    image.rangeStep = rangeStep;
+    image.rangeStart = rangeLow - rangeStep;
+    image.crossStep = crossStep;
+    image.crossStart = crossLow - crossStep;
+    const unsigned long long rows = static_cast<unsigned long long>(std::ceil((rangeHigh - rangeLow) / rangeStep)) + 3;
+    const unsigned long long cols = static_cast<unsigned long long>(std::ceil((crossHigh - crossLow) / crossStep)) + 3;
+    image.values = arma::cx_mat(rows, cols, arma::fill::zeros);
+}
+
+arma::cx_double ffbp_corr_bp::sample(const subimage& image, const double x, const double y, const double wavenumber)
+{
+    const double range = x * image.axisX + y * image.axisY;
+    const double cross = y * image.axisX - x * image.axisY;
+    const arma::cx_double value = interp2_uniform(image.values, (range - image.rangeStart) / image.rangeStep,
+        (cross - image.crossStart) / image.crossStep);
+    return value * std::polar(1.0, wavenumber * image.scale * range);
+}
+
+int ffbp_corr_bp::get_image_data()
+{
+    const int totalSamples = numXSamples * numYSamples;
+    const int numPhasePulses = phase.n_cols;
+    if (numPhasePulses == 0 || antAzim.n_elem < phase.n_cols || antElev.n_elem < phase.n_cols
+        || pixelX.n_elem != static_cast<unsigned long long>(totalSamples) || pixelY.n_elem != pixelX.n_elem
+        || pixelZ.n_elem != pixelX.n_elem)
+    {
+        std::cout << "[Error] ffbp_corr_bp has no pulses or mismatched pixel grids for <" << dataPath << ">." << std::endl;
+        return -1;
+    }
+
+    const int fftSampleCount = 4 * numPhasePulses;
+    const double rangeExtent = c / (2 * frequencyStepSize);
+    const double rangeBin = rangeExtent / fftSampleCount;
+    arma::vec rangeProfile = arma::linspace(-fftSampleCount / 2,fftSampleCount / 2 - 1, fftSampleCount) * rangeExtent / fftSampleCount;
+    const double rangeMinimum = rangeProfile(0);
+    const double rangeMaximum = rangeProfile(rangeProfile.n_elem - 1);
+    const arma::cx_mat rangeProfiles = range_compress(phase, fftSampleCount);
+    const double wavenumber = -4.0 * freqMin * pi / c;
+    const double maxWavenumber = 4.0 * freqMax * pi / c;
+    const double planeZ = arma::mean(arma::vectorise(pixelZ));
+    const double subimageRangeStep = rangeBin / rangeOversampling;
+    sceneXMin = pixelX.min();
+    sceneXMax = pixelX.max();
+    sceneYMin = pixelY.min();
+    sceneYMax = pixelY.max();
+
+    const int topCount = std::max(1, std::min(subapertureCount, numPhasePulses));
+    int depth = std::max(0, factorizationDepth);
+    while (depth > 0 && (static_cast<long long>(topCount) << depth) > numPhasePulses)
+    {
+        depth--;
+    }
+    const int leafCount = topCount << depth;
+    const arma::uvec order = arma::sort_index(antAzim);
+
+    /*----- Leaves: direct back-projection of a few pulses onto a coarse subimage -----*/
+    std::vector<subimage> level(leafCount);
+#pragma omp parallel for schedule(dynamic)
+    for (int l = 0; l < leafCount; l++)
+    {
+        const long long first = static_cast<long long>(l) * numPhasePulses / leafCount;
+        const long long last = static_cast<long long>(l + 1) * numPhasePulses / leafCount;
+        subimage& leaf = level[l];
+        leaf.sumX = 0;
+        leaf.sumY = 0;
+        leaf.pulseCount = last - first;
+        for (long long p = first; p < last; p++)
+        {
+            const double antennaElevation = antElev.at(order(p)) * radian;
+            const double antennaAzimuth = antAzim.at(order(p)) * radian;
+            leaf.sumX += cos(antennaElevation) * cos(antennaAzimuth);
+            leaf.sumY += cos(antennaElevation) * sin(antennaAzimuth);
+        }
+        orient(leaf);
+
+        leaf.halfAngle = 0;
+        for (long long p = first; p < last; p++)
+        {
+            const double antennaAzimuth = antAzim.at(order(p)) * radian;
+            const double along = cos(antennaAzimuth) * leaf.axisX + sin(antennaAzimuth) * leaf.axisY;
+            const double across = sin(antennaAzimuth) * leaf.axisX - cos(antennaAzimuth) * leaf.axisY;
+            leaf.halfAngle = std::max(leaf.halfAngle, std::abs(std::atan2(across, along)));
+        }
+        frame(leaf, subimageRangeStep, maxWavenumber);
+
+        const arma::vec rangeAxis = leaf.rangeStart + arma::regspace(0, leaf.values.n_rows - 1) * leaf.rangeStep;
+        const arma::rowvec crossAxis = leaf.crossStart + arma::regspace<arma::rowvec>(0, leaf.values.n_cols - 1) * leaf.crossStep;
+        for (long long p = first; p < last; p++)
+        {
+            const unsigned long long j = order(p);
+            const double antennaElevation = antElev.at(j) * radian;
+            const double antennaAzimuth = antAzim.at(j) * radian;
+            const double lookX = cos(antennaElevation) * cos(antennaAzimuth);
+            const double lookY = cos(antennaElevation) * sin(antennaAzimuth);
+            const double along = lookX * leaf.axisX + lookY * leaf.axisY;
+            const double across = lookY * leaf.axisX - lookX * leaf.axisY;
+            const arma::mat dRData = arma::repmat(rangeAxis * along, 1, crossAxis.n_elem)
+                + arma::repmat(crossAxis * across, rangeAxis.n_elem, 1) + planeZ * sin(antennaElevation);
+            const arma::uvec index = arma::find((dRData > rangeMinimum) % (dRData < rangeMaximum));
+            const arma::vec validDRData = dRData.elem(index);
+            arma::cx_vec phaseCorr(validDRData.n_elem);
+            phase_exact(wavenumber, validDRData.memptr(), reinterpret_cast<double*>(phaseCorr.memptr()), validDRData.n_elem);
+            leaf.values.elem(index) += interp1_uniform(rangeProfile, rangeProfiles.unsafe_col(j), validDRData) % phaseCorr;
+        }
+
+        arma::cx_vec carrier(rangeAxis.n_elem);
+        phase_exact(-wavenumber * leaf.scale, rangeAxis.memptr(), reinterpret_cast<double*>(carrier.memptr()), rangeAxis.n_elem);
+        leaf.values.each_col() %= carrier;
+    }
+
+    /*----- Merges: each parent resamples its two children onto its own grid -----*/
+    for (int d = 0; d < depth; d++)
+    {
+        std::vector<subimage> parents(level.size() / 2);
+        for (unsigned long long q = 0; q < parents.size(); q++)
+        {
+            const subimage& left = level[2 * q];
+            const subimage& right = level[2 * q + 1];
+            subimage& parent = parents[q];
+            parent.sumX = left.sumX + right.sumX;
+            parent.sumY = left.sumY + right.sumY;
+            parent.pulseCount = left.pulseCount + right.pulseCount;
+            orient(parent);
+            parent.halfAngle = 0;
+            for (const subimage* child : {&left, &right})
+            {
+                const double along = child->axisX * parent.axisX + child->axisY * parent.axisY;
+                const double across = child->axisY * parent.axisX - child->axisX * parent.axisY;
+                parent.halfAngle = std::max(parent.halfAngle, std::abs(std::atan2(across, along)) + child->halfAngle);
+            }
+            frame(parent, subimageRangeStep, maxWavenumber);
+
+            const long long rows = parent.values.n_rows;
+            const long long cols = parent.values.n_cols;
+            const arma::vec rangeAxis = parent.rangeStart + arma::regspace(0, rows - 1) * parent.rangeStep;
+            arma::cx_vec carrier(rows);
+            phase_exact(-wavenumber * parent.scale, rangeAxis.memptr(), reinterpret_cast<double*>(carrier.memptr()), rows);
+#pragma omp parallel for
+            for (long long k = 0; k < cols; k++)
+            {
+                const double cross = parent.crossStart + static_cast<double>(k) * parent.crossStep;
+                arma::cx_double* column = parent.values.colptr(k);
+                for (long long i = 0; i < rows; i++)
+                {
+                    const double x = rangeAxis(i) * parent.axisX - cross * parent.axisY;
+                    const double y = rangeAxis(i) * parent.axisY + cross * parent.axisX;
+                    column[i] = (sample(left, x, y, wavenumber) + sample(right, x, y, wavenumber)) * carrier(i);
+                }
+            }
+        }
+        level = std::move(parents);
+    }
+
+    /*----- Top level: sample each subaperture image at the pixels -----*/
+    arma::cx_vec sum(totalSamples);
+    arma::vec energy(totalSamples);
+#pragma omp parallel for
+    for (int j = 0; j < totalSamples; j++)
+    {
+        arma::cx_double pixelSum(0.0, 0.0);
+        double pixelEnergy = 0;
+        for (const subimage& image : level)
+        {
+            const arma::cx_double value = sample(image, pixelX(j), pixelY(j), wavenumber);
+            pixelSum += value;
+            pixelEnergy += std::norm(value);
+        }
+        sum(j) = pixelSum;
+        energy(j) = pixelEnergy;
+    }
+
+    finalImage = arma::reshape(sum, numXSamples, numYSamples);
+    if (correlated)
+    {
+        finalCorrImage = arma::cx_mat(arma::reshape(arma::square(arma::abs(sum)) - energy, numXSamples, numYSamples),
+            arma::mat(numXSamples, numYSamples, arma::fill::zeros));
+    }
+    return 0;
+}
+
+std::string ffbp_corr_bp::parameter_string() const
+{
+    std::ostringstream stream;
+    stream << base_correlated_back_projection::parameter_string() << " correlated=" << correlated
+        << " factorizationDepth=" << factorizationDepth << " subapertureCount=" << subapertureCount
+        << " rangeOversampling=" << rangeOversampling << " crossRangeOversampling=" << crossRangeOversampling;
+    return stream.str();
+}
+
+std::vector<int> ffbp_corr_bp::generic_run(const std::vector<std::string>& inputPaths, const std::string& savePath, const int from, const int to,
+    const output_modes outputMode, const output_encodings outputEncoding)
+{
+    return batch_run(inputPaths, from, to, create_imager, keptImages, savePath, "ffbp_corr_bp", outputMode, outputEncoding);
+}
+
+std::vector<int> ffbp_corr_bp::generic_run(const std::vector<std::string>& inputPaths, const std::string& savePath, work_queue& queue,
+    const output_modes outputMode, const output_encodings outputEncoding)
+{
+    return batch_run(inputPaths, queue, create_imager, keptImages, savePath, "ffbp_corr_bp", outputMode, outputEncoding);
+}
+
+ffbp_corr_bp::direct_comparison ffbp_corr_bp::compare_with_direct(const ffbp_corr_bp& loaded)
+{
+    sample_corr_bp direct(loaded.dataPath, false);
+    direct.set_phase_correction(phase_correction_modes::EXACT);
+    direct.numXSamples = loaded.numXSamples;
+    direct.numYSamples = loaded.numYSamples;
+    direct.frequencyStepSize = loaded.frequencyStepSize;
+    direct.freqMin = loaded.freqMin;
+    direct.freqMax = loaded.freqMax;
+    direct.pixelX = loaded.pixelX;
+    direct.pixelY = loaded.pixelY;
+    direct.pixelZ = loaded.pixelZ;
+    direct.antAzim = loaded.antAzim;
+    direct.antElev = loaded.antElev;
+    direct.phase = loaded.phase;
+    stopwatch timer;
+    const int directStatus = direct.get_image_data();
+    const long long directMilliseconds = timer.elapsed_milliseconds();
+
+    ffbp_corr_bp factorized = loaded;
+    factorized.correlated = false;
+    timer.restart();
+    const int factorizedStatus = factorized.get_image_data();
+    const long long factorizedMilliseconds = timer.elapsed_milliseconds();
+
+    if (directStatus != 0 || factorizedStatus != 0 || direct.finalImage.n_elem != factorized.finalImage.n_elem
+        || direct.finalImage.is_empty())
+    {
+        std::cout << "[Error] compare_with_direct failed for <" << loaded.dataPath << ">." << std::endl;
+        return {0, 0, 0, false};
+    }
+
+    const arma::cx_vec reference = arma::vectorise(direct.finalImage);
+    const arma::cx_vec image = arma::vectorise(factorized.finalImage);
+    const arma::vec directMagnitude = arma::abs(reference);
+    const arma::vec factorizedMagnitude = arma::abs(image);
+    direct_comparison comparison;
+    comparison.relativeError = arma::norm(image - reference) / arma::norm(reference);
+    comparison.correlation = arma::dot(factorizedMagnitude, directMagnitude)
+        / (arma::norm(factorizedMagnitude) * arma::norm(directMagnitude));
+    comparison.peakRatio = factorizedMagnitude.max() / directMagnitude.max();
+    comparison.peaksAgree = factorizedMagnitude.index_max() == directMagnitude.index_max();
+    std::cout << "[FFBP] " << loaded.dataPath << std::endl;
+    std::cout << "    direct: " << directMilliseconds << " ms, factorized (depth " << loaded.factorizationDepth << ", "
+        << loaded.subapertureCount << " subapertures): " << factorizedMilliseconds << " ms" << std::endl;
+    std::cout << "    relative error: " << comparison.relativeError << ", magnitude correlation: " << comparison.correlation
+        << ", peak ratio: " << comparison.peakRatio << ", peaks " << (comparison.peaksAgree ? "on the same pixel" : "on different pixels")
+        << std::endl;
+    return comparison;
+}
+
+int ffbp_corr_bp::compare_with_direct(const std::string& dataPath, const int factorizationDepth, const int subapertureCount)
+{
+    ffbp_corr_bp imager(dataPath, false, factorizationDepth, subapertureCount);
+    if (imager.load() != 0)
+    {
+        std::cout << "[Error] compare_with_direct failed for <" << dataPath << ">: data loading." << std::endl;
+        return -1;
+    }
+
+    compare_with_direct(imager);
+    return 0;
+}
+
+int ffbp_corr_bp::clear()
+{
+    pixelX.clear();
+    pixelY.clear();
+    pixelZ.clear();
+    antAzim.clear();
+    antElev.clear();
+    phase.clear();
+    return 0;
+}
@@ -0,0 +1,166 @@
+#ifndef FFBP_CORR_BP_H
+#define FFBP_CORR_BP_H
+
+#include "base_correlated_back_projection.h"
+#include <armadillo>
+#include <vector>
+
+#include "../output_encodings.h"
+#include "../output_modes.h"
+#include "../utils/work_queue.h"
+
+
+/*-------------------------------------------------------------------------
+ * Fast factorized back-projection over the sample_corr_bp inputs.
+ *
+ * Pulses are sorted by azimuth and split into subapertureCount * 2^depth
+ * leaf subapertures. Each leaf is back-projected directly onto a coarse
+ * subimage sampled in its own range / cross-range frame (the plane-wave
+ * limit of a polar grid), with the range carrier demodulated so the
+ * subimage can be interpolated. Neighbouring subimages are then merged
+ * pairwise, depth times, each merge resampling the children onto the
+ * parent's finer cross-range grid. The subapertureCount top-level
+ * subimages are finally sampled at the pixel grid and summed, giving
+ * O(N^2 log N) work in place of O(pulses * pixels).
+ *
+ * The scene is treated as the plane z = mean(z_mat). The correlated image
+ * is taken across the top-level subapertures rather than across pulses.
+ *------------------------------------------------------------------------*/
+class ffbp_corr_bp : public base_correlated_back_projection
+{
+public:
+    struct subimage
+    {
+        // Demodulated samples; rows run along range, columns along cross-range.
+        arma::cx_mat values;
+
+        double rangeStart;
+
+        double rangeStep;
+
+        double crossStart;
+
+        double crossStep;
+
+        // Unit range axis in the ground plane; the cross-range axis is (-axisY, axisX).
+        double axisX;
+
+        double axisY;
+
+        // Length of the mean ground-plane look vector, which scales differential range against the range axis.
+        double scale;
+
+        // Largest angle between the range axis and any look vector of the subaperture.
+        double halfAngle;
+
+        double sumX;
+
+        double sumY;
+
+        unsigned long long pulseCount;
+    };
+
+    // How closely a factorized image follows sample_corr_bp's direct back-projection of the same data.
+    struct direct_comparison
+    {
+        // Norm of the complex difference over the norm of the direct image.
+        double relativeError;
+
+        // Normalised correlation of the two magnitude images; 1 when they agree up to scale.
+        double correlation;
+
+        // Largest factorized magnitude over the largest direct magnitude.
+        double peakRatio;
+
+        bool peaksAgree;
+    };
+
+    bool correlated;
+
+    int factorizationDepth;
+
+    int subapertureCount;
+
+    // Samples per range bin and per cross-range Nyquist interval in the subimages.
+    double rangeOversampling = 2;
+
+    double crossRangeOversampling = 2;
+
+    int numXSamples;
+
+    int numYSamples;
+
+    double frequencyStepSize;
+
+    double freqMin;
+
+    double freqMax;
+
+    arma::mat pixelX;
+
+    arma::mat pixelY;
+
+    arma::mat pixelZ;
+
+    arma::vec antAzim;
+
+    arma::vec antElev;
+
+    arma::cx_mat phase;
+
+    arma::cx_mat finalImage;
+
+    arma::cx_mat finalCorrImage;
+
+    explicit ffbp_corr_bp(const std::string& dataPath, const bool correlated = true, const int factorizationDepth = 6,
+        const int subapertureCount = 4)
+    {
+        this->correlated = correlated;
+        this->dataPath = dataPath;
+        this->factorizationDepth = factorizationDepth;
+        this->subapertureCount = subapertureCount;
+    }
+
+    int load() override;
+
+    int get_image_data() override;
+
+    int clear() override;
+
+    std::string parameter_string() const override;
+
+    // Images inputPaths[from..to); returns the indices of the inputs that failed to load, image or save.
+    static std::vector<int> generic_run(const std::vector<std::string>& inputPaths, const std::string& savePath, const int from, const int to,
+        const output_modes outputMode = output_modes::FILES, const output_encodings outputEncoding = output_encodings::NATIVE);
+
+    // Images the inputs the queue hands this process, in one pipelined run; returns the indices of those that failed.
+    static std::vector<int> generic_run(const std::vector<std::string>& inputPaths, const std::string& savePath, work_queue& queue,
+        const output_modes outputMode = output_modes::FILES, const output_encodings outputEncoding = output_encodings::NATIVE);
+
+    // Images a loaded imager with this engine and with sample_corr_bp, prints the run times and compares the images.
+    static direct_comparison compare_with_direct(const ffbp_corr_bp& loaded);
+
+    // Loads dataPath and reports compare_with_direct for it.
+    static int compare_with_direct(const std::string& dataPath, const int factorizationDepth = 6, const int subapertureCount = 4);
+
+private:
+    double sceneXMin;
+
+    double sceneXMax;
+
+    double sceneYMin;
+
+    double sceneYMax;
+
+    // Sets the range axis and scale of an image from its summed look vectors.
+    static void orient(subimage& image);
+
+    // Sizes an oriented image's grid to cover the scene, with the cross-range step set by its angular extent.
+    void frame(subimage& image, double rangeStep, double maxWavenumber) const;
+
+    static arma::cx_double sample(const subimage& image, double x, double y, double wavenumber);
+};
+
+
+
+#endif //FFBP_CORR_BP_H
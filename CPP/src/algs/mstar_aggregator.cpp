@@ -1,9 +1,13 @@
 #include "mstar_aggregator.h"
 
-#include <regex>
+#include <algorithm>
+#include <iostream>
+#include <omp.h>
 #include <utility>
-#include "../extern/mstar2raw.h"
 #include "../utils/file_utils.h"
+#include "../utils/mstar_file.h"
+#include "../utils/phoenix_header.h"
+#include "../utils/stopwatch.h"
 
 /*-------------------------------------------------------------------------
  * To-Do:
@@ -17,6 +21,31 @@ mstar_aggregator::mstar_aggregator(std::string mstarPath, const bool debug)
     this->debug = debug;
 }
 
+// The polarisationType ids the aggregated files have always used: 1 to 4 for HH, HV, VH and VV, -1 otherwise.
+static int polarisation_id(const std::optional<polarization_types>& polarization)
+{
+    if (!polarization)
+    {
+        return -1;
+    }
+
+    switch (*polarization)
+    {
+        case polarization_types::HH:
+            return 1;
+
+        case polarization_types::HV:
+            return 2;
+
+        case polarization_types::VH:
+            return 3;
+
+        case polarization_types::VV:
+            return 4;
+    }
+    return -1;
+}
+
 void mstar_aggregator::load(const bool fullLoad)
 {
     if (debug)
@@ -32,8 +61,58 @@ void mstar_aggregator::load(const bool fullLoad)
         std::cout << "[Debug] Encountered " << dataCount << " targets." << std::endl;
     }
 
-    std::vector<arma::vec> allMagnitude;
-    std::vector<arma::vec> allPhase;
+    allocate(dataCount);
+
+    /*-------------------------------------------------------------------------
+     * The first pass reads only the Phoenix headers, which fixes the size of
+     * every image, so the output matrices are allocated once. The second pass
+     * decodes each file straight into its own row; no file is held beyond the
+     * thread decoding it. Both passes are parallel over files.
+     *------------------------------------------------------------------------*/
+    std::vector<char> headerRead(dataCount, 0);
+#pragma omp parallel for schedule(dynamic)
+    for (long long i = 0; i < static_cast<long long>(dataCount); i++)
+    {
+        phoenix_header iHeader;
+        headerRead[i] = read_phoenix_header(paths[i], iHeader);
+        if (headerRead[i])
+        {
+            assign_header(i, iHeader);
+        }
+    }
+
+    // Files whose header could not be read are left as zero rows.
+    for (long long i = 0; i < static_cast<long long>(dataCount); i++)
+    {
+        if (!headerRead[i])
+        {
+            std::cout << "[Error] mstar_aggregator failed to read the header of <" << paths[i] << ">." << std::endl;
+        }
+    }
+    decode(fullLoad, paths);
+}
+
+void mstar_aggregator::load(const bool fullLoad, const mstar_catalog& catalog, const mstar_query& query)
+{
+    const std::vector<size_t> selected = catalog.find(query);
+    if (debug)
+    {
+        std::cout << "[Debug] Selected " << selected.size() << " of " << catalog.size() << " catalogued targets." << std::endl;
+    }
+
+    // The headers were read when the catalog was built, so only the selected files are opened, to decode their pixels.
+    allocate(selected.size());
+    std::vector<std::string> paths(selected.size());
+    for (size_t i = 0; i < selected.size(); i++)
+    {
+        paths[i] = catalog.path(selected[i]);
+        assign_header(i, catalog.header(selected[i]));
+    }
+    decode(fullLoad, paths);
+}
+
+void mstar_aggregator::allocate(const unsigned long long dataCount)
+{
     nRows = arma::vec(dataCount);
     nCols = arma::vec(dataCount);
     azim = arma::vec(dataCount);
@@ -64,146 +143,129 @@ void mstar_aggregator::load(const bool fullLoad)
     bandwidth = arma::vec(dataCount);
     polarisationType = arma::vec(dataCount);
 
-    auto verify_and_assign = [](std::map<std::string, std::string>& header, arma::mat& destination, const int index, const std::string& dataName)
-    {
-        if (header.find(dataName) != header.end())
-        {
-            destination.at(index) = std::stod(header[dataName]);
-        }
-    };
+    // A file stays at zero rows and columns, and out of the output, until its header is assigned.
+    nRows.zeros();
+    nCols.zeros();
+}
+
+void mstar_aggregator::assign_header(const arma::uword index, const phoenix_header& iHeader)
+{
+    /*-------------------------------------------------------------------------
+     * The desired latitude and longitude are not used right now, but they could
+     * be looked at for calculating a motion compensation point.
+     *------------------------------------------------------------------------*/
+    nRows.at(index) = iHeader.numRows;
+    nCols.at(index) = iHeader.numCols;
+    azim.at(index) = iHeader.azimuth;
+    roll.at(index) = iHeader.roll;
+    pitch.at(index) = iHeader.pitch;
+    yaw.at(index) = iHeader.yaw;
+    depression.at(index) = iHeader.depression;
+    groundPlaneSquint.at(index) = iHeader.groundPlaneSquint;
+    slantPlaneSquint.at(index) = iHeader.slantPlaneSquint;
+    range.at(index) = iHeader.range;
+    targetX.at(index) = iHeader.aimpointLatitude;
+    targetY.at(index) = iHeader.aimpointLongitude;
+    targetZ.at(index) = iHeader.aimpointElevation;
+    antennaX.at(index) = iHeader.antennaLatitude;
+    antennaY.at(index) = iHeader.antennaLongitude;
+    antennaZ.at(index) = iHeader.aircraftAltitude;
+    heading.at(index) = iHeader.aircraftHeading;
+    xVelocity.at(index) = iHeader.xVelocity;
+    slowTime.at(index) = iHeader.collectionTime;
+    rangeResolution.at(index) = iHeader.rangeResolution;
+    crossRangeResolution.at(index) = iHeader.crossRangeResolution;
+    rangePixelSpacing.at(index) = iHeader.rangePixelSpacing;
+    crossRangePixelSpacing.at(index) = iHeader.crossRangePixelSpacing;
+    centreFrequency.at(index) = iHeader.centreFrequency;
+    bandwidth.at(index) = iHeader.bandwidth;
+    polarisationType.at(index) = polarisation_id(iHeader.polarization);
+}
 
+void mstar_aggregator::decode(const bool fullLoad, const std::vector<std::string>& paths)
+{
     // We want to ensure the number of rows and columns stay consistent.
-    int highestNRows = -1, highestNCols = -1, lowestNRows = -1, lowestNCols = -1;
-    for (int i = 0; i < dataCount; i++)
+    const unsigned long long dataCount = paths.size();
+    const arma::uvec valid = arma::find(nRows > 0 && nCols > 0);
+    if (valid.is_empty())
     {
-        const std::string& path = paths[i];
-        std::map<std::string, std::string> iHeader;
-        arma::vec iMagnitude;
-        arma::vec iPhase;
-        decompress_mstar(path, iHeader, iMagnitude, iPhase);
-
-        const int nRow = std::stoi(iHeader["NumberOfRows"]);
-        if (highestNRows == -1)
-        {
-            highestNRows = nRow;
-            lowestNRows = nRow;
-        }
-
-        const int nCol = std::stoi(iHeader["NumberOfColumns"]);
-        if (highestNCols == -1)
-        {
-            highestNCols = nCol;
-            lowestNCols = nCol;
-        }
-
-        if (nRow > highestNRows)
-        {
-            highestNRows = nRow;
-        }
-
-        if (nCol > highestNCols)
-        {
-            highestNCols = nCol;
-        }
+        numXSamples = -1;
+        numYSamples = -1;
+        magnitude.reset();
+        phase.reset();
+        return;
+    }
 
-        if (nRow < lowestNRows)
-        {
-            lowestNRows = nRow;
-        }
+    const int highestNRows = static_cast<int>(arma::max(nRows.elem(valid)));
+    const int highestNCols = static_cast<int>(arma::max(nCols.elem(valid)));
+    const int lowestNRows = static_cast<int>(arma::min(nRows.elem(valid)));
+    const int lowestNCols = static_cast<int>(arma::min(nCols.elem(valid)));
+    numXSamples = lowestNCols;
+    numYSamples = lowestNRows;
+    const long long maxSamples = fullLoad ? highestNRows * highestNCols : lowestNRows * lowestNCols;
 
-        if (nCol < lowestNCols)
+    /*-------------------------------------------------------------------------
+     * A file's row would be strided through the column-major matrices, so
+     * the files are decoded into one contiguous column each, every thread
+     * writing whole lines of its own, and transposed once at the end.
+     *------------------------------------------------------------------------*/
+    arma::mat magnitudeColumns(maxSamples, dataCount, arma::fill::zeros);
+    arma::mat phaseColumns(maxSamples, dataCount, arma::fill::zeros);
+    std::vector<char> decoded(valid.n_elem, 0);
+#pragma omp parallel for schedule(dynamic, 8)
+    for (long long v = 0; v < static_cast<long long>(valid.n_elem); v++)
+    {
+        const arma::uword i = valid(v);
+        const mstar_file file(paths[i]);
+        const size_t count = std::min<size_t>(file.pixel_count(), maxSamples);
+        decoded[v] = file.is_open() && file.read_magnitude(magnitudeColumns.colptr(i), count) && file.read_phase(phaseColumns.colptr(i), count);
+        if (!decoded[v])
         {
-            lowestNCols = nCol;
+            magnitudeColumns.col(i).zeros();
+            phaseColumns.col(i).zeros();
         }
+    }
+    magnitude = magnitudeColumns.t();
+    phase = phaseColumns.t();
 
-        allMagnitude.push_back(iMagnitude);
-        allPhase.push_back(iPhase);
-
-        /*-------------------------------------------------------------------------
-         * The desired latitude and longitude are not used right now, but they could
-         * be looked at for calculating a motion compensation point.
-         *------------------------------------------------------------------------*/
-        nRows.at(i) = nRow;
-        nCols.at(i) = nCol;
-        verify_and_assign(iHeader, azim, i, "TargetAz");
-        verify_and_assign(iHeader, roll, i, "TargetRoll");
-        verify_and_assign(iHeader, pitch, i, "TargetPitch");
-        verify_and_assign(iHeader, yaw, i, "TargetYaw");
-        verify_and_assign(iHeader, depression, i, "MeasuredDepression");
-        verify_and_assign(iHeader, groundPlaneSquint, i, "MeasuredGroundPlaneSquint");
-        verify_and_assign(iHeader, slantPlaneSquint, i, "MeasuredSlantPlaneSquint");
-        verify_and_assign(iHeader, range, i, "MeasuredRange");
-        verify_and_assign(iHeader, targetX, i, "MeasuredAimpointLatitude");
-        verify_and_assign(iHeader, targetY, i, "MeasuredAimpointLongitude");
-        verify_and_assign(iHeader, targetZ, i, "MeasuredAimpointElevation");
-        verify_and_assign(iHeader, antennaX, i, "MeasuredAntennaLatitude");
-        verify_and_assign(iHeader, antennaY, i, "MeasuredAntennaLongitude");
-        verify_and_assign(iHeader, antennaZ, i, "MeasuredAircraftAltitude");
-        verify_and_assign(iHeader, heading, i, "MeasuredAircraftHeading");
-        verify_and_assign(iHeader, xVelocity, i, "X_Velocity");
-        verify_and_assign(iHeader, slowTime, i, "CollectionTime");
-        verify_and_assign(iHeader, rangeResolution, i, "RangeResolution");
-        verify_and_assign(iHeader, crossRangeResolution, i, "CrossRangeResolution");
-        verify_and_assign(iHeader, rangePixelSpacing, i, "RangePixelSpacing");
-        verify_and_assign(iHeader, crossRangePixelSpacing, i, "CrossRangePixelSpacing");
-
-        std::regex gHzPattern(" *GHz");
-        if (iHeader.find("CenterFrequency") != iHeader.end())
+    for (arma::uword v = 0; v < valid.n_elem; v++)
+    {
+        if (!decoded[v])
         {
-            std::string headerValue = iHeader["CenterFrequency"];
-            centreFrequency.at(i) = std::stod(std::regex_replace(headerValue, gHzPattern, ""));
+            std::cout << "[Error] mstar_aggregator failed to decode <" << paths[valid(v)] << ">." << std::endl;
         }
+    }
+}
 
-        if (iHeader.find("Bandwidth") != iHeader.end())
-        {
-            std::string headerValue = iHeader["Bandwidth"];
-            bandwidth.at(i) = std::stod(std::regex_replace(headerValue, gHzPattern, ""));
-        }
+int mstar_aggregator::scaling_report(const std::string& mstarPath, const int maxThreads)
+{
+    mstar_aggregator aggregator(mstarPath);
 
-        if (iHeader.find("Polarization") != iHeader.end())
-        {
-            std::string polarization = iHeader["Polarization"];
-            int polarizationId = -1;
-            if (polarization == "HH")
-            {
-                polarizationId = 1;
-            }
-            else if (polarization == "HV")
-            {
-                polarizationId = 2;
-            }
-            else if (polarization == "VH")
-            {
-                polarizationId = 3;
-            }
-            else if (polarization == "VV")
-            {
-                polarizationId = 4;
-            }
-            polarisationType.at(i) = polarizationId;
-        }
+    // The first load only brings the files into the page cache, so the timed ones measure decoding rather than the disk.
+    aggregator.load(true);
+    if (aggregator.numXSamples < 0)
+    {
+        std::cout << "[Error] scaling_report found no MSTAR files in <" << mstarPath << ">." << std::endl;
+        return -1;
     }
 
-    numXSamples = lowestNCols;
-    numYSamples = lowestNRows;
-    const long long maxSamples = fullLoad ? highestNRows * highestNCols : lowestNRows * lowestNCols;
-    magnitude = arma::mat(dataCount, maxSamples);
-    phase = arma::mat(dataCount, maxSamples);
-
-    const int range = lowestNRows * lowestNCols - 1;
-    for (int i = 0; i < dataCount; i++)
+    const int defaultThreads = omp_get_max_threads();
+    const double files = aggregator.nRows.n_elem;
+    std::cout << "[Scaling] " << mstarPath << ": " << files << " files" << std::endl;
+    long long baseMilliseconds = 0;
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
     {
-        if (fullLoad)
-        {
-            magnitude.row(i).subvec(0, allMagnitude[i].size() - 1) = allMagnitude[i].t();
-            phase.row(i).subvec(0, allPhase[i].size() - 1) = allPhase[i].t();
-        }
-        else
-        {
-            magnitude.row(i) = allMagnitude[i].subvec(0, range).t();
-            phase.row(i) = allPhase[i].subvec(0, range).t();
-        }
+        omp_set_num_threads(threads);
+        stopwatch timer;
+        aggregator.load(true);
+        const long long milliseconds = std::max(timer.elapsed_milliseconds(), 1LL);
+        baseMilliseconds = threads == 1 ? milliseconds : baseMilliseconds;
+        const double speedup = static_cast<double>(baseMilliseconds) / static_cast<double>(milliseconds);
+        std::cout << "    " << threads << " threads: " << milliseconds << " ms, " << 1000.0 * files / milliseconds
+            << " files/s, speedup " << speedup << ", efficiency " << speedup / threads << std::endl;
     }
+    omp_set_num_threads(defaultThreads);
+    return 0;
 }
 
 void mstar_aggregator::save(const std::string& rawSavePath)
@@ -4,6 +4,9 @@
 #include <armadillo>
 #include <map>
 #include <string>
+#include <vector>
+
+#include "../utils/mstar_catalog.h"
 
 
 class mstar_aggregator
@@ -79,7 +82,21 @@ class mstar_aggregator
 
         void load(bool fullLoad);
 
+        // Loads the catalogued files the query selects, taking their headers from the catalog rather than the files.
+        void load(bool fullLoad, const mstar_catalog& catalog, const mstar_query& query);
+
         void save(const std::string& rawSavePath);
+
+        // Loads every file of mstarPath with 1, 2, 4, ... maxThreads threads, and prints the run time, file rate, speedup
+        // over one thread and parallel efficiency of each.
+        static int scaling_report(const std::string& mstarPath, int maxThreads = 64);
+
+    private:
+        void allocate(unsigned long long dataCount);
+
+        void assign_header(arma::uword index, const phoenix_header& iHeader);
+
+        void decode(bool fullLoad, const std::vector<std::string>& paths);
 };
 
 
@@ -1,116 +1,210 @@
 #include "ph_mstar_corr_bp.h"
+
+#include <algorithm>
+#include <iostream>
+#include <omp.h>
+
+#include "back_projection_core.h"
 #include "../constants.h"
+#include "../utils/correlation_utils.h"
 #include "../utils/io_utils.h"
 #include "../utils/matrix_math.h"
+#include "../utils/phase_utils.h"
+#include "../utils/pipeline_utils.h"
+#include "../utils/stopwatch.h"
+
+namespace
+{
+    std::unique_ptr<ph_mstar_corr_bp> create_imager(const std::string& path)
+    {
+        return std::make_unique<ph_mstar_corr_bp>(path, true);
+    }
+
+    // The images a batch run keeps of each input.
+    const auto keptImages = [](const ph_mstar_corr_bp& imager, const auto& write)
+    {
+        write("image", "", imager.finalImages);
+        if (imager.correlated)
+        {
+            write("corr", "_Corr", imager.finalCorrImages);
+        }
+    };
+}
 
 int ph_mstar_corr_bp::load()
 {
-    const std::string& dataPath = this->dataPath;
-    load_data(numPulses, dataPath, "numPulses");
-    load_data(numXSamples, dataPath, "numXSamples");
-    load_data(numYSamples, dataPath, "numYSamples");
-    load_data(centerX, dataPath, "centreX");
-    load_data(centerY, dataPath, "centreY");
-    load_data(sceneWidth, dataPath, "sceneWidth");
-    load_data(sceneHeight, dataPath, "sceneHeight");
-    load_data(minAzimuth, dataPath, "minAzim");
-    load_data(maxAzimuth, dataPath, "maxAzim");
-    load_data(frequencyStepSize, dataPath, "deltaF");
-    load_data(freqMin, dataPath, "minF");
-    load_data(freqMax, dataPath, "maxF");
-    load_data(pixelX, dataPath, "x_mat");
-    load_data(pixelY, dataPath, "y_mat");
-    load_data(pixelZ, dataPath, "z_mat");
-    load_data(antX, dataPath, "AntX");
-    load_data(antY, dataPath, "AntY");
-    load_data(antZ, dataPath, "AntZ");
-    load_data(antAzim, dataPath, "AntAzim");
-    load_data(antElev, dataPath, "AntElev");
-    load_data(phase, dataPath, "phdata");
-    return 0;
+    hdf5_reader reader(dataPath);
+    // Fields image formation does not use are read if present; only the rest must be.
+    reader.read(centerX, "centreX");
+    reader.read(centerY, "centreY");
+    reader.read(sceneWidth, "sceneWidth");
+    reader.read(sceneHeight, "sceneHeight");
+    reader.read(minAzimuth, "minAzim");
+    reader.read(maxAzimuth, "maxAzim");
+    reader.read(freqMax, "maxF");
+    reader.read(antX, "AntX");
+    reader.read(antY, "AntY");
+    reader.read(antZ, "AntZ");
+    const bool loaded = reader.read(numPulses, "numPulses")
+        && reader.read(numXSamples, "numXSamples")
+        && reader.read(numYSamples, "numYSamples")
+        && reader.read(frequencyStepSize, "deltaF")
+        && reader.read(freqMin, "minF")
+        && reader.read(pixelX, "x_mat")
+        && reader.read(pixelY, "y_mat")
+        && reader.read(pixelZ, "z_mat")
+        && reader.read(antAzim, "AntAzim")
+        && reader.read(antElev, "AntElev")
+        && reader.read(phase, "phdata");
+    return loaded ? 0 : -1;
 }
 
 int ph_mstar_corr_bp::get_image_data()
 {
-    const int totalSamples = numXSamples * numYSamples;
-    finalImages = arma::cx_cube(numPulses, numXSamples, numYSamples);
-    finalCorrImages = arma::cx_cube(numPulses, numXSamples, numYSamples);
+    if (precision == precision_types::SINGLE)
+    {
+        return compute_image_data<float>();
+    }
+    return compute_image_data<double>();
+}
+
+template <typename T>
+int ph_mstar_corr_bp::compute_image_data()
+{
+    stopwatch timer;
+    finalImages = chip_stack<arma::cx_double>(numXSamples, numYSamples, numPulses);
+    finalCorrImages = chip_stack<arma::cx_double>(numXSamples, numYSamples, numPulses);
+    int outerThreads, innerThreads;
+    chip_split(outerThreads, innerThreads);
+
+    // Each chip is a task; its pulse loop opens a nested team of innerThreads.
+    const int maxActiveLevels = omp_get_max_active_levels();
+    omp_set_max_active_levels(2);
+#pragma omp parallel num_threads(outerThreads)
+#pragma omp single
     for (int i = 0; i < numPulses; i++)
     {
-        const double freqStepSize = frequencyStepSize.at(i);
-        const double rangeExtent = c / (2 * freqStepSize);
-        arma::cx_mat phaseSlice = phase.row(i);
-        const int numFreqBins = phaseSlice.n_rows;
-        const int numPhasePulses = phase.n_cols;
-        const int fftSampleCount = 4 * numPhasePulses;
-        arma::mat pixelXSlice = pixelX.row(i);
-        arma::mat pixelYSlice = pixelY.row(i);
-        arma::mat pixelZSlice = pixelZ.row(i);
-        arma::vec rangeProfile = arma::linspace(-fftSampleCount / 2,fftSampleCount / 2 - 1, fftSampleCount) * rangeExtent / fftSampleCount;
-        arma::cx_mat finalImageBuffer(numPhasePulses, totalSamples);
-#pragma omp parallel for
-        for (int j = 0; j < numPhasePulses; j++)
+#pragma omp task firstprivate(i)
         {
-            const double minFreq = freqMin.at(i, j);
-            const arma::cx_double phaseCorrConstant(0.0, -4.0 * minFreq * pi / c);
-            const arma::cx_vec rc = cx_fftshift(arma::ifft(phaseSlice.col(j), fftSampleCount));
-            const double antennaElevation = antElev.at(i, j) * radian;
-            const double antennaAzimuth = antAzim.at(i, j) * radian;
-            const arma::mat& dRData = pixelXSlice * cos(antennaElevation) * cos(antennaAzimuth)
-                + pixelYSlice * cos(antennaElevation) * sin(antennaAzimuth)
-                + pixelZSlice * sin(antennaElevation);
-            const arma::uvec& index = arma::find((dRData > arma::min(rangeProfile)) % (dRData < arma::max(rangeProfile)));
-            const arma::vec& validDRData = dRData.elem(index);
-            arma::cx_mat phaseCorr = arma::exp(phaseCorrConstant * dRData);
-            arma::mat interpReal;
-            arma::mat interpImag;
-            arma::interp1(rangeProfile, arma::real(rc), validDRData,interpReal);
-            arma::interp1(rangeProfile, arma::imag(rc), validDRData,interpImag);
-            arma::cx_mat finalImage = arma::cx_mat(interpReal, interpImag) % phaseCorr.elem(index);
-            for (int k = 0; k < index.n_elem; k++)
-            {
-                finalImageBuffer.at(j, index(k)) = finalImage(k);
-            }
+            omp_set_num_threads(innerThreads);
+            compute_chip<T>(i);
         }
+    }
+    omp_set_max_active_levels(maxActiveLevels);
 
-        finalImages.row(i) = arma::reshape(arma::sum(finalImageBuffer), numXSamples, numYSamples);
+    const long long milliseconds = std::max(timer.elapsed_milliseconds(), 1LL);
+    std::cout << "[Chips] " << numPulses << " chips as " << outerThreads << " x " << innerThreads << " threads: "
+        << 1000.0 * numPulses / milliseconds << " chips/s" << std::endl;
+    return 0;
+}
+
+void ph_mstar_corr_bp::chip_split(int& outerThreads, int& innerThreads) const
+{
+    const int budget = std::max(threadBudget > 0 ? threadBudget : omp_get_max_threads(), 1);
+    const int chips = std::max(numPulses, 1);
+    if (chipParallelism == chip_parallelism_modes::OUTER)
+    {
+        innerThreads = 1;
+    }
+    else if (chipParallelism == chip_parallelism_modes::INNER)
+    {
+        innerThreads = budget;
+    }
+    else
+    {
+        const double pixelPulses = static_cast<double>(numXSamples) * numYSamples * phase.chip_rows();
+        const int busyThreads = static_cast<int>(std::clamp(pixelPulses / minPixelPulsesPerThread, 1.0, static_cast<double>(budget)));
+
+        // With fewer chips than the budget can run at once, the spare threads go to each chip's pulse loop.
+        innerThreads = std::max(busyThreads, budget / chips);
+    }
+    outerThreads = std::clamp(budget / innerThreads, 1, chips);
+}
+
+template <typename T>
+void ph_mstar_corr_bp::compute_chip(const int chip)
+{
+    const int totalSamples = numXSamples * numYSamples;
+    const double freqStepSize = frequencyStepSize.at(chip);
+    const double rangeExtent = c / (2 * freqStepSize);
+    const arma::cx_mat& phaseSlice = phase.chip(chip);
+    const int numFreqBins = phaseSlice.n_rows;
+    const int numPhasePulses = phase.chip_rows();
+    const int fftSampleCount = 4 * numPhasePulses;
+    const arma::mat& pixelXSlice = pixelX.chip(chip);
+    const arma::mat& pixelYSlice = pixelY.chip(chip);
+    const arma::mat& pixelZSlice = pixelZ.chip(chip);
+    const arma::Col<T> rangeProfile = arma::conv_to<arma::Col<T>>::from(
+        arma::linspace(-fftSampleCount / 2,fftSampleCount / 2 - 1, fftSampleCount) * rangeExtent / fftSampleCount);
+    const arma::Mat<std::complex<T>> rangeProfiles = range_compress<T>(phaseSlice, fftSampleCount);
+    const phase_corrector phaseCorrector(phaseCorrectionMode, 4.0 * arma::max(freqMin.row(chip)) * pi / c, pixelXSlice.n_rows,
+        column_affine_residual(pixelXSlice) + column_affine_residual(pixelYSlice) + column_affine_residual(pixelZSlice),
+        arma::max(arma::max(arma::abs(pixelXSlice) + arma::abs(pixelYSlice) + arma::abs(pixelZSlice))), phaseTolerance,
+        std::numeric_limits<T>::epsilon());
+
+    const arma::vec elevation = arma::vectorise(antElev.row(chip)).head(numPhasePulses) * radian;
+    const arma::vec azimuth = arma::vectorise(antAzim.row(chip)).head(numPhasePulses) * radian;
+    arma::mat look(3, numPhasePulses);
+    look.row(0) = (arma::cos(elevation) % arma::cos(azimuth)).t();
+    look.row(1) = (arma::cos(elevation) % arma::sin(azimuth)).t();
+    look.row(2) = arma::sin(elevation).t();
+    const arma::vec wavenumbers = arma::vectorise(freqMin.row(chip)).head(numPhasePulses) * (-4.0 * pi / c);
+    const planar_geometry<T, true> geometry(pixelXSlice, pixelYSlice, pixelZSlice, look);
+    const back_projection_core<T, planar_geometry<T, true>> core(geometry, rangeProfile, rangeProfiles, phaseCorrector, wavenumbers);
+
+    if (correlationMode == correlation_modes::STREAMING)
+    {
+        streaming_accumulation accumulator(totalSamples);
+        core.run(accumulator);
+        finalImages.chip(chip) = arma::reshape(accumulator.total.sum, numXSamples, numYSamples);
         if (correlated)
         {
-            long long fftLength = numPhasePulses * 2 - 1;;
-            long long fftPaddedLength = pow(2, ceil(log2(fftLength)));
-            arma::cx_vec correlatedData(totalSamples);
-#pragma omp parallel for
-            for (int j = 0; j < totalSamples; j++)
-            {
-                const arma::cx_vec& tmpCol = finalImageBuffer.col(j);
-                const arma::cx_vec& tmpColConj = conj(tmpCol);
-                correlatedData.at(j) = arma::sum(ffftconv_cx(tmpCol, tmpColConj, fftPaddedLength)) - arma::sum(tmpCol % tmpColConj);
-            }
-            finalCorrImages.row(i) = arma::reshape(correlatedData, numXSamples, numYSamples);
+            finalCorrImages.chip(chip) = arma::cx_mat(arma::reshape(accumulator.total.correlated(), numXSamples, numYSamples),
+                arma::mat(numXSamples, numYSamples, arma::fill::zeros));
         }
+        return;
     }
-    return 0;
-}
 
-void ph_mstar_corr_bp::generic_run(const std::vector<std::string>& inputPaths, const std::string& savePath, const int from, const int to)
-{
-    for (int i = from; i < to; i++)
+    buffered_accumulation<T> accumulator(numPhasePulses, totalSamples);
+    core.run(accumulator);
+    const arma::Mat<std::complex<T>>& finalImageBuffer = accumulator.buffer;
+    finalImages.chip(chip) = arma::conv_to<arma::cx_mat>::from(arma::reshape(arma::sum(finalImageBuffer), numXSamples, numYSamples));
+    if (correlated)
     {
-        const std::string& path = inputPaths[i];
-        ph_mstar_corr_bp ph_mstar_corr_bp(path, true);
-        ph_mstar_corr_bp.load();
-        ph_mstar_corr_bp.get_image_data();
-        std::string parent, file, extension;
-        get_file_info(path, parent, file, extension);
-        save_data(ph_mstar_corr_bp.finalImages, savePath, file);
-        if (ph_mstar_corr_bp.correlated)
+        long long fftLength = numPhasePulses * 2 - 1;;
+        long long fftPaddedLength = pow(2, ceil(log2(fftLength)));
+        arma::cx_vec correlatedData(totalSamples);
+#pragma omp parallel for
+        for (int j = 0; j < totalSamples; j++)
         {
-            save_data(ph_mstar_corr_bp.finalCorrImages, savePath, file + "_Corr");
+            const arma::Col<std::complex<T>> tmpCol = finalImageBuffer.col(j);
+            const arma::Col<std::complex<T>> tmpColConj = arma::conj(tmpCol);
+            correlatedData.at(j) = arma::sum(ffftconv_cx(tmpCol, tmpColConj, fftPaddedLength)) - arma::sum(tmpCol % tmpColConj);
         }
-        std::cout << "Completed " << path << " (" << i << " / " << (to - from) << " : " << from << " - " << to << ")" << std::endl;
+        finalCorrImages.chip(chip) = arma::reshape(correlatedData, numXSamples, numYSamples);
     }
 }
 
+std::string ph_mstar_corr_bp::parameter_string() const
+{
+    std::ostringstream stream;
+    stream << base_correlated_back_projection::parameter_string() << " correlated=" << correlated
+        << " correlationMode=" << static_cast<int>(correlationMode);
+    return stream.str();
+}
+
+std::vector<int> ph_mstar_corr_bp::generic_run(const std::vector<std::string>& inputPaths, const std::string& savePath, const int from, const int to,
+    const output_modes outputMode, const output_encodings outputEncoding)
+{
+    return batch_run(inputPaths, from, to, create_imager, keptImages, savePath, "ph_mstar_corr_bp", outputMode, outputEncoding);
+}
+
+std::vector<int> ph_mstar_corr_bp::generic_run(const std::vector<std::string>& inputPaths, const std::string& savePath, work_queue& queue,
+    const output_modes outputMode, const output_encodings outputEncoding)
+{
+    return batch_run(inputPaths, queue, create_imager, keptImages, savePath, "ph_mstar_corr_bp", outputMode, outputEncoding);
+}
+
 int ph_mstar_corr_bp::clear()
 {
     numFftSamp.clear();
@@ -4,12 +4,21 @@
 #include "base_correlated_back_projection.h"
 #include <armadillo>
 
+#include "../chip_parallelism_modes.h"
+#include "../correlation_modes.h"
+#include "../output_encodings.h"
+#include "../output_modes.h"
+#include "../utils/work_queue.h"
+#include "../utils/chip_stack.h"
+
 
 class ph_mstar_corr_bp : public base_correlated_back_projection
 {
 public:
     bool correlated;
 
+    correlation_modes correlationMode;
+
     int numPulses;
 
     int numXSamples;
@@ -36,11 +45,11 @@ public:
 
     arma::mat freqMax;
 
-    arma::cube pixelX;
+    chip_stack<double> pixelX;
 
-    arma::cube pixelY;
+    chip_stack<double> pixelY;
 
-    arma::cube pixelZ;
+    chip_stack<double> pixelZ;
 
     arma::vec antX;
 
@@ -52,15 +61,17 @@ public:
 
     arma::mat antElev;
 
-    arma::cx_cube phase;
+    chip_stack<arma::cx_double> phase;
 
-    arma::cx_cube finalImages;
+    chip_stack<arma::cx_double> finalImages;
 
-    arma::cx_cube finalCorrImages;
+    chip_stack<arma::cx_double> finalCorrImages;
 
-    explicit ph_mstar_corr_bp(const std::string& dataPath, const bool correlated = true)
+    explicit ph_mstar_corr_bp(const std::string& dataPath, const bool correlated = true,
+        const correlation_modes correlationMode = correlation_modes::STREAMING)
     {
         this->correlated = correlated;
+        this->correlationMode = correlationMode;
         this->dataPath = dataPath;
     }
 
@@ -70,13 +81,45 @@ public:
 
     int clear() override;
 
-    static void generic_run(const std::vector<std::string>& inputPaths, const std::string& savePath, const int from, const int to);
+    std::string parameter_string() const override;
+
+    // Images inputPaths[from..to); returns the indices of the inputs that failed to load, image or save.
+    static std::vector<int> generic_run(const std::vector<std::string>& inputPaths, const std::string& savePath, const int from, const int to,
+        const output_modes outputMode = output_modes::FILES, const output_encodings outputEncoding = output_encodings::NATIVE);
+
+    // Images the inputs the queue hands this process, in one pipelined run; returns the indices of those that failed.
+    static std::vector<int> generic_run(const std::vector<std::string>& inputPaths, const std::string& savePath, work_queue& queue,
+        const output_modes outputMode = output_modes::FILES, const output_encodings outputEncoding = output_encodings::NATIVE);
 
     void set_azimuth_bounds(const int min, const int max)
     {
         minAzimuth = min;
         maxAzimuth = max;
     }
+
+    // A budget of 0 uses omp_get_max_threads().
+    void set_chip_parallelism(const chip_parallelism_modes mode, const int threadBudget = 0)
+    {
+        chipParallelism = mode;
+        this->threadBudget = threadBudget;
+    }
+
+    // Splits the thread budget into chips run at once (outer) and threads per chip (inner).
+    void chip_split(int& outerThreads, int& innerThreads) const;
+
+private:
+    // Below this many pixel-pulse evaluations per thread, a chip's own pulse loop does not keep its threads busy.
+    static constexpr double minPixelPulsesPerThread = 1 << 20;
+
+    chip_parallelism_modes chipParallelism = chip_parallelism_modes::AUTO;
+
+    int threadBudget = 0;
+
+    template <typename T>
+    int compute_image_data();
+
+    template <typename T>
+    void compute_chip(int chip);
 };
 
 
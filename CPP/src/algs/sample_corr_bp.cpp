@@ -1,32 +1,70 @@
 #include "sample_corr_bp.h"
+
+#include <algorithm>
+#include <omp.h>
+
+#include "back_projection_core.h"
 #include "../constants.h"
+#include "../utils/correlation_utils.h"
 #include "../utils/io_utils.h"
 #include "../utils/matrix_math.h"
+#include "../utils/phase_utils.h"
+#include "../utils/pipeline_utils.h"
+#include "../utils/stopwatch.h"
+
+namespace
+{
+    std::unique_ptr<sample_corr_bp> create_imager(const std::string& path)
+    {
+        return std::make_unique<sample_corr_bp>(path, true);
+    }
+
+    // The images a batch run keeps of each input.
+    const auto keptImages = [](const sample_corr_bp& imager, const auto& write)
+    {
+        write("image", "", imager.finalImage);
+        if (imager.correlated)
+        {
+            write("corr", "_Corr", imager.finalCorrImage);
+        }
+    };
+}
 
 int sample_corr_bp::load()
 {
-    const std::string& dataPath = this->dataPath;
-    load_data(numXSamples, dataPath, "numXSamples");
-    load_data(numYSamples, dataPath, "numYSamples");
-    load_data(centerX, dataPath, "centreX");
-    load_data(centerY, dataPath, "centreY");
-    load_data(sceneWidth, dataPath, "sceneWidth");
-    load_data(sceneHeight, dataPath, "sceneHeight");
-    load_data(minAzimuth, dataPath, "minAzim");
-    load_data(maxAzimuth, dataPath, "maxAzim");
-    load_data(frequencyStepSize, dataPath, "deltaF");
-    load_data(freqMin, dataPath, "minF");
-    load_data(freqMax, dataPath, "maxF");
-    load_data(pixelX, dataPath, "x_mat");
-    load_data(pixelY, dataPath, "y_mat");
-    load_data(pixelZ, dataPath, "z_mat");
-    load_data(antAzim, dataPath, "AntAzim");
-    load_data(antElev, dataPath, "AntElev");
-    load_data(phase, dataPath, "phdata");
-    return 0;
+    hdf5_reader reader(dataPath);
+    // Fields image formation does not use are read if present; only the rest must be.
+    reader.read(centerX, "centreX");
+    reader.read(centerY, "centreY");
+    reader.read(sceneWidth, "sceneWidth");
+    reader.read(sceneHeight, "sceneHeight");
+    reader.read(minAzimuth, "minAzim");
+    reader.read(maxAzimuth, "maxAzim");
+    reader.read(freqMax, "maxF");
+    const bool loaded = reader.read(numXSamples, "numXSamples")
+        && reader.read(numYSamples, "numYSamples")
+        && reader.read(frequencyStepSize, "deltaF")
+        && reader.read(freqMin, "minF")
+        && reader.read(pixelX, "x_mat")
+        && reader.read(pixelY, "y_mat")
+        && reader.read(pixelZ, "z_mat")
+        && reader.read(antAzim, "AntAzim")
+        && reader.read(antElev, "AntElev")
+        && reader.read(phase, "phdata");
+    return loaded ? 0 : -1;
 }
 
 int sample_corr_bp::get_image_data()
+{
+    if (precision == precision_types::SINGLE)
+    {
+        return compute_image_data<float>();
+    }
+    return compute_image_data<double>();
+}
+
+template <typename T>
+int sample_corr_bp::compute_image_data()
 {
     const int totalSamples = numXSamples * numYSamples;
     finalImage = arma::cx_mat(numXSamples, numYSamples);
@@ -36,34 +74,41 @@ int sample_corr_bp::get_image_data()
     const int numFreqBins = phase.n_rows;
     const int numPhasePulses = phase.n_cols;
     const int fftSampleCount = 4 * numPhasePulses;
-    arma::vec rangeProfile = arma::linspace(-fftSampleCount / 2,fftSampleCount / 2 - 1, fftSampleCount) * rangeExtent / fftSampleCount;
-    arma::cx_mat finalImageBuffer(numPhasePulses, totalSamples);
+    const arma::Col<T> rangeProfile = arma::conv_to<arma::Col<T>>::from(
+        arma::linspace(-fftSampleCount / 2,fftSampleCount / 2 - 1, fftSampleCount) * rangeExtent / fftSampleCount);
+    const arma::Mat<std::complex<T>> rangeProfiles = range_compress<T>(phase, fftSampleCount);
+    const phase_corrector phaseCorrector(phaseCorrectionMode, 4.0 * freqMin * pi / c, pixelX.n_rows,
+        column_affine_residual(pixelX) + column_affine_residual(pixelY) + column_affine_residual(pixelZ),
+        arma::max(arma::max(arma::abs(pixelX) + arma::abs(pixelY) + arma::abs(pixelZ))), phaseTolerance,
+        std::numeric_limits<T>::epsilon());
 
-#pragma omp parallel for
-    for (int j = 0; j < numPhasePulses; j++)
+    const arma::vec elevation = antElev.head(numPhasePulses) * radian;
+    const arma::vec azimuth = antAzim.head(numPhasePulses) * radian;
+    arma::mat look(3, numPhasePulses);
+    look.row(0) = (arma::cos(elevation) % arma::cos(azimuth)).t();
+    look.row(1) = (arma::cos(elevation) % arma::sin(azimuth)).t();
+    look.row(2) = arma::sin(elevation).t();
+    const arma::vec wavenumbers = arma::ones<arma::vec>(numPhasePulses) * (-4.0 * freqMin * pi / c);
+    const planar_geometry<T, true> geometry(pixelX, pixelY, pixelZ, look);
+    const back_projection_core<T, planar_geometry<T, true>> core(geometry, rangeProfile, rangeProfiles, phaseCorrector, wavenumbers);
+
+    if (correlationMode == correlation_modes::STREAMING)
     {
-        const arma::cx_double phaseCorrConstant(0.0, -4.0 * freqMin * pi / c);
-        const arma::cx_vec rc = cx_fftshift(arma::ifft(phase.col(j), fftSampleCount));
-        const double antennaElevation = antElev.at(j) * radian;
-        const double antennaAzimuth = antAzim.at(j) * radian;
-        const arma::mat& dRData = pixelX * cos(antennaElevation) * cos(antennaAzimuth)
-            + pixelY * cos(antennaElevation) * sin(antennaAzimuth)
-            + pixelZ * sin(antennaElevation);
-        const arma::uvec& index = arma::find((dRData > arma::min(rangeProfile)) % (dRData < arma::max(rangeProfile)));
-        const arma::vec& validDRData = dRData.elem(index);
-        arma::cx_mat phaseCorr = arma::exp(phaseCorrConstant * dRData);
-        arma::mat interpReal;
-        arma::mat interpImag;
-        arma::interp1(rangeProfile, arma::real(rc), validDRData,interpReal);
-        arma::interp1(rangeProfile, arma::imag(rc), validDRData,interpImag);
-        arma::cx_mat finalImage = arma::cx_mat(interpReal, interpImag) % phaseCorr.elem(index);
-        for (int k = 0; k < index.n_elem; k++)
+        streaming_accumulation accumulator(totalSamples);
+        core.run(accumulator);
+        finalImage = arma::reshape(accumulator.total.sum, numXSamples, numYSamples);
+        if (correlated)
         {
-            finalImageBuffer.at(j, index(k)) = finalImage(k);
+            finalCorrImage = arma::cx_mat(arma::reshape(accumulator.total.correlated(), numXSamples, numYSamples),
+                arma::mat(numXSamples, numYSamples, arma::fill::zeros));
         }
+        return 0;
     }
 
-    finalImage = arma::reshape(arma::sum(finalImageBuffer), numXSamples, numYSamples);
+    buffered_accumulation<T> accumulator(numPhasePulses, totalSamples);
+    core.run(accumulator);
+    const arma::Mat<std::complex<T>>& finalImageBuffer = accumulator.buffer;
+    finalImage = arma::conv_to<arma::cx_mat>::from(arma::reshape(arma::sum(finalImageBuffer), numXSamples, numYSamples));
     if (correlated)
     {
         const long long fftLength = numPhasePulses * 2 - 1;;
@@ -72,8 +117,8 @@ int sample_corr_bp::get_image_data()
 #pragma omp parallel for
         for (int j = 0; j < totalSamples; j++)
         {
-            const arma::cx_vec& tmpCol = finalImageBuffer.col(j);
-            const arma::cx_vec& tmpColConj = conj(tmpCol);
+            const arma::Col<std::complex<T>> tmpCol = finalImageBuffer.col(j);
+            const arma::Col<std::complex<T>> tmpColConj = arma::conj(tmpCol);
             correlatedData.at(j) = arma::sum(ffftconv_cx(tmpCol, tmpColConj, fftPaddedLength)) - arma::sum(tmpCol % tmpColConj);
         }
         finalCorrImage = arma::reshape(correlatedData, numXSamples, numYSamples);
@@ -81,23 +126,118 @@ int sample_corr_bp::get_image_data()
     return 0;
 }
 
-void sample_corr_bp::generic_run(const std::vector<std::string>& inputPaths, const std::string& savePath, const int from, const int to)
+std::string sample_corr_bp::parameter_string() const
+{
+    std::ostringstream stream;
+    stream << base_correlated_back_projection::parameter_string() << " correlated=" << correlated
+        << " correlationMode=" << static_cast<int>(correlationMode);
+    return stream.str();
+}
+
+std::vector<int> sample_corr_bp::generic_run(const std::vector<std::string>& inputPaths, const std::string& savePath, const int from, const int to,
+    const output_modes outputMode, const output_encodings outputEncoding)
+{
+    return batch_run(inputPaths, from, to, create_imager, keptImages, savePath, "sample_corr_bp", outputMode, outputEncoding);
+}
+
+std::vector<int> sample_corr_bp::generic_run(const std::vector<std::string>& inputPaths, const std::string& savePath, work_queue& queue,
+    const output_modes outputMode, const output_encodings outputEncoding)
+{
+    return batch_run(inputPaths, queue, create_imager, keptImages, savePath, "sample_corr_bp", outputMode, outputEncoding);
+}
+
+int sample_corr_bp::compare_precision(const std::string& dataPath)
+{
+    sample_corr_bp reference(dataPath, true);
+    reference.load();
+    stopwatch timer;
+    reference.get_image_data();
+    const long long doubleMilliseconds = timer.elapsed_milliseconds();
+
+    sample_corr_bp single(dataPath, true);
+    single.set_precision(precision_types::SINGLE);
+    single.load();
+    timer.restart();
+    single.get_image_data();
+    const long long singleMilliseconds = timer.elapsed_milliseconds();
+
+    const double imageError = arma::norm(arma::vectorise(single.finalImage - reference.finalImage))
+        / arma::norm(arma::vectorise(reference.finalImage));
+    const double correlatedError = arma::norm(arma::vectorise(single.finalCorrImage - reference.finalCorrImage))
+        / arma::norm(arma::vectorise(reference.finalCorrImage));
+    std::cout << "[Precision] " << dataPath << std::endl;
+    std::cout << "    double: " << doubleMilliseconds << " ms, single: " << singleMilliseconds << " ms" << std::endl;
+    std::cout << "    relative error of image: " << imageError << ", of correlated image: " << correlatedError << std::endl;
+    return 0;
+}
+
+double sample_corr_bp::correlation_mode_error(const sample_corr_bp& loaded)
+{
+    sample_corr_bp streaming = loaded;
+    streaming.correlated = true;
+    streaming.correlationMode = correlation_modes::STREAMING;
+    stopwatch timer;
+    streaming.get_image_data();
+    const long long streamingMilliseconds = timer.elapsed_milliseconds();
+
+    sample_corr_bp buffered = loaded;
+    buffered.correlated = true;
+    buffered.correlationMode = correlation_modes::BUFFERED;
+    timer.restart();
+    buffered.get_image_data();
+    const long long bufferedMilliseconds = timer.elapsed_milliseconds();
+
+    const double error = arma::norm(arma::vectorise(streaming.finalCorrImage - buffered.finalCorrImage))
+        / arma::norm(arma::vectorise(buffered.finalCorrImage));
+    std::cout << "    streaming: " << streamingMilliseconds << " ms, buffered: " << bufferedMilliseconds << " ms" << std::endl;
+    std::cout << "    relative error of correlated image: " << error << std::endl;
+    return error;
+}
+
+int sample_corr_bp::compare_correlation_modes(const std::string& dataPath)
+{
+    sample_corr_bp imager(dataPath, true);
+    if (imager.load() != 0)
+    {
+        std::cout << "[Error] compare_correlation_modes failed for <" << dataPath << ">: data loading." << std::endl;
+        return -1;
+    }
+
+    std::cout << "[Correlation] " << dataPath << std::endl;
+    correlation_mode_error(imager);
+    return 0;
+}
+
+int sample_corr_bp::scaling_report(const std::string& dataPath, const int maxThreads)
 {
-    for (int i = from; i < to; i++)
+    sample_corr_bp imager(dataPath, true);
+    if (imager.load() != 0)
+    {
+        std::cout << "[Error] scaling_report failed for <" << dataPath << ">: data loading." << std::endl;
+        return -1;
+    }
+
+    const int defaultThreads = omp_get_max_threads();
+    std::cout << "[Scaling] " << dataPath << std::endl;
+    for (const correlation_modes mode : {correlation_modes::STREAMING, correlation_modes::BUFFERED})
     {
-        const std::string& path = inputPaths[i];
-        sample_corr_bp ph_mstar_corr_bp(path, true);
-        ph_mstar_corr_bp.load();
-        ph_mstar_corr_bp.get_image_data();
-        std::string parent, file, extension;
-        get_file_info(path, parent, file, extension);
-        save_data(ph_mstar_corr_bp.finalImage, savePath, file);
-        if (ph_mstar_corr_bp.correlated)
+        imager.correlationMode = mode;
+        long long baseMilliseconds = 0;
+        std::cout << "  " << (mode == correlation_modes::STREAMING ? "streaming" : "buffered") << " correlation" << std::endl;
+        for (int threads = 1; threads <= maxThreads; threads *= 2)
         {
-            save_data(ph_mstar_corr_bp.finalCorrImage, savePath, file + "_Corr");
+            omp_set_num_threads(threads);
+            stopwatch timer;
+            imager.get_image_data();
+            const long long milliseconds = std::max(timer.elapsed_milliseconds(), 1LL);
+            baseMilliseconds = threads == 1 ? milliseconds : baseMilliseconds;
+            const double speedup = static_cast<double>(baseMilliseconds) / static_cast<double>(milliseconds);
+            std::cout << "    " << threads << " threads: " << milliseconds << " ms, speedup " << speedup
+                << ", efficiency " << speedup / threads << std::endl;
         }
-        std::cout << "Completed " << path << " (" << i << " / " << (to - from) << " : " << from << " - " << to << ")" << std::endl;
     }
+    omp_set_num_threads(defaultThreads);
+    return 0;
 }
 
 int sample_corr_bp::clear()
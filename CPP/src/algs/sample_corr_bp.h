@@ -4,12 +4,19 @@
 #include "base_correlated_back_projection.h"
 #include <armadillo>
 
+#include "../correlation_modes.h"
+#include "../output_encodings.h"
+#include "../output_modes.h"
+#include "../utils/work_queue.h"
+
 
 class sample_corr_bp : public base_correlated_back_projection
 {
 public:
     bool correlated;
 
+    correlation_modes correlationMode;
+
     int numPulses;
 
     int numXSamples;
@@ -52,9 +59,11 @@ public:
 
     arma::cx_mat finalCorrImage;
 
-    explicit sample_corr_bp(const std::string& dataPath, const bool correlated = true)
+    explicit sample_corr_bp(const std::string& dataPath, const bool correlated = true,
+        const correlation_modes correlationMode = correlation_modes::STREAMING)
     {
         this->correlated = correlated;
+        this->correlationMode = correlationMode;
         this->dataPath = dataPath;
     }
 
@@ -64,7 +73,33 @@ public:
 
     int clear() override;
 
-    static void generic_run(const std::vector<std::string>& inputPaths, const std::string& savePath, const int from, const int to);
+    std::string parameter_string() const override;
+
+    // Images inputPaths[from..to); returns the indices of the inputs that failed to load, image or save.
+    static std::vector<int> generic_run(const std::vector<std::string>& inputPaths, const std::string& savePath, const int from, const int to,
+        const output_modes outputMode = output_modes::FILES, const output_encodings outputEncoding = output_encodings::NATIVE);
+
+    // Images the inputs the queue hands this process, in one pipelined run; returns the indices of those that failed.
+    static std::vector<int> generic_run(const std::vector<std::string>& inputPaths, const std::string& savePath, work_queue& queue,
+        const output_modes outputMode = output_modes::FILES, const output_encodings outputEncoding = output_encodings::NATIVE);
+
+    // Images dataPath in double and in single precision, and prints the run times and the relative difference of the images.
+    static int compare_precision(const std::string& dataPath);
+
+    // Images a loaded imager in the STREAMING and the BUFFERED correlation modes, prints their run times and
+    // returns the relative difference of the correlated images. BUFFERED is the original FFT computation.
+    static double correlation_mode_error(const sample_corr_bp& loaded);
+
+    // Loads dataPath and reports correlation_mode_error for it.
+    static int compare_correlation_modes(const std::string& dataPath);
+
+    // Images dataPath with 1, 2, 4, ... maxThreads threads, in both correlation modes, and prints the run time, speedup
+    // over one thread and parallel efficiency of each.
+    static int scaling_report(const std::string& dataPath, const int maxThreads = 64);
+
+private:
+    template <typename T>
+    int compute_image_data();
 };
 
 
@@ -3,40 +3,72 @@
 #include <armadillo>
 #include <iostream>
 
+#include "back_projection_core.h"
 #include "../constants.h"
+#include "../utils/correlation_utils.h"
 #include "../utils/io_utils.h"
 #include "../utils/matrix_math.h"
+#include "../utils/phase_utils.h"
+#include "../utils/pipeline_utils.h"
 #include "../utils/stopwatch.h"
 
+namespace
+{
+    std::unique_ptr<target_cp_corr_bp> create_imager(const std::string& path)
+    {
+        return std::make_unique<target_cp_corr_bp>(path, 4, 160, 160, 0, 0);
+    }
+
+    // The images a batch run keeps of each input.
+    const auto keptImages = [](const target_cp_corr_bp& target, const auto& write)
+    {
+        write("image", "", target.imageData);
+        if (target.correlated)
+        {
+            write("corr", "_Corr", target.correlatedImageData);
+        }
+    };
+}
+
 int target_cp_corr_bp::load()
 {
-    const std::string& dataPath = this->dataPath;
-    load_data(antX, dataPath, "x");
-    load_data(antY, dataPath, "y");
+    hdf5_reader reader(dataPath);
+    if (!reader.read(antX, "x") || !reader.read(antY, "y") || antX.is_empty())
+    {
+        return -1;
+    }
     azim = normalise(unwrap(arma::vectorise(arma::atan2(antY, antX))));
-    load_data(antZ, dataPath, "z");
-    load_data(radius, dataPath, "r0");
-    load_data(frequencyGHz, dataPath, "freq");
+
+    // The azimuth comes from the whole track, but only the pulses inside its bounds are read from here on.
+    const arma::uvec azimuthSelector = azimuth_selector();
+    azim = azim.elem(azimuthSelector);
+    antX = antX.elem(azimuthSelector);
+    antY = antY.elem(azimuthSelector);
+    const bool loaded = reader.read_selection(antZ, "z", azimuthSelector)
+        && reader.read_selection(radius, "r0", azimuthSelector)
+        && reader.read(frequencyGHz, "freq")
+        && reader.read_selection(phase, "fq", azimuthSelector)
+        && reader.read(sceneSize, "sceneSize");
     frequencyGHz = frequencyGHz.t() / 1e9;
-    load_data(phase, dataPath, "fq");
-    load_data(sceneSize, dataPath, "sceneSize");
-    return 0;
+    return loaded ? 0 : -1;
 }
 
 int target_cp_corr_bp::get_image_data()
+{
+    if (precision == precision_types::SINGLE)
+    {
+        return compute_image_data<float>();
+    }
+    return compute_image_data<double>();
+}
+
+template <typename T>
+int target_cp_corr_bp::compute_image_data()
 {
     stopwatch timer = stopwatch();
 
     int numSamples = numXSamples * numYSamples;
-    arma::uvec azimuthSelector;
-    if (minAzimuth > maxAzimuth)
-    {
-        azimuthSelector = arma::find((azim >= minAzimuth) || (azim <= maxAzimuth));
-    }
-    else
-    {
-        azimuthSelector = arma::find((azim >= minAzimuth) % (azim <= maxAzimuth));
-    }
+    const arma::uvec azimuthSelector = azimuth_selector();
     const arma::vec& validAzimuth = azim.elem(azimuthSelector);
     const arma::cx_mat& validPolarized = phase.cols(azimuthSelector).eval();
     unsigned long numPulse = validPolarized.n_cols;
@@ -52,44 +84,42 @@ int target_cp_corr_bp::get_image_data()
     double deltaFrequency = arma::diff(frequencyGHz.rows(0, 1)).eval()[0] * 1e9;
 
     double maxWr = c / (2 * deltaFrequency);
-    const arma::mat& range = arma::linspace(-numFftSamples / 2.0, numFftSamples / 2.0 - 1, numFftSamples) * maxWr / numFftSamples;
-    double rangeMin = arma::min(range).eval()[0];
-    double rangeMax =  arma::max(range).eval()[0];
+    const arma::Col<T> range = arma::conv_to<arma::Col<T>>::from(
+        arma::linspace(-numFftSamples / 2.0, numFftSamples / 2.0 - 1, numFftSamples) * maxWr / numFftSamples);
 
     double minimumFrequency = arma::min(frequencyGHz).eval()[0] * 1e9;
-    arma::cx_double phaseCorrConstant(0.0, 4.0 * minimumFrequency * pi / c);
-
-    arma::cx_mat tmp(numPulse, numSamples);
-
-#pragma omp parallel for
-    for (int i = 0; i < numPulse; i++)
+    const double wavenumber = 4.0 * minimumFrequency * pi / c;
+
+    const arma::Mat<std::complex<T>> rangeProfiles = range_compress<T>(phase.head_cols(numPulse), numFftSamples);
+
+    // The wavefront is spherical, so the phase is always evaluated exactly, and only for pixels inside the range gate.
+    const phase_corrector phaseCorrector(phase_correction_modes::EXACT);
+    arma::mat antenna(3, numPulse);
+    antenna.row(0) = arma::vectorise(antX).head(numPulse).t();
+    antenna.row(1) = arma::vectorise(antY).head(numPulse).t();
+    antenna.row(2) = arma::vectorise(antZ).head(numPulse).t();
+    const arma::vec referenceRanges = arma::vectorise(radius).head(numPulse);
+    const arma::vec wavenumbers = arma::ones<arma::vec>(numPulse) * wavenumber;
+    const spherical_geometry<T> geometry(xGrid, yGrid, antenna, referenceRanges);
+    const back_projection_core<T, spherical_geometry<T>> core(geometry, range, rangeProfiles, phaseCorrector, wavenumbers);
+
+    if (correlationMode == correlation_modes::STREAMING)
     {
-        const arma::mat& dRData = arma::sqrt(arma::square(antX(i) * arma::ones(numXSamples, numYSamples) - xGrid)
-            + arma::square(antY(i) * arma::ones(numXSamples, numYSamples) - yGrid)
-            + arma::square(antZ(i) * arma::ones(numXSamples, numYSamples))) - radius(i) * arma::ones(numXSamples, numYSamples);
-
-        const arma::uvec& index = arma::find((dRData > rangeMin) % (dRData < rangeMax));
-        const arma::vec& validDRData = dRData.elem(index);
-
-        arma::cx_vec timeData = cx_fftshift(arma::ifft(phase.col(i), numFftSamples));
-
-        // The dual linear interpolations are currently the biggest bottleneck, representing ~60% of execution time.
-        arma::vec interpResultsReal;
-        arma::vec interpResultsImag;
-        arma::interp1(range, arma::real(timeData), validDRData, interpResultsReal);
-        arma::interp1(range, arma::imag(timeData), validDRData, interpResultsImag);
-
-        // Transposing accumulates to ~9% of the execution time here.
-        // Ideally, this could be avoided if Armadillo didn't make the distinction between row and column vectors.
-        arma::cx_mat phaseCorr = arma::exp(phaseCorrConstant * dRData);
-        arma::cx_mat tmpValue = arma::cx_vec(interpResultsReal, interpResultsImag) % phaseCorr.elem(index);
-        for (int j = 0; j < index.n_elem; j++)
+        streaming_accumulation accumulator(numSamples);
+        core.run(accumulator);
+        imageData = arma::reshape(arma::real(accumulator.total.sum), numXSamples, numYSamples);
+        if (correlated)
         {
-            tmp.at(i, index(j)) = tmpValue(j);
+            correlatedImageData = arma::reshape(accumulator.total.correlated(), numXSamples, numYSamples);
         }
+        std::cout << "Successfully generated image data: " << timer.elapsed_milliseconds() << " ms elapsed" << std::endl;
+        return 0;
     }
 
-    imageData = arma::reshape(arma::real(arma::sum(tmp)), numXSamples, numYSamples);
+    buffered_accumulation<T> accumulator(numPulse, numSamples);
+    core.run(accumulator);
+    const arma::Mat<std::complex<T>>& tmp = accumulator.buffer;
+    imageData = arma::conv_to<arma::mat>::from(arma::reshape(arma::real(arma::sum(tmp)), numXSamples, numYSamples));
     if (correlated)
     {
         long long fftLength = numPulse * 2 - 1;;
@@ -98,8 +128,8 @@ int target_cp_corr_bp::get_image_data()
 #pragma omp parallel for
         for (int j = 0; j < numSamples; j++)
         {
-            const arma::cx_vec& tmpCol = tmp.col(j);
-            const arma::cx_vec& tmpColConj = conj(tmpCol);
+            const arma::Col<std::complex<T>> tmpCol = tmp.col(j);
+            const arma::Col<std::complex<T>> tmpColConj = arma::conj(tmpCol);
             convResults.at(j) = arma::sum(ffftconv(tmpCol, tmpColConj, fftPaddedLength)) - arma::sum(tmpCol % tmpColConj).real();
         }
         correlatedImageData = arma::reshape(convResults, numXSamples, numYSamples);
@@ -108,27 +138,26 @@ int target_cp_corr_bp::get_image_data()
     return 0;
 }
 
-void target_cp_corr_bp::generic_run(const std::vector<std::string>& inputPaths, const std::string& savePath, const int from, const int to)
+std::string target_cp_corr_bp::parameter_string() const
 {
-    for (int i = from; i < to; i++)
-    {
-        const std::string& path = inputPaths[i];
-        std::string parent, file, extension;
-        get_file_info(path, parent, file, extension);
-        target_cp_corr_bp target(path, 4, 160, 160, 0, 0);
-        if (target.load() != 0)
-        {
-            std::cout << "[Error] gen_target_cp failed for <" << path << ">: data loading." << std::endl;
-            return;
-        }
-        target.get_image_data();
-        target.save_image_data(savePath, file);
-        if (target.correlated)
-        {
-            save_data(target.correlatedImageData, savePath, file + "_Corr");
-        }
-        std::cout << "Completed " << path << " (" << i << " / " << (to - from) << " : " << from << " - " << to << ")" << std::endl;
-    }
+    std::ostringstream stream;
+    stream << base_correlated_back_projection::parameter_string() << " correlated=" << correlated
+        << " correlationMode=" << static_cast<int>(correlationMode) << " fftSamplingFactor=" << fftSamplingFactor
+        << " samples=" << numXSamples << "x" << numYSamples << " centre=" << centerX << "," << centerY
+        << " azimuth=" << minAzimuth << "-" << maxAzimuth;
+    return stream.str();
+}
+
+std::vector<int> target_cp_corr_bp::generic_run(const std::vector<std::string>& inputPaths, const std::string& savePath, const int from, const int to,
+    const output_modes outputMode, const output_encodings outputEncoding)
+{
+    return batch_run(inputPaths, from, to, create_imager, keptImages, savePath, "target_cp_corr_bp", outputMode, outputEncoding);
+}
+
+std::vector<int> target_cp_corr_bp::generic_run(const std::vector<std::string>& inputPaths, const std::string& savePath, work_queue& queue,
+    const output_modes outputMode, const output_encodings outputEncoding)
+{
+    return batch_run(inputPaths, queue, create_imager, keptImages, savePath, "target_cp_corr_bp", outputMode, outputEncoding);
 }
 
 int target_cp_corr_bp::clear()
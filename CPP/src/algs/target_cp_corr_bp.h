@@ -4,25 +4,32 @@
 
 #include <armadillo>
 
+#include "../correlation_modes.h"
+#include "../output_encodings.h"
+#include "../output_modes.h"
+#include "../utils/work_queue.h"
+
 
 class target_cp_corr_bp : public base_correlated_back_projection
 {
     public:
+        correlation_modes correlationMode;
+
         int numXSamples;
 
         int numYSamples;
 
         int fftSamplingFactor;
 
-        float centerX;
+        double centerX;
 
-        float centerY;
+        double centerY;
 
         double sceneSize;
 
-        float minAzimuth;
+        double minAzimuth;
 
-        float maxAzimuth;
+        double maxAzimuth;
 
         arma::cx_mat phase;
 
@@ -42,7 +49,8 @@ class target_cp_corr_bp : public base_correlated_back_projection
 
         target_cp_corr_bp(const std::string &dataPath,
             const int fftSamplingFactor, const int numXSamp, const int numYSamp,
-            const float centerX, const float centerY, const bool correlated = true)
+            const double centerX, const double centerY, const bool correlated = true,
+            const correlation_modes correlationMode = correlation_modes::STREAMING)
         {
             this->dataPath = dataPath;
             this->minAzimuth = 0;
@@ -54,6 +62,7 @@ class target_cp_corr_bp : public base_correlated_back_projection
             this->centerY = centerY;
             this->sceneSize = 10;
             this->correlated = correlated;
+            this->correlationMode = correlationMode;
         }
 
         int load() override;
@@ -62,13 +71,36 @@ class target_cp_corr_bp : public base_correlated_back_projection
 
         int clear() override;
 
-        static void generic_run(const std::vector<std::string>& inputPaths, const std::string& savePath, const int from, const int to);
+        std::string parameter_string() const override;
+
+        // Images inputPaths[from..to); returns the indices of the inputs that failed to load, image or save.
+        static std::vector<int> generic_run(const std::vector<std::string>& inputPaths, const std::string& savePath, const int from, const int to,
+            const output_modes outputMode = output_modes::FILES, const output_encodings outputEncoding = output_encodings::NATIVE);
+
+        // Images the inputs the queue hands this process, in one pipelined run; returns the indices of those that failed.
+        static std::vector<int> generic_run(const std::vector<std::string>& inputPaths, const std::string& savePath, work_queue& queue,
+            const output_modes outputMode = output_modes::FILES, const output_encodings outputEncoding = output_encodings::NATIVE);
 
+        // Set before load(), which reads only the pulses inside the bounds.
         void set_azimuth_bounds(const int min, const int max)
         {
             minAzimuth = min;
             maxAzimuth = max;
         }
+
+        // Pulses inside the azimuth bounds, which wrap through 0 when minAzimuth > maxAzimuth.
+        arma::uvec azimuth_selector() const
+        {
+            if (minAzimuth > maxAzimuth)
+            {
+                return arma::find((azim >= minAzimuth) || (azim <= maxAzimuth));
+            }
+            return arma::find((azim >= minAzimuth) % (azim <= maxAzimuth));
+        }
+
+    private:
+        template <typename T>
+        int compute_image_data();
 };
 
 
@@ -0,0 +1,259 @@
+#include "target_cp_omega_k.h"
+
+#include <armadillo>
+#include <cmath>
+#include <iostream>
+
+#include "../constants.h"
+#include "../utils/fft_utils.h"
+#include "../utils/io_utils.h"
+#include "../utils/matrix_math.h"
+#include "../utils/pipeline_utils.h"
+#include "../utils/stopwatch.h"
+
+namespace
+{
+    std::unique_ptr<target_cp_omega_k> create_imager(const std::string& path)
+    {
+        return std::make_unique<target_cp_omega_k>(path, 4, 160, 160, 0, 0);
+    }
+
+    // The images a batch run keeps of each input.
+    const auto keptImages = [](const target_cp_omega_k& target, const auto& write)
+    {
+        write("image", "", target.imageData);
+        if (target.correlated)
+        {
+            write("power", "_Power", target.powerImageData);
+        }
+    };
+}
+
+int target_cp_omega_k::get_image_data()
+{
+    stopwatch timer = stopwatch();
+    const arma::uvec azimuthSelector = azimuth_selector();
+    const long long numPulse = azimuthSelector.n_elem;
+    const long long numFreq = phase.n_rows;
+    if (numPulse < 2 || numFreq < 2)
+    {
+        std::cout << "[Error] target_cp_omega_k needs at least two pulses and two frequencies." << std::endl;
+        return -1;
+    }
+
+    const arma::vec wavenumber = arma::vectorise(frequencyGHz).head(numFreq) * 1e9 * 4.0 * pi / c;
+    const double wavenumberMin = wavenumber(0);
+    const double wavenumberMax = wavenumber(numFreq - 1);
+    const double wavenumberStep = (wavenumberMax - wavenumberMin) / static_cast<double>(numFreq - 1);
+
+    /*----- Track: a straight line, sampled uniformly, along which the pulses are ordered -----*/
+    arma::mat positions(3, numPulse);
+    positions.row(0) = arma::vectorise(antX.elem(azimuthSelector)).t();
+    positions.row(1) = arma::vectorise(antY.elem(azimuthSelector)).t();
+    positions.row(2) = arma::vectorise(antZ.elem(azimuthSelector)).t();
+    arma::vec direction = positions.col(numPulse - 1) - positions.col(0);
+    direction /= arma::norm(direction);
+    const arma::vec alongFirst = (positions.each_col() - positions.col(0)).t() * direction;
+    const arma::uvec order = arma::sort_index(alongFirst);
+    const arma::vec origin = positions.col(0) + alongFirst(order(0)) * direction;
+    const arma::vec along = arma::sort(alongFirst) - alongFirst(order(0));
+    const double alongStep = along(numPulse - 1) / static_cast<double>(numPulse - 1);
+
+    double trackError = 0;
+    for (long long i = 0; i < numPulse; i++)
+    {
+        const arma::vec offset = positions.col(order(i)) - origin - along(i) * direction;
+        trackError = std::max({trackError, arma::norm(offset), std::abs(along(i) - i * alongStep)});
+    }
+    const double trackTolerance = trackToleranceWavelengths * 4.0 * pi / wavenumberMax;
+    if (trackError > trackTolerance)
+    {
+        std::cout << "[Error] target_cp_omega_k needs a straight, uniformly sampled track: pulses depart from it by "
+            << trackError << " m, above the " << trackTolerance << " m tolerance; use target_cp_corr_bp instead." << std::endl;
+        return -1;
+    }
+
+    // Pixels lie on z = 0 and are described by their along-track position and their distance from the track.
+    arma::mat xGrid;
+    arma::mat yGrid;
+    mesh_grid(xGrid, yGrid,
+        arma::linspace(centerX - sceneSize / 2, centerX + sceneSize / 2, numXSamples),
+        arma::linspace(centerY - sceneSize / 2, centerY + sceneSize / 2, numYSamples));
+    auto track_coordinates = [&](const double x, const double y, double& alongTrack, double& distance)
+    {
+        const arma::vec offset = arma::vec{x, y, 0.0} - origin;
+        alongTrack = arma::dot(offset, direction);
+        distance = arma::norm(offset - alongTrack * direction);
+    };
+    double centreAlong, referenceDistance;
+    track_coordinates(centerX, centerY, centreAlong, referenceDistance);
+
+    /*----- Along-track FFT of the data with the motion compensation to r0 removed -----*/
+    const double sceneDiagonal = sceneSize * std::sqrt(2.0);
+    long long alongLength = numPulse + static_cast<long long>(std::ceil(sceneDiagonal / alongStep));
+    alongLength += alongLength % 2;
+    arma::cx_mat spectrum(alongLength, numFreq, arma::fill::zeros);
+#pragma omp parallel for
+    for (long long i = 0; i < numPulse; i++)
+    {
+        const unsigned long long pulse = azimuthSelector(order(i));
+        for (long long n = 0; n < numFreq; n++)
+        {
+            spectrum(i, n) = phase(n, pulse) * std::polar(1.0, -wavenumber(n) * radius(pulse));
+        }
+    }
+    fft_plan_cache::instance().execute_many(spectrum.memptr(), spectrum.memptr(), alongLength, numFreq, FFTW_FORWARD);
+
+    // The along-track band is centred on the spatial frequency the scene centre is seen at from mid-track.
+    const double alongKStep = 2 * pi / (alongLength * alongStep);
+    const double midOffset = along(numPulse - 1) / 2 - centreAlong;
+    const double centreAlongK = -0.5 * (wavenumberMin + wavenumberMax) * midOffset / std::hypot(midOffset, referenceDistance);
+    const long long centreBin = std::llround(centreAlongK / alongKStep);
+    const long long firstBin = centreBin - alongLength / 2;
+    const double maxAlongK = alongKStep * std::max(std::abs(firstBin), std::abs(firstBin + alongLength - 1));
+
+    const double rangeKStep = wavenumberStep;
+    const double rangeKMin = std::sqrt(std::max(wavenumberMin * wavenumberMin - maxAlongK * maxAlongK, 0.0));
+    long long rangeKCount = static_cast<long long>(std::ceil((wavenumberMax - rangeKMin) / rangeKStep)) + 1;
+    rangeKCount += rangeKCount % 2;
+
+    // The spectrum is zero-padded to twice its extent on both axes so that the image is sampled finely enough to interpolate.
+    const long long paddedAlong = 2 * alongLength;
+    const long long paddedRange = 2 * rangeKCount;
+    const double alongPixel = 2 * pi / (paddedAlong * alongKStep);
+    const double rangePixel = 2 * pi / (paddedRange * rangeKStep);
+    const double alongStart = centreAlong - paddedAlong / 2 * alongPixel;
+    const double rangeStart = -paddedRange / 2 * rangePixel;
+
+    /*----- Reference function and Stolt mapping onto a uniform grid of range wavenumber -----*/
+    const long long numFftSamples = numPulse * fftSamplingFactor;
+    const double scale = rangeKStep / (wavenumberStep * numFftSamples * alongLength * alongStep);
+    const arma::vec rangeK = rangeKMin + arma::regspace(0, rangeKCount - 1) * rangeKStep;
+    arma::cx_mat stolt(paddedAlong, paddedRange, arma::fill::zeros);
+#pragma omp parallel for
+    for (long long w = 0; w < alongLength; w++)
+    {
+        const long long bin = ((firstBin + w) % alongLength + alongLength) % alongLength;
+        const double alongK = (firstBin + w) * alongKStep;
+        arma::cx_vec referenced(numFreq, arma::fill::zeros);
+        for (long long n = 0; n < numFreq; n++)
+        {
+            const double radial = wavenumber(n) * wavenumber(n) - alongK * alongK;
+            if (radial > 0)
+            {
+                referenced(n) = spectrum(bin, n) * std::polar(1.0, std::sqrt(radial) * referenceDistance);
+            }
+        }
+
+        const arma::vec query = arma::sqrt(arma::square(rangeK) + alongK * alongK);
+        const arma::cx_vec mapped = interp1_uniform(wavenumber, referenced, query);
+        const long long paddedW = w + alongLength / 2;
+        for (long long l = 0; l < rangeKCount; l++)
+        {
+            if (rangeK(l) <= 0 || query(l) < wavenumberMin || query(l) > wavenumberMax)
+            {
+                continue;
+            }
+
+            // Stationary phase amplitude of the along-track integral and the Jacobian of the Stolt mapping, with the pixel grid offsets.
+            const long long paddedL = l + rangeKCount / 2;
+            const double shift = paddedW * alongKStep * alongStart + paddedL * rangeKStep * rangeStart + pi / 4;
+            stolt(paddedW, paddedL) = mapped(l) * std::polar(scale * std::sqrt(2 * pi * referenceDistance / rangeK(l)), shift);
+        }
+    }
+    spectrum.reset();
+
+    /*----- 2-D inverse FFT, then the baseband image is interpolated at the pixels -----*/
+    fft_plan_cache::instance().execute_many(stolt.memptr(), stolt.memptr(), paddedAlong, paddedRange, FFTW_BACKWARD);
+    arma::cx_mat image = arma::strans(stolt);
+    stolt.reset();
+    fft_plan_cache::instance().execute_many(image.memptr(), image.memptr(), paddedRange, paddedAlong, FFTW_BACKWARD);
+    for (long long a = 0; a < paddedAlong; a++)
+    {
+        for (long long b = 0; b < paddedRange; b++)
+        {
+            const double shift = paddedAlong / 2 * alongKStep * (alongStart + a * alongPixel)
+                + paddedRange / 2 * rangeKStep * (rangeStart + b * rangePixel);
+            image(b, a) *= std::polar(1.0, -shift);
+        }
+    }
+
+    const double centreAlongBand = centreBin * alongKStep;
+    const double centreRangeBand = rangeKMin + rangeKCount / 2 * rangeKStep;
+    complexImageData = arma::cx_mat(numXSamples, numYSamples);
+#pragma omp parallel for
+    for (long long j = 0; j < static_cast<long long>(complexImageData.n_elem); j++)
+    {
+        double alongTrack, distance;
+        track_coordinates(xGrid(j), yGrid(j), alongTrack, distance);
+        const double relativeDistance = distance - referenceDistance;
+        const arma::cx_double value = interp2_uniform(image, (relativeDistance - rangeStart) / rangePixel, (alongTrack - alongStart) / alongPixel);
+        complexImageData(j) = value * std::polar(std::sqrt(distance / referenceDistance), centreAlongBand * alongTrack + centreRangeBand * relativeDistance);
+    }
+
+    imageData = arma::real(complexImageData);
+    if (correlated)
+    {
+        powerImageData = arma::square(arma::abs(complexImageData));
+    }
+    std::cout << "Successfully generated image data: " << timer.elapsed_milliseconds() << " ms elapsed" << std::endl;
+    return 0;
+}
+
+std::string target_cp_omega_k::parameter_string() const
+{
+    std::ostringstream stream;
+    stream << target_cp_corr_bp::parameter_string() << " trackToleranceWavelengths=" << trackToleranceWavelengths;
+    return stream.str();
+}
+
+std::vector<int> target_cp_omega_k::generic_run(const std::vector<std::string>& inputPaths, const std::string& savePath, const int from, const int to,
+    const output_modes outputMode, const output_encodings outputEncoding)
+{
+    return batch_run(inputPaths, from, to, create_imager, keptImages, savePath, "target_cp_omega_k", outputMode, outputEncoding);
+}
+
+std::vector<int> target_cp_omega_k::generic_run(const std::vector<std::string>& inputPaths, const std::string& savePath, work_queue& queue,
+    const output_modes outputMode, const output_encodings outputEncoding)
+{
+    return batch_run(inputPaths, queue, create_imager, keptImages, savePath, "target_cp_omega_k", outputMode, outputEncoding);
+}
+
+target_cp_omega_k::back_projection_comparison target_cp_omega_k::compare_with_back_projection(const target_cp_omega_k& loaded)
+{
+    target_cp_omega_k migrated = loaded;
+    stopwatch timer;
+    const int migratedStatus = migrated.get_image_data();
+    const long long migratedMilliseconds = timer.elapsed_milliseconds();
+
+    target_cp_corr_bp direct = loaded;
+    timer.restart();
+    const int directStatus = direct.get_image_data();
+    const long long directMilliseconds = timer.elapsed_milliseconds();
+
+    if (migratedStatus != 0 || directStatus != 0 || migrated.imageData.n_elem != direct.imageData.n_elem || direct.imageData.is_empty())
+    {
+        std::cout << "[Error] compare_with_back_projection failed for <" << loaded.dataPath << ">." << std::endl;
+        return {0, 0, false};
+    }
+
+    // Both engines keep the real part of the image with the same phase reference, so the real images are compared.
+    const arma::vec migratedImage = arma::vectorise(migrated.imageData);
+    const arma::vec directImage = arma::vectorise(direct.imageData);
+    back_projection_comparison comparison;
+    comparison.correlation = arma::dot(migratedImage, directImage) / (arma::norm(migratedImage) * arma::norm(directImage));
+    comparison.relativeError = arma::norm(migratedImage - directImage) / arma::norm(directImage);
+    comparison.peaksAgree = migratedImage.index_max() == directImage.index_max();
+    std::cout << "[Omega-k] " << loaded.dataPath << std::endl;
+    std::cout << "    back-projection: " << directMilliseconds << " ms, omega-k: " << migratedMilliseconds << " ms" << std::endl;
+    std::cout << "    correlation: " << comparison.correlation << ", relative error: " << comparison.relativeError
+        << ", peaks " << (comparison.peaksAgree ? "on the same pixel" : "on different pixels") << std::endl;
+    return comparison;
+}
+
+int target_cp_omega_k::clear()
+{
+    complexImageData.clear();
+    powerImageData.clear();
+    return target_cp_corr_bp::clear();
+}
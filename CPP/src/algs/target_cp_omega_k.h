@@ -0,0 +1,77 @@
+#ifndef TARGET_CP_OMEGA_K_H
+#define TARGET_CP_OMEGA_K_H
+
+#include "target_cp_corr_bp.h"
+
+#include <armadillo>
+
+
+/*-------------------------------------------------------------------------
+ * Range migration (omega-k) imager over the target_cp_corr_bp inputs, for
+ * collections flown along a straight, uniformly sampled track.
+ *
+ * The motion compensation to r0 is undone, the data are transformed along
+ * the track, and the reference function exp(i kr rRef) for the scene
+ * centre's distance from the track is applied. A Stolt mapping then
+ * resamples every along-track frequency onto a uniform grid of kr, which
+ * is a uniform-grid interpolation in k since k = sqrt(kr^2 + ku^2). A 2-D
+ * inverse FFT gives the image in (along-track, distance from track)
+ * coordinates, and it is interpolated onto the target_cp_corr_bp pixels.
+ *
+ * imageData is the real part of the image, as for target_cp_corr_bp. The
+ * pulses are never summed one by one, so there is no correlated image;
+ * with correlated set, the power image |sum|^2 is kept instead, in
+ * powerImageData, and saved as <file>_Power.
+ *------------------------------------------------------------------------*/
+class target_cp_omega_k : public target_cp_corr_bp
+{
+    public:
+        // How closely the real images of this engine and of target_cp_corr_bp agree on the same data.
+        struct back_projection_comparison
+        {
+            // Normalised correlation of the two real images.
+            double correlation;
+
+            // Norm of the difference over the norm of the back-projected image.
+            double relativeError;
+
+            bool peaksAgree;
+        };
+
+        // Largest departure of any pulse from a straight, uniformly sampled track, in shortest wavelengths.
+        double trackToleranceWavelengths = 0.125;
+
+        // The complex image, in the same layout as imageData.
+        arma::cx_mat complexImageData;
+
+        // |sum|^2, in the same layout as imageData; formed when correlated is set.
+        arma::mat powerImageData;
+
+        target_cp_omega_k(const std::string &dataPath,
+            const int fftSamplingFactor, const int numXSamp, const int numYSamp,
+            const double centerX, const double centerY, const bool correlated = true)
+            : target_cp_corr_bp(dataPath, fftSamplingFactor, numXSamp, numYSamp, centerX, centerY, correlated)
+        {
+        }
+
+        int get_image_data() override;
+
+        int clear() override;
+
+        std::string parameter_string() const override;
+
+        // Images inputPaths[from..to); returns the indices of the inputs that failed to load, image or save.
+        static std::vector<int> generic_run(const std::vector<std::string>& inputPaths, const std::string& savePath, const int from, const int to,
+            const output_modes outputMode = output_modes::FILES, const output_encodings outputEncoding = output_encodings::NATIVE);
+
+        // Images the inputs the queue hands this process, in one pipelined run; returns the indices of those that failed.
+        static std::vector<int> generic_run(const std::vector<std::string>& inputPaths, const std::string& savePath, work_queue& queue,
+            const output_modes outputMode = output_modes::FILES, const output_encodings outputEncoding = output_encodings::NATIVE);
+
+        // Images a loaded imager with this engine and with target_cp_corr_bp, prints the run times and compares the images.
+        static back_projection_comparison compare_with_back_projection(const target_cp_omega_k& loaded);
+};
+
+
+
+#endif //TARGET_CP_OMEGA_K_H
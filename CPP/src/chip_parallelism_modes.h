@@ -0,0 +1,18 @@
+#ifndef CHIP_PARALLELISM_MODES_H
+#define CHIP_PARALLELISM_MODES_H
+
+/*-------------------------------------------------------------------------
+ * How ph_mstar_corr_bp shares its thread budget between chips. Each chip
+ * is one task; OUTER runs as many chips at once as there are threads, each
+ * on one thread, and INNER runs one chip at a time on every thread. AUTO
+ * gives each chip as many threads as its pixel-pulse count keeps busy and
+ * runs as many chips at once as the rest of the budget allows.
+ *------------------------------------------------------------------------*/
+enum class chip_parallelism_modes
+{
+    AUTO, // chosen from the chip dimensions
+    OUTER, // chips in parallel, pulses serial
+    INNER // chips serial, pulses in parallel
+};
+
+#endif //CHIP_PARALLELISM_MODES_H
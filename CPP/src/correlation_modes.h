@@ -0,0 +1,10 @@
+#ifndef CORRELATION_MODES_H
+#define CORRELATION_MODES_H
+
+enum class correlation_modes
+{
+    BUFFERED, // Keeps every pulse's contribution to every pixel and correlates each pixel through an FFT
+    STREAMING // Accumulates the closed form |sum(x)|^2 - sum(|x|^2) per pixel while the pulses stream
+};
+
+#endif //CORRELATION_MODES_H
@@ -0,0 +1,19 @@
+#ifndef OUTPUT_ENCODINGS_H
+#define OUTPUT_ENCODINGS_H
+
+/*-------------------------------------------------------------------------
+ * How saved images store their values. Every encoding but NATIVE is
+ * written to chunked datasets through the shuffle and deflate filters,
+ * with scale and offset stored alongside so that each value decodes as
+ * stored * scale + offset.
+ *------------------------------------------------------------------------*/
+enum class output_encodings
+{
+    NATIVE, // double, complex images as {real, imag}, uncompressed exactly as Armadillo writes them
+    FLOAT, // float32, complex images as {real, imag}
+    MAGNITUDE_HALF, // float16 |x| divided by its peak, scale holding the peak
+    DB_UINT8, // 20 log10 |x| over the dynamic range below the peak, quantised to 8 bits
+    DB_UINT16 // 20 log10 |x| over the dynamic range below the peak, quantised to 16 bits
+};
+
+#endif //OUTPUT_ENCODINGS_H
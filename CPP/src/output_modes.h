@@ -0,0 +1,10 @@
+#ifndef OUTPUT_MODES_H
+#define OUTPUT_MODES_H
+
+enum class output_modes
+{
+    FILES, // One .hdf5 file per image, and per _Corr image, named after its input
+    CONSOLIDATED // Every image appended to the extendable datasets of one image_sink file, kept across runs
+};
+
+#endif //OUTPUT_MODES_H
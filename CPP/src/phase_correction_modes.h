@@ -0,0 +1,10 @@
+#ifndef PHASE_CORRECTION_MODES_H
+#define PHASE_CORRECTION_MODES_H
+
+enum class phase_correction_modes
+{
+    EXACT, // Evaluates the phase of every valid pixel directly
+    RECURRENCE // Rotates anchored phases down each grid column; only valid where the differential range is affine in pixel position
+};
+
+#endif //PHASE_CORRECTION_MODES_H
@@ -1,10 +1,13 @@
 #ifndef POLARIZATION_TYPES_H
 #define POLARIZATION_TYPES_H
 
+#include <string>
+
 enum class polarization_types
 {
     HH, // Horizontal-Horizontal sent and received polarized radar waves
     HV, // Horizontal-Vertical sent and received polarized radar waves
+    VH, // Vertical-Horizontal sent and received polarized radar waves
     VV // Vertical-Vertical sent and received polarized radar waves
 };
 
@@ -18,6 +21,9 @@ static std::string polarizationToString(polarization_types polarization)
         case polarization_types::HV:
             return "hv";
 
+        case polarization_types::VH:
+            return "vh";
+
         case polarization_types::VV:
             return "vv";
     }
@@ -0,0 +1,73 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+/*-------------------------------------------------------------------------
+ * A first-in first-out queue holding at most capacity items. push blocks
+ * while the queue is full, which holds a faster producer back to the pace
+ * of its consumer, and pop blocks while it is empty. Once closed, push
+ * fails and pop drains what is left before failing.
+ *------------------------------------------------------------------------*/
+template <typename T>
+class bounded_queue
+{
+    public:
+        explicit bounded_queue(const size_t capacity) : capacity(capacity > 0 ? capacity : 1)
+        {
+        }
+
+        bool push(T item)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            notFull.wait(lock, [this] { return closed || items.size() < capacity; });
+            if (closed)
+            {
+                return false;
+            }
+
+            items.push_back(std::move(item));
+            notEmpty.notify_one();
+            return true;
+        }
+
+        bool pop(T& item)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            notEmpty.wait(lock, [this] { return closed || !items.empty(); });
+            if (items.empty())
+            {
+                return false;
+            }
+
+            item = std::move(items.front());
+            items.pop_front();
+            notFull.notify_one();
+            return true;
+        }
+
+        void close()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+            notFull.notify_all();
+            notEmpty.notify_all();
+        }
+
+    private:
+        const size_t capacity;
+
+        std::deque<T> items;
+
+        std::mutex mutex;
+
+        std::condition_variable notFull;
+
+        std::condition_variable notEmpty;
+
+        bool closed = false;
+};
+
+#endif //BOUNDED_QUEUE_H
@@ -0,0 +1,171 @@
+#ifndef CHIP_STACK_H
+#define CHIP_STACK_H
+
+#include <armadillo>
+#include <complex>
+#include <filesystem>
+#include <hdf5.h>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "file_utils.h"
+#include "hdf5_reader.h"
+#include "image_encoder.h"
+
+/*-------------------------------------------------------------------------
+ * A stack of equally sized per-chip matrices, each stored contiguously.
+ *
+ * The chips are the slices of a cube, so chip(i) is a plain matrix
+ * reference rather than a strided copy out of every slice. On disk the
+ * stacks keep the layout arma::cube has always written, with the chip as
+ * the first cube index (the last, fastest varying HDF5 dimension): load
+ * and save move one chip at a time through an HDF5 hyperslab, which does
+ * the gather and scatter between the two layouts without a staging cube.
+ *
+ * eT is double or std::complex<double>; complex data use the same
+ * {real, imag} compound type as Armadillo.
+ *------------------------------------------------------------------------*/
+template <typename eT>
+class chip_stack
+{
+    public:
+        arma::Cube<eT> data;
+
+        chip_stack() = default;
+
+        chip_stack(const arma::uword chipRows, const arma::uword chipCols, const arma::uword chips)
+            : data(chipRows, chipCols, chips, arma::fill::zeros)
+        {
+        }
+
+        arma::uword n_chips() const
+        {
+            return data.n_slices;
+        }
+
+        arma::uword chip_rows() const
+        {
+            return data.n_rows;
+        }
+
+        arma::uword chip_cols() const
+        {
+            return data.n_cols;
+        }
+
+        arma::Mat<eT>& chip(const arma::uword index)
+        {
+            return data.slice(index);
+        }
+
+        const arma::Mat<eT>& chip(const arma::uword index) const
+        {
+            return data.slice(index);
+        }
+
+        // Reads dataName, or data/dataName, of a file written as an arma::cube with the chip as its row index.
+        bool load(const std::string& dataPath, const std::string& dataName)
+        {
+            hdf5_reader reader(dataPath);
+            return reader.read(*this, dataName);
+        }
+
+        // Writes savePath/saveName.hdf5 exactly as arma::cube::save(hdf5_binary) would the equivalent cube, or in an output encoding.
+        bool save(const std::string& savePath, const std::string& saveName, const image_encoder& encoder = image_encoder()) const
+        {
+            std::filesystem::create_directory(savePath);
+            std::string outputName = saveName;
+            if (has_extension(saveName))
+            {
+                std::string parent, name, extension;
+                get_file_info(saveName, parent, name, extension);
+                outputName = name;
+            }
+
+            // Encoded once as a whole, so scale and offset cover every chip; the values keep the chip-major memory layout.
+            constexpr bool complex = std::is_same_v<eT, std::complex<double>>;
+            const bool native = encoder.encoding() == output_encodings::NATIVE;
+            double scale = 1;
+            double offset = 0;
+            const std::vector<unsigned char> encoded = native ? std::vector<unsigned char>()
+                : encoder.encode(reinterpret_cast<const double*>(data.memptr()), data.n_elem, complex, scale, offset);
+
+            std::lock_guard<std::mutex> lock(hdf5_mutex());
+            const hid_t file = H5Fcreate((savePath + "/" + outputName + ".hdf5").c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+            if (file < 0)
+            {
+                return false;
+            }
+
+            const hsize_t dimensions[3] = {data.n_cols, data.n_rows, data.n_slices};
+            const hid_t fileSpace = H5Screate_simple(3, dimensions, nullptr);
+            const hid_t fileType = encoder.file_type(complex);
+            const hid_t memoryType = encoder.memory_type(complex);
+            const hid_t properties = native ? H5Pcreate(H5P_DATASET_CREATE) : encoder.creation_properties(3, dimensions);
+            const hid_t dataset = H5Dcreate2(file, "dataset", fileType, fileSpace, H5P_DEFAULT, properties, H5P_DEFAULT);
+            bool saved = dataset >= 0 && (native || encoder.write_attributes(dataset, scale, offset));
+            const hsize_t count[3] = {data.n_cols, data.n_rows, 1};
+            const hid_t memorySpace = H5Screate_simple(3, count, nullptr);
+            const size_t chipBytes = data.n_rows * data.n_cols * H5Tget_size(memoryType);
+            for (arma::uword i = 0; saved && i < data.n_slices; i++)
+            {
+                const hsize_t start[3] = {0, 0, i};
+                const void* chipValues = native ? static_cast<const void*>(data.slice_memptr(i)) : encoded.data() + i * chipBytes;
+                H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, start, nullptr, count, nullptr);
+                saved = H5Dwrite(dataset, memoryType, memorySpace, fileSpace, H5P_DEFAULT, chipValues) >= 0;
+            }
+
+            H5Sclose(memorySpace);
+            if (dataset >= 0)
+            {
+                H5Dclose(dataset);
+            }
+            H5Pclose(properties);
+            H5Tclose(memoryType);
+            if (fileType >= 0)
+            {
+                H5Tclose(fileType);
+            }
+            H5Sclose(fileSpace);
+            H5Fclose(file);
+            return saved;
+        }
+
+        void clear()
+        {
+            data.reset();
+        }
+
+        // Reads an open dataset of rank 3, one hyperslab per chip; the caller holds hdf5_mutex().
+        bool read_dataset(const hid_t dataset)
+        {
+            const hid_t fileSpace = H5Dget_space(dataset);
+            hsize_t dimensions[3];
+            if (H5Sget_simple_extent_ndims(fileSpace) != 3)
+            {
+                H5Sclose(fileSpace);
+                return false;
+            }
+
+            H5Sget_simple_extent_dims(fileSpace, dimensions, nullptr);
+            data.set_size(dimensions[1], dimensions[0], dimensions[2]);
+            const hid_t type = hdf5_memory_type<eT>();
+            const hsize_t count[3] = {dimensions[0], dimensions[1], 1};
+            const hid_t memorySpace = H5Screate_simple(3, count, nullptr);
+            bool loaded = true;
+            for (arma::uword i = 0; loaded && i < data.n_slices; i++)
+            {
+                const hsize_t start[3] = {0, 0, i};
+                H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, start, nullptr, count, nullptr);
+                loaded = H5Dread(dataset, type, memorySpace, fileSpace, H5P_DEFAULT, data.slice_memptr(i)) >= 0;
+            }
+
+            H5Sclose(memorySpace);
+            H5Tclose(type);
+            H5Sclose(fileSpace);
+            return loaded;
+        }
+};
+
+#endif //CHIP_STACK_H
@@ -0,0 +1,126 @@
+#ifndef CORRELATION_UTILS_H
+#define CORRELATION_UTILS_H
+
+#include <algorithm>
+#include <armadillo>
+#include <cmath>
+
+#include "fft_utils.h"
+
+/*-------------------------------------------------------------------------
+ * Per-pixel running sums for the zero-lag correlated image.
+ *
+ * The correlated images sum the full autocorrelation of each pixel's pulse
+ * series and remove the zero-lag energy. The sum over every lag of x * conj(x)
+ * is |sum(x)|^2, so the result is |sum(x)|^2 - sum(|x|^2), which only needs
+ * the two accumulators below rather than the whole pulse-by-pixel buffer.
+ *------------------------------------------------------------------------*/
+class streaming_correlator
+{
+    public:
+        arma::cx_vec sum;
+
+        arma::vec energy;
+
+        explicit streaming_correlator(const unsigned long long sampleCount)
+            : sum(sampleCount, arma::fill::zeros), energy(sampleCount, arma::fill::zeros)
+        {
+        }
+
+        // Values may be single or double precision; the sums are kept in double either way.
+        template <typename T>
+        void accumulate(const arma::uvec& index, const arma::Col<std::complex<T>>& values)
+        {
+            for (unsigned long long k = 0; k < index.n_elem; k++)
+            {
+                const arma::uword pixel = index(k);
+                const arma::cx_double value(values(k));
+                sum(pixel) += value;
+                energy(pixel) += std::norm(value);
+            }
+        }
+
+        void merge(const streaming_correlator& other)
+        {
+            sum += other.sum;
+            energy += other.energy;
+        }
+
+        // Adds the sums of a correlator covering pixels offset..offset + other.sum.n_elem - 1.
+        void merge(const streaming_correlator& other, const unsigned long long offset)
+        {
+            sum.subvec(offset, offset + other.sum.n_elem - 1) += other.sum;
+            energy.subvec(offset, offset + other.energy.n_elem - 1) += other.energy;
+        }
+
+        arma::vec correlated() const
+        {
+            return arma::square(arma::abs(sum)) - energy;
+        }
+};
+
+/*-------------------------------------------------------------------------
+ * Selected lags of each pixel's pulse-series convolution.
+ *
+ * Lag k is entry k of the linear convolution of a column of the series
+ * (pulses x pixels) with its conjugate, i.e. row k of the matrix the full
+ * correlated image used to be summed from. Only the requested lags are kept,
+ * returned as one row per lag. Small requests are evaluated as direct dot
+ * products; larger ones batch pixels through padded FFTs, whichever needs
+ * fewer operations. Lags must be below 2 * pulses - 1.
+ *------------------------------------------------------------------------*/
+inline arma::mat correlation_lags(const arma::cx_mat& series, const arma::uvec& lags)
+{
+    const long long pulseCount = series.n_rows;
+    const long long sampleCount = series.n_cols;
+    const long long fftLength = pulseCount * 2 - 1;
+    const long long fftPaddedLength = pow(2, ceil(log2(fftLength)));
+    arma::mat output(lags.n_elem, sampleCount, arma::fill::zeros);
+
+    double directCost = 0;
+    for (const arma::uword lag : lags)
+    {
+        directCost += std::min<long long>(lag, fftLength - 1 - lag) + 1;
+    }
+
+    const double fftCost = 3.0 * fftPaddedLength * log2(fftPaddedLength);
+    if (directCost <= fftCost)
+    {
+#pragma omp parallel for
+        for (long long j = 0; j < sampleCount; j++)
+        {
+            const arma::cx_double* column = series.colptr(j);
+            for (unsigned long long l = 0; l < lags.n_elem; l++)
+            {
+                const long long lag = lags(l);
+                const long long first = std::max(0LL, lag - pulseCount + 1);
+                const long long last = std::min(lag, pulseCount - 1);
+                double sum = 0;
+                for (long long m = first; m <= last; m++)
+                {
+                    sum += column[m].real() * column[lag - m].real() + column[m].imag() * column[lag - m].imag();
+                }
+                output.at(l, j) = sum;
+            }
+        }
+        return output;
+    }
+
+    // Pixels are transformed in blocks so the padded spectra stay small while each FFT call still covers many columns.
+    constexpr long long blockSize = 64;
+    const long long blockCount = (sampleCount + blockSize - 1) / blockSize;
+#pragma omp parallel for
+    for (long long b = 0; b < blockCount; b++)
+    {
+        const long long first = b * blockSize;
+        const long long last = std::min(first + blockSize, sampleCount) - 1;
+        const arma::cx_mat block = series.cols(first, last);
+        const arma::cx_mat conjugated = arma::conj(block);
+        const arma::cx_mat spectra = planned_fft_cols(block, fftPaddedLength) % planned_fft_cols(conjugated, fftPaddedLength);
+        const arma::mat convolved = arma::real(planned_ifft_cols(spectra, fftPaddedLength));
+        output.cols(first, last) = convolved.rows(lags);
+    }
+    return output;
+}
+
+#endif //CORRELATION_UTILS_H
@@ -0,0 +1,155 @@
+#include "fft_utils.h"
+
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <unistd.h>
+
+fft_plan_cache& fft_plan_cache::instance()
+{
+    static fft_plan_cache cache;
+    return cache;
+}
+
+fft_plan_cache::~fft_plan_cache()
+{
+    for (const auto& [key, plan] : doublePlans)
+    {
+        fftw_destroy_plan(plan);
+    }
+
+    for (const auto& [key, plan] : floatPlans)
+    {
+        fftwf_destroy_plan(plan);
+    }
+}
+
+fftw_plan fft_plan_cache::find_plan(const plan_key& key)
+{
+    {
+        std::shared_lock lock(mutex);
+        if (const auto existing = doublePlans.find(key); existing != doublePlans.end())
+        {
+            return existing->second;
+        }
+    }
+
+    std::unique_lock lock(mutex);
+    if (const auto existing = doublePlans.find(key); existing != doublePlans.end())
+    {
+        return existing->second;
+    }
+
+    // Planning may overwrite its arrays, so plans are always made on scratch buffers.
+    const auto [length, count, direction, singlePrecision, aligned, inPlace] = key;
+    fftw_complex* input = fftw_alloc_complex(static_cast<size_t>(length) * count);
+    fftw_complex* output = inPlace ? input : fftw_alloc_complex(static_cast<size_t>(length) * count);
+    const unsigned flags = planningFlags | (aligned ? 0 : FFTW_UNALIGNED);
+    fftw_plan plan = fftw_plan_many_dft(1, &length, count, input, nullptr, 1, length, output, nullptr, 1, length, direction, flags);
+    if (!inPlace)
+    {
+        fftw_free(output);
+    }
+    fftw_free(input);
+
+    doublePlans[key] = plan;
+    return plan;
+}
+
+fftwf_plan fft_plan_cache::find_float_plan(const plan_key& key)
+{
+    {
+        std::shared_lock lock(mutex);
+        if (const auto existing = floatPlans.find(key); existing != floatPlans.end())
+        {
+            return existing->second;
+        }
+    }
+
+    std::unique_lock lock(mutex);
+    if (const auto existing = floatPlans.find(key); existing != floatPlans.end())
+    {
+        return existing->second;
+    }
+
+    const auto [length, count, direction, singlePrecision, aligned, inPlace] = key;
+    fftwf_complex* input = fftwf_alloc_complex(static_cast<size_t>(length) * count);
+    fftwf_complex* output = inPlace ? input : fftwf_alloc_complex(static_cast<size_t>(length) * count);
+    const unsigned flags = planningFlags | (aligned ? 0 : FFTW_UNALIGNED);
+    fftwf_plan plan = fftwf_plan_many_dft(1, &length, count, input, nullptr, 1, length, output, nullptr, 1, length, direction, flags);
+    if (!inPlace)
+    {
+        fftwf_free(output);
+    }
+    fftwf_free(input);
+
+    floatPlans[key] = plan;
+    return plan;
+}
+
+void fft_plan_cache::execute(const std::complex<double>* input, std::complex<double>* output, const int length, const int direction)
+{
+    execute_many(input, output, length, 1, direction);
+}
+
+void fft_plan_cache::execute(const std::complex<float>* input, std::complex<float>* output, const int length, const int direction)
+{
+    execute_many(input, output, length, 1, direction);
+}
+
+void fft_plan_cache::execute_many(const std::complex<double>* input, std::complex<double>* output, const int length, const int count, const int direction)
+{
+    // FFTW's new-array execute never writes to the input of an out-of-place complex transform.
+    auto* in = reinterpret_cast<fftw_complex*>(const_cast<std::complex<double>*>(input));
+    auto* out = reinterpret_cast<fftw_complex*>(output);
+    const bool aligned = fftw_alignment_of(reinterpret_cast<double*>(in)) == 0 && fftw_alignment_of(reinterpret_cast<double*>(out)) == 0;
+    const fftw_plan plan = find_plan({length, count, direction, false, aligned, in == out});
+    fftw_execute_dft(plan, in, out);
+}
+
+void fft_plan_cache::execute_many(const std::complex<float>* input, std::complex<float>* output, const int length, const int count, const int direction)
+{
+    auto* in = reinterpret_cast<fftwf_complex*>(const_cast<std::complex<float>*>(input));
+    auto* out = reinterpret_cast<fftwf_complex*>(output);
+    const bool aligned = fftwf_alignment_of(reinterpret_cast<float*>(in)) == 0 && fftwf_alignment_of(reinterpret_cast<float*>(out)) == 0;
+    const fftwf_plan plan = find_float_plan({length, count, direction, true, aligned, in == out});
+    fftwf_execute_dft(plan, in, out);
+}
+
+bool fft_plan_cache::load_wisdom(const std::string& path)
+{
+    std::unique_lock lock(mutex);
+    const bool doubleLoaded = fftw_import_wisdom_from_filename(path.c_str()) != 0;
+    const bool floatLoaded = fftwf_import_wisdom_from_filename((path + ".f").c_str()) != 0;
+    if (!doubleLoaded && !floatLoaded)
+    {
+        std::cout << "No FFTW wisdom found at " << path << "; plans will be measured from scratch." << std::endl;
+    }
+    return doubleLoaded || floatLoaded;
+}
+
+bool fft_plan_cache::save_wisdom(const std::string& path)
+{
+    // Several partitions may finish at once, so each writes a private file and renames it into place.
+    std::unique_lock lock(mutex);
+    const std::string suffix = ".tmp" + std::to_string(getpid());
+    const bool doubleSaved = fftw_export_wisdom_to_filename((path + suffix).c_str()) != 0;
+    const bool floatSaved = fftwf_export_wisdom_to_filename((path + ".f" + suffix).c_str()) != 0;
+    std::error_code error;
+    if (doubleSaved)
+    {
+        std::filesystem::rename(path + suffix, path, error);
+    }
+
+    if (floatSaved)
+    {
+        std::filesystem::rename(path + ".f" + suffix, path + ".f", error);
+    }
+    return doubleSaved && floatSaved && !error;
+}
+
+void fft_plan_cache::set_planning_flags(const unsigned flags)
+{
+    std::unique_lock lock(mutex);
+    planningFlags = flags;
+}
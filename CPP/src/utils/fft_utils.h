@@ -0,0 +1,186 @@
+#ifndef FFT_UTILS_H
+#define FFT_UTILS_H
+
+#include <algorithm>
+#include <armadillo>
+#include <cmath>
+#include <complex>
+#include <fftw3.h>
+#include <map>
+#include <shared_mutex>
+#include <string>
+#include <tuple>
+
+/*-------------------------------------------------------------------------
+ * Process-wide cache of FFTW plans.
+ *
+ * Plans are keyed by length, batch count, direction and precision (plus whether the
+ * arrays are SIMD-aligned and whether the transform is in place, as FFTW's
+ * new-array execute requires both to match the plan). Each plan is made
+ * once, on scratch buffers, and then executed on the caller's arrays, which
+ * is safe from any number of threads. Planning and wisdom import / export
+ * are serialised, as the FFTW planner is not thread-safe.
+ *
+ * Every FFT in the imagers goes through this cache; mixing it with
+ * arma::fft would let Armadillo's own FFTW planning race with ours.
+ *------------------------------------------------------------------------*/
+class fft_plan_cache
+{
+    public:
+        static fft_plan_cache& instance();
+
+        void execute(const std::complex<double>* input, std::complex<double>* output, int length, int direction);
+
+        void execute(const std::complex<float>* input, std::complex<float>* output, int length, int direction);
+
+        // Transforms count contiguous arrays of the given length, one after another, with a single batched plan.
+        void execute_many(const std::complex<double>* input, std::complex<double>* output, int length, int count, int direction);
+
+        void execute_many(const std::complex<float>* input, std::complex<float>* output, int length, int count, int direction);
+
+        // Wisdom for double precision plans is kept at path, and for single precision at path + ".f".
+        bool load_wisdom(const std::string& path);
+
+        bool save_wisdom(const std::string& path);
+
+        void set_planning_flags(unsigned flags);
+
+        fft_plan_cache(const fft_plan_cache&) = delete;
+
+        fft_plan_cache& operator=(const fft_plan_cache&) = delete;
+
+    private:
+        // Length, batch count, direction, single precision, aligned, in place.
+        using plan_key = std::tuple<int, int, int, bool, bool, bool>;
+
+        std::map<plan_key, fftw_plan> doublePlans;
+
+        std::map<plan_key, fftwf_plan> floatPlans;
+
+        std::shared_mutex mutex;
+
+        unsigned planningFlags = FFTW_MEASURE;
+
+        fft_plan_cache() = default;
+
+        ~fft_plan_cache();
+
+        fftw_plan find_plan(const plan_key& key);
+
+        fftwf_plan find_float_plan(const plan_key& key);
+};
+
+// Equivalent of arma::fft(input, length): the input is zero-padded or truncated to length. T is float or double.
+template <typename T>
+inline arma::Col<std::complex<T>> planned_fft(const arma::Col<std::complex<T>>& input, const unsigned long long length)
+{
+    arma::Col<std::complex<T>> output(length, arma::fill::zeros);
+    const unsigned long long count = std::min<unsigned long long>(input.n_elem, length);
+    std::copy_n(input.memptr(), count, output.memptr());
+    fft_plan_cache::instance().execute(output.memptr(), output.memptr(), length, FFTW_FORWARD);
+    return output;
+}
+
+// Equivalent of arma::ifft(input, length), including the 1 / length scaling.
+template <typename T>
+inline arma::Col<std::complex<T>> planned_ifft(const arma::Col<std::complex<T>>& input, const unsigned long long length)
+{
+    arma::Col<std::complex<T>> output(length, arma::fill::zeros);
+    const unsigned long long count = std::min<unsigned long long>(input.n_elem, length);
+    std::copy_n(input.memptr(), count, output.memptr());
+    fft_plan_cache::instance().execute(output.memptr(), output.memptr(), length, FFTW_BACKWARD);
+    output /= static_cast<T>(length);
+    return output;
+}
+
+// Column-wise equivalent of arma::fft(input, length) for matrices.
+template <typename T>
+inline arma::Mat<std::complex<T>> planned_fft_cols(const arma::Mat<std::complex<T>>& input, const unsigned long long length)
+{
+    arma::Mat<std::complex<T>> output(length, input.n_cols, arma::fill::zeros);
+    const unsigned long long count = std::min<unsigned long long>(input.n_rows, length);
+    for (unsigned long long j = 0; j < input.n_cols; j++)
+    {
+        std::copy_n(input.colptr(j), count, output.colptr(j));
+    }
+    if (input.n_cols > 0)
+    {
+        fft_plan_cache::instance().execute_many(output.memptr(), output.memptr(), length, input.n_cols, FFTW_FORWARD);
+    }
+    return output;
+}
+
+// Column-wise equivalent of arma::ifft(input, length) for matrices.
+template <typename T>
+inline arma::Mat<std::complex<T>> planned_ifft_cols(const arma::Mat<std::complex<T>>& input, const unsigned long long length)
+{
+    arma::Mat<std::complex<T>> output(length, input.n_cols, arma::fill::zeros);
+    const unsigned long long count = std::min<unsigned long long>(input.n_rows, length);
+    for (unsigned long long j = 0; j < input.n_cols; j++)
+    {
+        std::copy_n(input.colptr(j), count, output.colptr(j));
+    }
+    if (input.n_cols > 0)
+    {
+        fft_plan_cache::instance().execute_many(output.memptr(), output.memptr(), length, input.n_cols, FFTW_BACKWARD);
+    }
+    output /= static_cast<T>(length);
+    return output;
+}
+
+/*-------------------------------------------------------------------------
+ * Range compression of a whole phase history. Column j of the result is
+ * cx_fftshift(arma::ifft(phase.col(j), fftLength)).
+ *
+ * The fftshift is folded into the transform by modulating the input with
+ * exp(-2 pi i k s / n), s = floor(n / 2), which is (-1)^k for the usual even
+ * lengths, so no shifted copy is made; the 1 / n scaling is folded in too.
+ * Columns are transformed in place in blocks, each with one batched plan.
+ * The phase history is converted to T as it is modulated, and the FFTs run
+ * in that precision.
+ *------------------------------------------------------------------------*/
+template <typename T = double>
+inline arma::Mat<std::complex<T>> range_compress(const arma::cx_mat& phase, const unsigned long long fftLength)
+{
+    const unsigned long long columns = phase.n_cols;
+    const unsigned long long count = std::min<unsigned long long>(phase.n_rows, fftLength);
+    const unsigned long long shift = fftLength / 2;
+    const double scale = 1.0 / static_cast<double>(fftLength);
+    arma::cx_vec modulation(count);
+    for (unsigned long long k = 0; k < count; k++)
+    {
+        if (fftLength % 2 == 0)
+        {
+            modulation(k) = arma::cx_double(k % 2 == 0 ? scale : -scale, 0.0);
+        }
+        else
+        {
+            const double turns = static_cast<double>((k * shift) % fftLength) / static_cast<double>(fftLength);
+            modulation(k) = std::polar(scale, -2.0 * M_PI * turns);
+        }
+    }
+
+    constexpr unsigned long long blockSize = 64;
+    const long long blockCount = (columns + blockSize - 1) / blockSize;
+    arma::Mat<std::complex<T>> profiles(fftLength, columns);
+#pragma omp parallel for
+    for (long long b = 0; b < blockCount; b++)
+    {
+        const unsigned long long first = b * blockSize;
+        const unsigned long long width = std::min(blockSize, columns - first);
+        for (unsigned long long j = first; j < first + width; j++)
+        {
+            const arma::cx_double* source = phase.colptr(j);
+            std::complex<T>* destination = profiles.colptr(j);
+            for (unsigned long long k = 0; k < count; k++)
+            {
+                destination[k] = std::complex<T>(source[k] * modulation(k));
+            }
+            std::fill(destination + count, destination + fftLength, std::complex<T>(0, 0));
+        }
+        fft_plan_cache::instance().execute_many(profiles.colptr(first), profiles.colptr(first), fftLength, width, FFTW_BACKWARD);
+    }
+    return profiles;
+}
+
+#endif //FFT_UTILS_H
@@ -0,0 +1,331 @@
+#ifndef HDF5_READER_H
+#define HDF5_READER_H
+
+#include <algorithm>
+#include <armadillo>
+#include <complex>
+#include <hdf5.h>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// The HDF5 library is not built thread-safe, so every HDF5 call made while other threads may be making one holds this lock.
+inline std::mutex& hdf5_mutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+// Memory type of eT, double or std::complex<double>; complex data use Armadillo's {real, imag} compound. Close with H5Tclose.
+template <typename eT>
+inline hid_t hdf5_memory_type()
+{
+    if constexpr (std::is_same_v<eT, std::complex<double>>)
+    {
+        const hid_t type = H5Tcreate(H5T_COMPOUND, sizeof(std::complex<double>));
+        H5Tinsert(type, "real", 0, H5T_NATIVE_DOUBLE);
+        H5Tinsert(type, "imag", sizeof(double), H5T_NATIVE_DOUBLE);
+        return type;
+    }
+    else
+    {
+        static_assert(std::is_same_v<eT, double>, "HDF5 reads are into double or std::complex<double>");
+        return H5Tcopy(H5T_NATIVE_DOUBLE);
+    }
+}
+
+// Checks every component of a path, as H5Lexists requires its parent groups to exist.
+inline bool hdf5_link_exists(const hid_t file, const std::string& name)
+{
+    std::string::size_type position = 0;
+    while (position != std::string::npos)
+    {
+        position = name.find('/', position + 1);
+        if (H5Lexists(file, name.substr(0, position).c_str(), H5P_DEFAULT) <= 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename eT>
+class chip_stack;
+
+/*-------------------------------------------------------------------------
+ * One open HDF5 file, read field by field.
+ *
+ * The file is opened once for the whole session and hdf5_mutex() is held
+ * until it is closed. Fields may sit at the root or under data/; the first
+ * field found settles which, and later fields are looked up there first.
+ * Datasets are read straight into the destination's own memory, sized
+ * from the dataset, with the dimensions mapped as Armadillo maps them:
+ * the last HDF5 dimension is the matrix row. HDF5 converts the stored
+ * numeric type to double on the way in.
+ *------------------------------------------------------------------------*/
+class hdf5_reader
+{
+    public:
+        explicit hdf5_reader(const std::string& dataPath, const bool debug = false)
+            : lock(hdf5_mutex()), dataPath(dataPath), debug(debug)
+        {
+            file = H5Fopen(dataPath.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+            if (file < 0 && debug)
+            {
+                std::cout << "Failed to open " << dataPath << std::endl;
+            }
+        }
+
+        ~hdf5_reader()
+        {
+            if (file >= 0)
+            {
+                H5Fclose(file);
+            }
+        }
+
+        hdf5_reader(const hdf5_reader&) = delete;
+
+        hdf5_reader& operator=(const hdf5_reader&) = delete;
+
+        bool is_open() const
+        {
+            return file >= 0;
+        }
+
+        template <typename eT>
+        bool read(arma::Mat<eT>& destination, const std::string& dataName)
+        {
+            std::vector<hsize_t> dimensions;
+            const hid_t dataset = open_dataset(dataName, dimensions);
+            if (dataset < 0 || dimensions.size() > 2)
+            {
+                return close_dataset(dataset, false);
+            }
+
+            set_size(destination, dimensions);
+            return close_dataset(dataset, read_into(dataset, destination.memptr(), destination.n_elem));
+        }
+
+        /*---------------------------------------------------------------------
+         * Reads only the pulses listed in indices, in ascending order: the
+         * columns of a matrix, or the elements of a vector. Runs of
+         * consecutive indices are read as one hyperslab each, so a window
+         * that wraps through the end of the data costs two reads.
+         *-------------------------------------------------------------------*/
+        template <typename eT>
+        bool read_selection(arma::Mat<eT>& destination, const std::string& dataName, const arma::uvec& indices)
+        {
+            std::vector<hsize_t> dimensions;
+            const hid_t dataset = open_dataset(dataName, dimensions);
+            if (dataset < 0 || dimensions.size() > 2)
+            {
+                return close_dataset(dataset, false);
+            }
+
+            // Pulses run along the slowest HDF5 dimension of a matrix and along the longest one of a vector.
+            const size_t rank = dimensions.size();
+            dimensions.resize(2, 1);
+            const int axis = dimensions[0] == 1 && dimensions[1] > 1 ? 1 : 0;
+            const hsize_t stride = dimensions[1 - axis];
+            if (!indices.is_empty() && indices.max() >= dimensions[axis])
+            {
+                return close_dataset(dataset, false);
+            }
+
+            dimensions[axis] = indices.n_elem;
+            set_size(destination, std::vector<hsize_t>(dimensions.begin(), dimensions.begin() + std::max<size_t>(rank, 1)));
+            if (indices.is_empty())
+            {
+                return close_dataset(dataset, true);
+            }
+
+            const hid_t fileSpace = H5Dget_space(dataset);
+            const hid_t type = hdf5_memory_type<eT>();
+            bool read = true;
+            arma::uword first = 0;
+            while (read && first < indices.n_elem)
+            {
+                arma::uword last = first;
+                while (last + 1 < indices.n_elem && indices(last + 1) == indices(last) + 1)
+                {
+                    last++;
+                }
+
+                hsize_t start[2] = {0, 0};
+                hsize_t count[2] = {dimensions[0], dimensions[1]};
+                start[axis] = indices(first);
+                count[axis] = last - first + 1;
+                const hsize_t elements = count[axis] * stride;
+                H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, start, nullptr, count, nullptr);
+                const hid_t memorySpace = H5Screate_simple(1, &elements, nullptr);
+                read = H5Dread(dataset, type, memorySpace, fileSpace, H5P_DEFAULT, destination.memptr() + first * stride) >= 0;
+                H5Sclose(memorySpace);
+                first = last + 1;
+            }
+
+            H5Tclose(type);
+            H5Sclose(fileSpace);
+            return close_dataset(dataset, read);
+        }
+
+        template <typename eT>
+        bool read(arma::Cube<eT>& destination, const std::string& dataName)
+        {
+            std::vector<hsize_t> dimensions;
+            const hid_t dataset = open_dataset(dataName, dimensions);
+            if (dataset < 0 || dimensions.size() > 3)
+            {
+                return close_dataset(dataset, false);
+            }
+
+            dimensions.insert(dimensions.begin(), 3 - dimensions.size(), 1);
+            destination.set_size(dimensions[2], dimensions[1], dimensions[0]);
+            return close_dataset(dataset, read_into(dataset, destination.memptr(), destination.n_elem));
+        }
+
+        // Fills the stack one chip at a time; see chip_stack.
+        template <typename eT>
+        bool read(chip_stack<eT>& destination, const std::string& dataName)
+        {
+            std::vector<hsize_t> dimensions;
+            const hid_t dataset = open_dataset(dataName, dimensions);
+            if (dataset < 0)
+            {
+                return false;
+            }
+            return close_dataset(dataset, destination.read_dataset(dataset));
+        }
+
+        bool read(double& destination, const std::string& dataName)
+        {
+            arma::vec temp;
+            if (!read(temp, dataName) || temp.is_empty())
+            {
+                return false;
+            }
+
+            destination = temp(0);
+            return true;
+        }
+
+        bool read(int& destination, const std::string& dataName)
+        {
+            double value;
+            if (!read(value, dataName))
+            {
+                return false;
+            }
+
+            destination = static_cast<int>(value);
+            return true;
+        }
+
+    private:
+        std::unique_lock<std::mutex> lock;
+
+        std::string dataPath;
+
+        bool debug;
+
+        hid_t file = -1;
+
+        std::string prefix;
+
+        bool prefixResolved = false;
+
+        hid_t open_dataset(const std::string& dataName, std::vector<hsize_t>& dimensions)
+        {
+            if (file < 0)
+            {
+                return -1;
+            }
+
+            const std::string preferred = prefix + dataName;
+            const std::string other = prefix.empty() ? "data/" + dataName : dataName;
+            std::string name;
+            if (hdf5_link_exists(file, preferred))
+            {
+                name = preferred;
+            }
+            else if (hdf5_link_exists(file, other))
+            {
+                name = other;
+                if (!prefixResolved)
+                {
+                    prefix = prefix.empty() ? "data/" : "";
+                }
+            }
+            else
+            {
+                if (debug)
+                {
+                    std::cout << "Failed to find " + dataName + " data associated with " + dataPath << std::endl;
+                }
+                return -1;
+            }
+            prefixResolved = true;
+
+            const hid_t dataset = H5Dopen2(file, name.c_str(), H5P_DEFAULT);
+            if (dataset < 0)
+            {
+                return -1;
+            }
+
+            const hid_t space = H5Dget_space(dataset);
+            const int rank = H5Sget_simple_extent_ndims(space);
+            dimensions.assign(rank > 0 ? rank : 0, 0);
+            if (rank > 0)
+            {
+                H5Sget_simple_extent_dims(space, dimensions.data(), nullptr);
+            }
+            H5Sclose(space);
+            return dataset;
+        }
+
+        // Sizes a matrix for HDF5 dimensions as Armadillo does, keeping a vector's orientation.
+        template <typename eT>
+        static void set_size(arma::Mat<eT>& destination, const std::vector<hsize_t>& dimensions)
+        {
+            const hsize_t elements = dimensions.empty() ? 1 : dimensions[0] * (dimensions.size() > 1 ? dimensions[1] : 1);
+            if (destination.vec_state == 1 || (destination.vec_state == 0 && dimensions.size() < 2))
+            {
+                destination.set_size(elements, 1);
+            }
+            else if (destination.vec_state == 2)
+            {
+                destination.set_size(1, elements);
+            }
+            else
+            {
+                destination.set_size(dimensions[1], dimensions[0]);
+            }
+        }
+
+        static bool close_dataset(const hid_t dataset, const bool result)
+        {
+            if (dataset >= 0)
+            {
+                H5Dclose(dataset);
+            }
+            return result;
+        }
+
+        template <typename eT>
+        static bool read_into(const hid_t dataset, eT* memory, const unsigned long long elements)
+        {
+            if (elements == 0)
+            {
+                return true;
+            }
+
+            const hid_t type = hdf5_memory_type<eT>();
+            const bool read = H5Dread(dataset, type, H5S_ALL, H5S_ALL, H5P_DEFAULT, memory) >= 0;
+            H5Tclose(type);
+            return read;
+        }
+};
+
+#endif //HDF5_READER_H
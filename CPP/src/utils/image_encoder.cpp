@@ -0,0 +1,239 @@
+#include "image_encoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include "hdf5_reader.h"
+
+namespace
+{
+    double magnitude(const double* values, const size_t i, const bool complex)
+    {
+        return complex ? std::hypot(values[2 * i], values[2 * i + 1]) : std::abs(values[i]);
+    }
+
+    template <typename T>
+    std::vector<unsigned char> as_bytes(const std::vector<T>& values)
+    {
+        std::vector<unsigned char> bytes(values.size() * sizeof(T));
+        std::memcpy(bytes.data(), values.data(), bytes.size());
+        return bytes;
+    }
+
+    template <typename T>
+    std::vector<unsigned char> quantised_decibels(const double* values, const size_t elements, const bool complex,
+        const double dynamicRange, double& scale, double& offset)
+    {
+        constexpr double levels = static_cast<double>(std::numeric_limits<T>::max());
+        double peak = 0;
+        for (size_t i = 0; i < elements; i++)
+        {
+            peak = std::max(peak, magnitude(values, i, complex));
+        }
+
+        offset = (peak > 0 ? 20 * std::log10(peak) : 0) - dynamicRange;
+        scale = dynamicRange / levels;
+        std::vector<T> quantised(elements);
+        for (size_t i = 0; i < elements; i++)
+        {
+            const double value = magnitude(values, i, complex);
+            const double step = value > 0 ? (20 * std::log10(value) - offset) / scale : 0;
+            quantised[i] = static_cast<T>(std::lround(std::clamp(step, 0.0, levels)));
+        }
+        return as_bytes(quantised);
+    }
+}
+
+image_encoder::image_encoder(const output_encodings encoding, const double dynamicRange)
+    : outputEncoding(encoding), dynamicRange(dynamicRange > 0 ? dynamicRange : 60)
+{
+}
+
+hid_t image_encoder::file_type(const bool complex) const
+{
+    switch (outputEncoding)
+    {
+        case output_encodings::FLOAT:
+        {
+            if (!complex)
+            {
+                return H5Tcopy(H5T_IEEE_F32LE);
+            }
+            const hid_t type = H5Tcreate(H5T_COMPOUND, 2 * sizeof(float));
+            H5Tinsert(type, "real", 0, H5T_IEEE_F32LE);
+            H5Tinsert(type, "imag", sizeof(float), H5T_IEEE_F32LE);
+            return type;
+        }
+        case output_encodings::MAGNITUDE_HALF:
+        {
+            // IEEE binary16, which HDF5 1.10 has no predefined type for. The fields move into the low 16 bits before the size
+            // shrinks to 2 bytes, as HDF5 rejects a size the fields do not fit in.
+            const hid_t type = H5Tcopy(H5T_IEEE_F32LE);
+            if (H5Tset_fields(type, 15, 10, 5, 0, 10) < 0 || H5Tset_size(type, 2) < 0 || H5Tset_ebias(type, 15) < 0)
+            {
+                H5Tclose(type);
+                return -1;
+            }
+            return type;
+        }
+        case output_encodings::DB_UINT8:
+            return H5Tcopy(H5T_STD_U8LE);
+        case output_encodings::DB_UINT16:
+            return H5Tcopy(H5T_STD_U16LE);
+        default:
+            return complex ? hdf5_memory_type<std::complex<double>>() : hdf5_memory_type<double>();
+    }
+}
+
+hid_t image_encoder::memory_type(const bool complex) const
+{
+    switch (outputEncoding)
+    {
+        case output_encodings::MAGNITUDE_HALF:
+            return H5Tcopy(H5T_NATIVE_FLOAT);
+        case output_encodings::DB_UINT8:
+            return H5Tcopy(H5T_NATIVE_UINT8);
+        case output_encodings::DB_UINT16:
+            return H5Tcopy(H5T_NATIVE_UINT16);
+        default:
+            return complex ? hdf5_memory_type<std::complex<double>>() : hdf5_memory_type<double>();
+    }
+}
+
+hid_t image_encoder::creation_properties(const int rank, const hsize_t* chunk) const
+{
+    const hid_t properties = H5Pcreate(H5P_DATASET_CREATE);
+    H5Pset_chunk(properties, rank, chunk);
+    if (outputEncoding != output_encodings::NATIVE)
+    {
+        H5Pset_shuffle(properties);
+        if (H5Zfilter_avail(H5Z_FILTER_DEFLATE) > 0)
+        {
+            H5Pset_deflate(properties, 4);
+        }
+    }
+    return properties;
+}
+
+std::vector<unsigned char> image_encoder::encode(const double* values, const size_t elements, const bool complex,
+    double& scale, double& offset) const
+{
+    scale = 1;
+    offset = 0;
+    switch (outputEncoding)
+    {
+        case output_encodings::MAGNITUDE_HALF:
+        {
+            double peak = 0;
+            for (size_t i = 0; i < elements; i++)
+            {
+                peak = std::max(peak, magnitude(values, i, complex));
+            }
+
+            scale = peak > 0 ? peak : 1;
+            std::vector<float> normalised(elements);
+            for (size_t i = 0; i < elements; i++)
+            {
+                normalised[i] = static_cast<float>(magnitude(values, i, complex) / scale);
+            }
+            return as_bytes(normalised);
+        }
+        case output_encodings::DB_UINT8:
+            return quantised_decibels<std::uint8_t>(values, elements, complex, dynamicRange, scale, offset);
+        case output_encodings::DB_UINT16:
+            return quantised_decibels<std::uint16_t>(values, elements, complex, dynamicRange, scale, offset);
+        default:
+        {
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(values);
+            return std::vector<unsigned char>(bytes, bytes + elements * (complex ? 2 : 1) * sizeof(double));
+        }
+    }
+}
+
+bool image_encoder::write_attributes(const hid_t dataset, const double scale, const double offset) const
+{
+    bool written = true;
+    const hid_t space = H5Screate(H5S_SCALAR);
+    for (const auto& [attributeName, value] : {std::pair<const char*, double>{"scale", scale}, {"offset", offset}})
+    {
+        const hid_t attribute = H5Acreate2(dataset, attributeName, H5T_IEEE_F64LE, space, H5P_DEFAULT, H5P_DEFAULT);
+        written = written && attribute >= 0 && H5Awrite(attribute, H5T_NATIVE_DOUBLE, &value) >= 0;
+        if (attribute >= 0)
+        {
+            H5Aclose(attribute);
+        }
+    }
+    H5Sclose(space);
+    return write_name(dataset) && written;
+}
+
+bool image_encoder::write_name(const hid_t dataset) const
+{
+    const std::string text = name(outputEncoding);
+    const hid_t space = H5Screate(H5S_SCALAR);
+    const hid_t type = H5Tcopy(H5T_C_S1);
+    H5Tset_size(type, text.size());
+    const hid_t attribute = H5Acreate2(dataset, "encoding", type, space, H5P_DEFAULT, H5P_DEFAULT);
+    const bool written = attribute >= 0 && H5Awrite(attribute, type, text.c_str()) >= 0;
+    if (attribute >= 0)
+    {
+        H5Aclose(attribute);
+    }
+    H5Tclose(type);
+    H5Sclose(space);
+    return written;
+}
+
+bool image_encoder::write(const hid_t location, const std::string& datasetName, const std::vector<hsize_t>& dimensions,
+    const double* values, const bool complex) const
+{
+    hsize_t elements = 1;
+    for (const hsize_t dimension : dimensions)
+    {
+        elements *= dimension;
+    }
+
+    double scale, offset;
+    const std::vector<unsigned char> encoded = encode(values, elements, complex, scale, offset);
+    const int rank = static_cast<int>(dimensions.size());
+    const hid_t space = H5Screate_simple(rank, dimensions.data(), nullptr);
+    const hid_t fileType = file_type(complex);
+    const hid_t memoryType = memory_type(complex);
+    const hid_t properties = creation_properties(rank, dimensions.data());
+    const hid_t dataset = H5Dcreate2(location, datasetName.c_str(), fileType, space, H5P_DEFAULT, properties, H5P_DEFAULT);
+    const bool written = dataset >= 0 && H5Dwrite(dataset, memoryType, H5S_ALL, H5S_ALL, H5P_DEFAULT, encoded.data()) >= 0
+        && write_attributes(dataset, scale, offset);
+    if (dataset >= 0)
+    {
+        H5Dclose(dataset);
+    }
+    H5Pclose(properties);
+    H5Tclose(memoryType);
+    if (fileType >= 0)
+    {
+        H5Tclose(fileType);
+    }
+    H5Sclose(space);
+    return written;
+}
+
+std::string image_encoder::name(const output_encodings encoding)
+{
+    switch (encoding)
+    {
+        case output_encodings::FLOAT:
+            return "float";
+        case output_encodings::MAGNITUDE_HALF:
+            return "magnitude_half";
+        case output_encodings::DB_UINT8:
+            return "db_uint8";
+        case output_encodings::DB_UINT16:
+            return "db_uint16";
+        default:
+            return "native";
+    }
+}
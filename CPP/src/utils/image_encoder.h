@@ -0,0 +1,59 @@
+#ifndef IMAGE_ENCODER_H
+#define IMAGE_ENCODER_H
+
+#include <hdf5.h>
+#include <string>
+#include <vector>
+
+#include "../output_encodings.h"
+
+/*-------------------------------------------------------------------------
+ * Turns images of doubles, complex ones interleaved as {real, imag}, into
+ * the values an output_encodings stores, and describes them to HDF5.
+ *
+ * encode returns the values in the memory type; HDF5 converts them to the
+ * file type as they are written, which is how FLOAT narrows to float32 and
+ * MAGNITUDE_HALF to float16. dB encodings map the dynamicRange decibels
+ * below the image peak onto the full integer range and clamp what falls
+ * under it, so offset is the floor in dB and scale the dB per step.
+ *------------------------------------------------------------------------*/
+class image_encoder
+{
+    public:
+        explicit image_encoder(output_encodings encoding = output_encodings::NATIVE, double dynamicRange = 60);
+
+        output_encodings encoding() const
+        {
+            return outputEncoding;
+        }
+
+        // Type of the stored values, or a negative id if HDF5 cannot make it; close with H5Tclose.
+        hid_t file_type(bool complex) const;
+
+        // Type of the values encode returns; close with H5Tclose.
+        hid_t memory_type(bool complex) const;
+
+        // Dataset creation properties chunked by chunk, filtered unless NATIVE; close with H5Pclose.
+        hid_t creation_properties(int rank, const hsize_t* chunk) const;
+
+        std::vector<unsigned char> encode(const double* values, size_t elements, bool complex, double& scale, double& offset) const;
+
+        // Attaches scale, offset and the encoding name to a dataset.
+        bool write_attributes(hid_t dataset, double scale, double offset) const;
+
+        // Attaches the encoding name alone, for datasets that keep scale and offset elsewhere.
+        bool write_name(hid_t dataset) const;
+
+        // Creates location/datasetName, one chunk of dimensions, and writes the encoded values with their attributes.
+        bool write(hid_t location, const std::string& datasetName, const std::vector<hsize_t>& dimensions,
+            const double* values, bool complex) const;
+
+        static std::string name(output_encodings encoding);
+
+    private:
+        output_encodings outputEncoding;
+
+        double dynamicRange;
+};
+
+#endif //IMAGE_ENCODER_H
@@ -0,0 +1,421 @@
+#include "image_sink.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include "hdf5_reader.h"
+
+image_sink::image_sink(const std::string& savePath, const size_t batchSize, const output_encodings encoding)
+    : batchSize(batchSize > 0 ? batchSize : 1), encoder(encoding), batches(2)
+{
+    std::filesystem::create_directories(savePath);
+    int locked = 1;
+    for (int sequence = 0; locked == 1; sequence++)
+    {
+        sinkPath = savePath + "/images" + (sequence == 0 ? "" : "_" + std::to_string(sequence)) + ".hdf5";
+        locked = lock_file(sinkPath);
+    }
+    if (locked != 0)
+    {
+        std::cout << "[Error] image_sink failed to lock <" << sinkPath << ">." << std::endl;
+        failed = true;
+    }
+    writer = std::thread(&image_sink::write_loop, this);
+}
+
+image_sink::~image_sink()
+{
+    close();
+}
+
+int image_sink::lock_file(const std::string& path)
+{
+    const std::string lockPath = path + ".lock";
+    const int descriptor = open(lockPath.c_str(), O_RDWR | O_CREAT, 0644);
+    if (descriptor < 0)
+    {
+        return -1;
+    }
+
+    int result;
+    while ((result = flock(descriptor, LOCK_EX | LOCK_NB)) != 0 && errno == EINTR)
+    {
+    }
+    if (result != 0)
+    {
+        const bool held = errno == EWOULDBLOCK;
+        ::close(descriptor);
+        return held ? 1 : -1;
+    }
+
+    lockDescriptor = descriptor;
+    return 0;
+}
+
+void image_sink::commit(const std::string& source, std::function<void(bool)> written)
+{
+    pending.commitments.push_back({source, std::move(written)});
+
+    // Without images of its own the batch holds only sources already handed over, so they need not wait for more.
+    if (pending.images.empty() || pending.images.size() >= batchSize)
+    {
+        hand_over();
+    }
+}
+
+bool image_sink::close()
+{
+    if (writer.joinable())
+    {
+        hand_over();
+        batches.close();
+        writer.join();
+
+        std::lock_guard<std::mutex> lock(hdf5_mutex());
+        if (file >= 0)
+        {
+            H5Fclose(file);
+            file = -1;
+        }
+    }
+
+    if (lockDescriptor >= 0)
+    {
+        flock(lockDescriptor, LOCK_UN);
+        ::close(lockDescriptor);
+        lockDescriptor = -1;
+    }
+    return !failed;
+}
+
+void image_sink::hand_over()
+{
+    if (pending.images.empty() && pending.commitments.empty())
+    {
+        return;
+    }
+
+    const size_t count = pending.images.size();
+    std::vector<commitment> commitments = pending.commitments;
+    if (!batches.push(std::move(pending)))
+    {
+        std::cout << "[Error] image_sink <" << sinkPath << "> is closed; " << count << " images were dropped." << std::endl;
+        failed = true;
+        for (const commitment& item : commitments)
+        {
+            item.written(false);
+        }
+    }
+    pending = batch();
+}
+
+void image_sink::write_loop()
+{
+    // Sources with an image that failed, until their commitment reports it.
+    std::set<std::string> failedSources;
+    batch item;
+    while (batches.pop(item))
+    {
+        for (std::string& source : write_batch(item.images))
+        {
+            failedSources.insert(std::move(source));
+        }
+
+        // Reported outside the HDF5 lock, as what the callers do with it may take a while.
+        for (const commitment& done : item.commitments)
+        {
+            done.written(failedSources.erase(done.source) == 0);
+        }
+    }
+}
+
+std::vector<std::string> image_sink::write_batch(const std::vector<image>& images)
+{
+    std::vector<std::string> failedSources;
+    const auto fail_all = [&images, &failedSources]
+    {
+        for (const image& item : images)
+        {
+            failedSources.push_back(item.source);
+        }
+        return failedSources;
+    };
+
+    std::lock_guard<std::mutex> lock(hdf5_mutex());
+    if (file < 0)
+    {
+        file = lockDescriptor < 0 ? -1
+            : std::filesystem::exists(sinkPath)
+            ? H5Fopen(sinkPath.c_str(), H5F_ACC_RDWR, H5P_DEFAULT)
+            : H5Fcreate(sinkPath.c_str(), H5F_ACC_EXCL, H5P_DEFAULT, H5P_DEFAULT);
+        if (file < 0)
+        {
+            std::cout << "[Error] image_sink failed to open <" << sinkPath << ">." << std::endl;
+            failed = true;
+            return fail_all();
+        }
+    }
+
+    // An image goes to its field's group unless that holds images of another size or type; it then goes to a group of its own layout.
+    std::vector<std::string> groups(images.size());
+    std::map<std::string, const image*> created;
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        const image& item = images[i];
+        for (const std::string& group : {item.field, item.field + "_" + layout_name(item)})
+        {
+            const auto planned = created.find(group);
+            const bool fits = planned != created.end()
+                ? planned->second->dimensions == item.dimensions && planned->second->complex == item.complex
+                : !hdf5_link_exists(file, group) || holds(group, item);
+            if (fits)
+            {
+                groups[i] = group;
+                if (planned == created.end() && !hdf5_link_exists(file, group))
+                {
+                    created.emplace(group, &item);
+                }
+                break;
+            }
+        }
+
+        if (groups[i].empty())
+        {
+            std::cout << "[Error] image_sink has no group for the <" << item.field << "> image of <" << item.source
+                << "> in <" << sinkPath << ">." << std::endl;
+            failedSources.push_back(item.source);
+            failed = true;
+        }
+    }
+
+    // Each group is extended once per batch, its images in the order they were appended.
+    std::vector<bool> written(images.size(), false);
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        if (written[i] || groups[i].empty())
+        {
+            continue;
+        }
+
+        std::vector<const image*> group;
+        for (size_t j = i; j < images.size(); j++)
+        {
+            if (!written[j] && groups[j] == groups[i])
+            {
+                group.push_back(&images[j]);
+                written[j] = true;
+            }
+        }
+
+        if (!write_field(groups[i], group))
+        {
+            std::cout << "[Error] image_sink failed to write " << group.size() << " <" << groups[i]
+                << "> images to <" << sinkPath << ">." << std::endl;
+            for (const image* item : group)
+            {
+                failedSources.push_back(item->source);
+            }
+            failed = true;
+        }
+    }
+
+    if (H5Fflush(file, H5F_SCOPE_LOCAL) < 0)
+    {
+        std::cout << "[Error] image_sink failed to flush <" << sinkPath << ">." << std::endl;
+        failed = true;
+        return fail_all();
+    }
+    return failedSources;
+}
+
+bool image_sink::write_field(const std::string& field, const std::vector<const image*>& images)
+{
+    const image& first = *images.front();
+    const size_t rank = first.dimensions.size() + 1;
+    std::vector<hsize_t> dimensions(rank, 0);
+    std::copy(first.dimensions.begin(), first.dimensions.end(), dimensions.begin() + 1);
+    for (const image* item : images)
+    {
+        if (item->dimensions != first.dimensions || item->complex != first.complex)
+        {
+            return false;
+        }
+    }
+
+    const hid_t stringType = H5Tcopy(H5T_C_S1);
+    H5Tset_size(stringType, H5T_VARIABLE);
+    if (!hdf5_link_exists(file, field))
+    {
+        const hid_t group = H5Gcreate2(file, field.c_str(), H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+        std::vector<hsize_t> maximum = dimensions;
+        maximum[0] = H5S_UNLIMITED;
+        std::vector<hsize_t> chunk = dimensions;
+        chunk[0] = 1;
+        hid_t space = H5Screate_simple(static_cast<int>(rank), dimensions.data(), maximum.data());
+        hid_t properties = encoder.creation_properties(static_cast<int>(rank), chunk.data());
+        const hid_t type = encoder.file_type(first.complex);
+        const hid_t data = H5Dcreate2(group, "data", type, space, H5P_DEFAULT, properties, H5P_DEFAULT);
+        if (data >= 0)
+        {
+            encoder.write_name(data);
+            H5Dclose(data);
+        }
+        if (type >= 0)
+        {
+            H5Tclose(type);
+        }
+        H5Pclose(properties);
+        H5Sclose(space);
+
+        const hsize_t none = 0;
+        const hsize_t unlimited = H5S_UNLIMITED;
+        const hsize_t rowChunk = batchSize;
+        space = H5Screate_simple(1, &none, &unlimited);
+        properties = H5Pcreate(H5P_DATASET_CREATE);
+        H5Pset_chunk(properties, 1, &rowChunk);
+        for (const auto& [name, rowType] : {std::pair<const char*, hid_t>{"source", stringType}, {"scale", H5T_IEEE_F64LE}, {"offset", H5T_IEEE_F64LE}})
+        {
+            const hid_t dataset = H5Dcreate2(group, name, rowType, space, H5P_DEFAULT, properties, H5P_DEFAULT);
+            if (dataset >= 0)
+            {
+                H5Dclose(dataset);
+            }
+        }
+        H5Pclose(properties);
+        H5Sclose(space);
+        H5Gclose(group);
+    }
+
+    // The images are encoded into one contiguous block, with their scales and offsets and sources alongside.
+    const hsize_t count = images.size();
+    std::vector<unsigned char> values;
+    std::vector<double> scales(count);
+    std::vector<double> offsets(count);
+    std::vector<const char*> sources(count);
+    for (hsize_t i = 0; i < count; i++)
+    {
+        const std::vector<unsigned char> encoded = encoder.encode(images[i]->values.data(),
+            images[i]->values.size() / (first.complex ? 2 : 1), first.complex, scales[i], offsets[i]);
+        values.insert(values.end(), encoded.begin(), encoded.end());
+        sources[i] = images[i]->source.c_str();
+    }
+
+    const hid_t data = H5Dopen2(file, (field + "/data").c_str(), H5P_DEFAULT);
+    bool result = data >= 0;
+    hsize_t row = 0;
+    if (result)
+    {
+        const hid_t existingSpace = H5Dget_space(data);
+        std::vector<hsize_t> existing(rank, 0);
+        result = H5Sget_simple_extent_ndims(existingSpace) == static_cast<int>(rank);
+        if (result)
+        {
+            H5Sget_simple_extent_dims(existingSpace, existing.data(), nullptr);
+            result = std::equal(existing.begin() + 1, existing.end(), dimensions.begin() + 1);
+        }
+        H5Sclose(existingSpace);
+        row = existing[0];
+    }
+
+    if (result)
+    {
+        std::vector<hsize_t> extent = dimensions;
+        extent[0] = row + count;
+        std::vector<hsize_t> start(rank, 0);
+        start[0] = row;
+        std::vector<hsize_t> block = dimensions;
+        block[0] = count;
+
+        H5Dset_extent(data, extent.data());
+        const hid_t fileSpace = H5Dget_space(data);
+        const hid_t memorySpace = H5Screate_simple(static_cast<int>(rank), block.data(), nullptr);
+        const hid_t memoryType = encoder.memory_type(first.complex);
+        H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, start.data(), nullptr, block.data(), nullptr);
+        result = H5Dwrite(data, memoryType, memorySpace, fileSpace, H5P_DEFAULT, values.data()) >= 0;
+        H5Tclose(memoryType);
+        H5Sclose(memorySpace);
+        H5Sclose(fileSpace);
+    }
+    if (data >= 0)
+    {
+        H5Dclose(data);
+    }
+
+    result = result && append_rows(field + "/source", stringType, row, count, sources.data())
+        && append_rows(field + "/scale", H5T_NATIVE_DOUBLE, row, count, scales.data())
+        && append_rows(field + "/offset", H5T_NATIVE_DOUBLE, row, count, offsets.data());
+    H5Tclose(stringType);
+    return result;
+}
+
+bool image_sink::holds(const std::string& group, const image& item) const
+{
+    const hid_t data = H5Dopen2(file, (group + "/data").c_str(), H5P_DEFAULT);
+    if (data < 0)
+    {
+        return false;
+    }
+
+    const hid_t space = H5Dget_space(data);
+    const int rank = H5Sget_simple_extent_ndims(space);
+    bool result = rank == static_cast<int>(item.dimensions.size()) + 1;
+    if (result)
+    {
+        std::vector<hsize_t> existing(rank, 0);
+        H5Sget_simple_extent_dims(space, existing.data(), nullptr);
+        result = std::equal(existing.begin() + 1, existing.end(), item.dimensions.begin());
+    }
+
+    const hid_t existingType = H5Dget_type(data);
+    const hid_t type = encoder.file_type(item.complex);
+    result = result && type >= 0 && H5Tequal(existingType, type) > 0;
+    if (type >= 0)
+    {
+        H5Tclose(type);
+    }
+    H5Tclose(existingType);
+    H5Sclose(space);
+    H5Dclose(data);
+    return result;
+}
+
+std::string image_sink::layout_name(const image& item)
+{
+    // Sizes read rows x cols (x slices), as Armadillo gives them; the dimensions are stored the other way round.
+    std::ostringstream stream;
+    for (auto dimension = item.dimensions.rbegin(); dimension != item.dimensions.rend(); ++dimension)
+    {
+        stream << (dimension == item.dimensions.rbegin() ? "" : "x") << *dimension;
+    }
+    stream << (item.complex ? "_complex" : "");
+    return stream.str();
+}
+
+bool image_sink::append_rows(const std::string& name, const hid_t type, const hsize_t row, const hsize_t count, const void* values)
+{
+    const hid_t dataset = H5Dopen2(file, name.c_str(), H5P_DEFAULT);
+    if (dataset < 0)
+    {
+        return false;
+    }
+
+    const hsize_t extent = row + count;
+    H5Dset_extent(dataset, &extent);
+    const hid_t fileSpace = H5Dget_space(dataset);
+    const hid_t memorySpace = H5Screate_simple(1, &count, nullptr);
+    H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, &row, nullptr, &count, nullptr);
+    const bool written = H5Dwrite(dataset, type, memorySpace, fileSpace, H5P_DEFAULT, values) >= 0;
+    H5Sclose(memorySpace);
+    H5Sclose(fileSpace);
+    H5Dclose(dataset);
+    return written;
+}
@@ -0,0 +1,174 @@
+#ifndef IMAGE_SINK_H
+#define IMAGE_SINK_H
+
+#include <armadillo>
+#include <atomic>
+#include <complex>
+#include <functional>
+#include <hdf5.h>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "image_encoder.h"
+#include "bounded_queue.h"
+
+/*-------------------------------------------------------------------------
+ * Appends the images of batch runs to one HDF5 file in savePath, in place
+ * of a file per image. The file is savePath/images.hdf5, so later runs
+ * append to it; a sink finding that file locked by another process takes
+ * images_1.hdf5, images_2.hdf5, ... instead, so concurrent workers each
+ * keep a file of their own, which they also reuse across runs. The lock is
+ * an flock on <file>.lock, held until close, which the kernel releases if
+ * the process dies.
+ *
+ * Each field (the image, its _Corr image, ...) is a group holding two
+ * extendable datasets:
+ *
+ *   <field>/data    images stacked along the first dimension, one chunk
+ *                   per image, each laid out as Armadillo saves it and
+ *                   stored in the sink's output encoding
+ *   <field>/source  the input path of every row of data
+ *   <field>/scale   with offset, decodes row i of data as
+ *   <field>/offset  data[i] * scale[i] + offset[i]
+ *
+ * so row i of data was made from source[i]. A field's group takes the
+ * size and stored type of its first image; an image of another size or
+ * type goes to the group <field>_<rows>x<cols>, with _complex appended for
+ * complex images, instead. An existing file is appended to.
+ *
+ * append copies the image and returns at once; every batchSize images the
+ * batch goes to a writer thread, which extends each dataset once per batch
+ * and writes its rows with one hyperslab, then flushes the file. commit
+ * ends the images of a source: written(true) is called from the writer
+ * thread once they are all flushed to the file, and written(false) if any
+ * of them failed. close, or the destructor, hands over what is pending,
+ * waits for the writer and closes the file. append, commit and close are
+ * called from one thread, as the pipelined_run writer does.
+ *------------------------------------------------------------------------*/
+class image_sink
+{
+    public:
+        explicit image_sink(const std::string& savePath, size_t batchSize = 64, output_encodings encoding = output_encodings::NATIVE);
+
+        ~image_sink();
+
+        image_sink(const image_sink&) = delete;
+
+        image_sink& operator=(const image_sink&) = delete;
+
+        // False once an earlier write has failed; whether this image reaches the file is reported through commit.
+        template <typename eT>
+        bool append(const std::string& source, const std::string& field, const arma::Mat<eT>& image)
+        {
+            return append(source, field, {image.n_cols, image.n_rows}, is_complex<eT>(), image.memptr(), image.n_elem);
+        }
+
+        template <typename eT>
+        bool append(const std::string& source, const std::string& field, const arma::Cube<eT>& image)
+        {
+            return append(source, field, {image.n_slices, image.n_cols, image.n_rows}, is_complex<eT>(), image.memptr(), image.n_elem);
+        }
+
+        // Calls written once every image appended for source so far is in the file, from the writer thread.
+        void commit(const std::string& source, std::function<void(bool)> written);
+
+        // Writes every pending image and closes the file; false if any write failed. Later appends fail.
+        bool close();
+
+        const std::string& path() const
+        {
+            return sinkPath;
+        }
+
+    private:
+        struct image
+        {
+            std::string source;
+
+            std::string field;
+
+            std::vector<hsize_t> dimensions;
+
+            bool complex;
+
+            // Complex values interleaved as {real, imag}, as in memory.
+            std::vector<double> values;
+        };
+
+        struct commitment
+        {
+            std::string source;
+
+            std::function<void(bool)> written;
+        };
+
+        // The images handed to the writer at once, with the sources they complete.
+        struct batch
+        {
+            std::vector<image> images;
+
+            std::vector<commitment> commitments;
+        };
+
+        std::string sinkPath;
+
+        int lockDescriptor = -1;
+
+        size_t batchSize;
+
+        image_encoder encoder;
+
+        batch pending;
+
+        bounded_queue<batch> batches;
+
+        std::thread writer;
+
+        std::atomic<bool> failed{false};
+
+        hid_t file = -1;
+
+        template <typename eT>
+        static constexpr bool is_complex()
+        {
+            static_assert(std::is_same_v<eT, double> || std::is_same_v<eT, std::complex<double>>, "Images are double or std::complex<double>");
+            return std::is_same_v<eT, std::complex<double>>;
+        }
+
+        template <typename eT>
+        bool append(const std::string& source, const std::string& field, std::vector<hsize_t> dimensions, const bool complex,
+            const eT* memory, const arma::uword elements)
+        {
+            const double* values = reinterpret_cast<const double*>(memory);
+            pending.images.push_back({source, field, std::move(dimensions), complex,
+                std::vector<double>(values, values + elements * (complex ? 2 : 1))});
+            if (pending.images.size() >= batchSize)
+            {
+                hand_over();
+            }
+            return !failed;
+        }
+
+        // 0 once path is locked for this sink, 1 if another sink holds it, -1 if it cannot be locked.
+        int lock_file(const std::string& path);
+
+        void hand_over();
+
+        void write_loop();
+
+        // Writes the images of a batch and flushes the file; returns the sources of the images that failed.
+        std::vector<std::string> write_batch(const std::vector<image>& images);
+
+        bool write_field(const std::string& field, const std::vector<const image*>& images);
+
+        // Whether group holds images of this one's size and stored type.
+        bool holds(const std::string& group, const image& item) const;
+
+        static std::string layout_name(const image& item);
+
+        bool append_rows(const std::string& name, hid_t type, hsize_t row, hsize_t count, const void* values);
+};
+
+#endif //IMAGE_SINK_H
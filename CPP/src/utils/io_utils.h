@@ -2,88 +2,54 @@
 #define IO_UTILS_H
 
 #include <armadillo>
+#include <mutex>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 #include "file_utils.h"
-
-inline void load_debug_message(const bool debug, const std::string& dataPath, const std::string& dataName)
-{
-    if (debug)
-    {
-        std::cout << "Failed to find " + dataName + " data associated with " + dataPath << std::endl;
-    }
-}
+#include "hdf5_reader.h"
+#include "image_encoder.h"
 
 inline bool load_data(arma::mat& destination, const std::string& dataPath, const std::string& dataName, const bool debug = false)
 {
-    if (!destination.load(arma::hdf5_name(dataPath, dataName)) && !destination.load(arma::hdf5_name(dataPath, "data/" + dataName)))
-    {
-        load_debug_message(debug, dataPath, dataName);
-        return false;
-    }
-    return true;
+    hdf5_reader reader(dataPath, debug);
+    return reader.read(destination, dataName);
 };
 
 inline bool load_data(arma::cx_mat& destination, const std::string& dataPath, const std::string& dataName, const bool debug = false)
 {
-    if (!destination.load(arma::hdf5_name(dataPath, dataName)) && !destination.load(arma::hdf5_name(dataPath, "data/" + dataName)))
-    {
-        load_debug_message(debug, dataPath, dataName);
-        return false;
-    }
-    return true;
+    hdf5_reader reader(dataPath, debug);
+    return reader.read(destination, dataName);
 };
 
 inline bool load_data(arma::cube& destination, const std::string& dataPath, const std::string& dataName, const bool debug = false)
 {
-    if (!destination.load(arma::hdf5_name(dataPath, dataName)) && !destination.load(arma::hdf5_name(dataPath, "data/" + dataName)))
-    {
-        load_debug_message(debug, dataPath, dataName);
-        return false;
-    }
-    return true;
+    hdf5_reader reader(dataPath, debug);
+    return reader.read(destination, dataName);
 };
 
 inline bool load_data(arma::cx_cube& destination, const std::string& dataPath, const std::string& dataName, const bool debug = false)
 {
-    if (!destination.load(arma::hdf5_name(dataPath, dataName)) && !destination.load(arma::hdf5_name(dataPath, "data/" + dataName)))
-    {
-        load_debug_message(debug, dataPath, dataName);
-        return false;
-    }
-    return true;
+    hdf5_reader reader(dataPath, debug);
+    return reader.read(destination, dataName);
 };
 
 inline bool load_data(double& destination, const std::string& dataPath, const std::string& dataName, const bool debug = false)
 {
-    if (arma::vec temp; !temp.load(arma::hdf5_name(dataPath, dataName)) && !temp.load(arma::hdf5_name(dataPath, "data/" + dataName)))
-    {
-        load_debug_message(debug, dataPath, dataName);
-        return false;
-    }
-    else
-    {
-        destination = static_cast<double>(temp.at(0));
-    }
-    return true;
+    hdf5_reader reader(dataPath, debug);
+    return reader.read(destination, dataName);
 };
 
 inline bool load_data(int& destination, const std::string& dataPath, const std::string& dataName, const bool debug = false)
 {
-    if (arma::vec temp; !temp.load(arma::hdf5_name(dataPath,  dataName)) && !temp.load(arma::hdf5_name(dataPath, "data/" + dataName)))
-    {
-        load_debug_message(debug, dataPath, dataName);
-        return false;
-    }
-    else
-    {
-        destination = static_cast<int>(temp.at(0));
-    }
-    return true;
+    hdf5_reader reader(dataPath, debug);
+    return reader.read(destination, dataName);
 };
 
 static bool save_data(const arma::mat& data, const std::string& savePath, const std::string& saveName)
 {
+    std::lock_guard<std::mutex> lock(hdf5_mutex());
     std::filesystem::create_directory(savePath);
     std::string outputName = saveName;
     if (has_extension(saveName))
@@ -97,6 +63,7 @@ static bool save_data(const arma::mat& data, const std::string& savePath, const
 
 static bool save_data(const arma::cx_mat& data, const std::string& savePath, const std::string& saveName)
 {
+    std::lock_guard<std::mutex> lock(hdf5_mutex());
     std::filesystem::create_directory(savePath);
     std::string outputName = saveName;
     if (has_extension(saveName))
@@ -110,6 +77,7 @@ static bool save_data(const arma::cx_mat& data, const std::string& savePath, con
 
 static bool save_data(const arma::cube& data, const std::string& savePath, const std::string& saveName)
 {
+    std::lock_guard<std::mutex> lock(hdf5_mutex());
     std::filesystem::create_directory(savePath);
     std::string outputName = saveName;
     if (has_extension(saveName))
@@ -123,6 +91,7 @@ static bool save_data(const arma::cube& data, const std::string& savePath, const
 
 static bool save_data(const arma::cx_cube& data, const std::string& savePath, const std::string& saveName)
 {
+    std::lock_guard<std::mutex> lock(hdf5_mutex());
     std::filesystem::create_directory(savePath);
     std::string outputName = saveName;
     if (has_extension(saveName))
@@ -133,4 +102,41 @@ static bool save_data(const arma::cx_cube& data, const std::string& savePath, co
     }
     return data.save(savePath + "/" + outputName + ".hdf5", arma::hdf5_binary);
 }
+
+// Writes savePath/saveName.hdf5 in an output encoding, laid out as Armadillo lays it out; NATIVE is the plain save_data.
+template <typename T>
+static bool save_data(const T& data, const std::string& savePath, const std::string& saveName, const output_encodings encoding)
+{
+    if (encoding == output_encodings::NATIVE)
+    {
+        return save_data(data, savePath, saveName);
+    }
+
+    std::vector<hsize_t> dimensions = {data.n_cols, data.n_rows};
+    if constexpr (arma::is_Cube<T>::value)
+    {
+        dimensions.insert(dimensions.begin(), data.n_slices);
+    }
+
+    std::lock_guard<std::mutex> lock(hdf5_mutex());
+    std::filesystem::create_directory(savePath);
+    std::string outputName = saveName;
+    if (has_extension(saveName))
+    {
+        std::string parent, name, extension;
+        get_file_info(saveName, parent, name, extension);
+        outputName = name;
+    }
+
+    const hid_t file = H5Fcreate((savePath + "/" + outputName + ".hdf5").c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    if (file < 0)
+    {
+        return false;
+    }
+
+    const bool saved = image_encoder(encoding).write(file, "dataset", dimensions, reinterpret_cast<const double*>(data.memptr()),
+        std::is_same_v<typename T::elem_type, arma::cx_double>);
+    H5Fclose(file);
+    return saved;
+}
 #endif //IO_UTILS_H
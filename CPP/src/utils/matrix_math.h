@@ -6,6 +6,8 @@
 #endif
 #include<armadillo>
 
+#include "fft_utils.h"
+
 inline void mesh_grid(arma::mat& X, arma::mat& Y, const arma::vec& x, const arma::vec& y)
 {
     X = repmat(x, 1, y.n_elem);
@@ -80,30 +82,136 @@ inline arma::cx_vec cx_fftshift(const arma::cx_mat& input)
     return circ_shift(input, shift[0], shift[1]);
 }
 
-inline arma::vec fftconv(const arma::cx_vec& first, const arma::cx_vec& second)
+/*-------------------------------------------------------------------------
+ * Linear interpolation of complex samples defined on a uniform grid.
+ * Equivalent to running arma::interp1 over the real and imaginary parts
+ * separately, but the bin index is computed directly from the grid spacing
+ * instead of being searched for, and both parts are produced in one pass.
+ * Queries outside [gridStart, gridEnd] take extrapolationValue, as they do
+ * with arma::interp1; the grid ends are compared directly rather than
+ * through the spacing, so a query on either end is interpolated exactly.
+ * T is float or double.
+ *------------------------------------------------------------------------*/
+template <typename T>
+inline void interp1_uniform(const T gridStart, const T gridEnd, const T* values, const long long valueCount,
+    const T* query, T* output, const long long queryCount, const std::complex<T> extrapolationValue = {0, 0})
+{
+    const T inverseStep = static_cast<T>(valueCount - 1) / (gridEnd - gridStart);
+    const long long lastBin = valueCount - 2;
+    const T extrapolationReal = extrapolationValue.real();
+    const T extrapolationImag = extrapolationValue.imag();
+#pragma omp simd
+    for (long long i = 0; i < queryCount; i++)
+    {
+        const bool inside = query[i] >= gridStart && query[i] <= gridEnd;
+        const T position = inside ? (query[i] - gridStart) * inverseStep : T(0);
+        long long bin = static_cast<long long>(position);
+        bin = bin < 0 ? 0 : (bin > lastBin ? lastBin : bin);
+        const T weight = position - static_cast<T>(bin);
+        const T lowerReal = values[2 * bin];
+        const T lowerImag = values[2 * bin + 1];
+        output[2 * i] = inside ? lowerReal + weight * (values[2 * bin + 2] - lowerReal) : extrapolationReal;
+        output[2 * i + 1] = inside ? lowerImag + weight * (values[2 * bin + 3] - lowerImag) : extrapolationImag;
+    }
+}
+
+template <typename T>
+inline void interp1_uniform(const T gridStart, const T gridEnd, const T* real, const T* imag, const long long valueCount,
+    const T* query, T* output, const long long queryCount, const std::complex<T> extrapolationValue = {0, 0})
+{
+    const T inverseStep = static_cast<T>(valueCount - 1) / (gridEnd - gridStart);
+    const long long lastBin = valueCount - 2;
+    const T extrapolationReal = extrapolationValue.real();
+    const T extrapolationImag = extrapolationValue.imag();
+#pragma omp simd
+    for (long long i = 0; i < queryCount; i++)
+    {
+        const bool inside = query[i] >= gridStart && query[i] <= gridEnd;
+        const T position = inside ? (query[i] - gridStart) * inverseStep : T(0);
+        long long bin = static_cast<long long>(position);
+        bin = bin < 0 ? 0 : (bin > lastBin ? lastBin : bin);
+        const T weight = position - static_cast<T>(bin);
+        output[2 * i] = inside ? real[bin] + weight * (real[bin + 1] - real[bin]) : extrapolationReal;
+        output[2 * i + 1] = inside ? imag[bin] + weight * (imag[bin + 1] - imag[bin]) : extrapolationImag;
+    }
+}
+
+// Interleaved variant; the grid must be uniformly spaced, as produced by arma::linspace.
+template <typename T>
+inline arma::Col<std::complex<T>> interp1_uniform(const arma::Col<T>& grid, const arma::Col<std::complex<T>>& values, const arma::Col<T>& query,
+    const std::complex<T> extrapolationValue = {0, 0})
+{
+    arma::Col<std::complex<T>> output(query.n_elem);
+    interp1_uniform<T>(grid(0), grid(grid.n_elem - 1), reinterpret_cast<const T*>(values.memptr()), values.n_elem,
+        query.memptr(), reinterpret_cast<T*>(output.memptr()), query.n_elem, extrapolationValue);
+    return output;
+}
+
+// Split variant, for when the real and imaginary parts are already held separately.
+template <typename T>
+inline arma::Col<std::complex<T>> interp1_uniform(const arma::Col<T>& grid, const arma::Col<T>& real, const arma::Col<T>& imag, const arma::Col<T>& query,
+    const std::complex<T> extrapolationValue = {0, 0})
+{
+    arma::Col<std::complex<T>> output(query.n_elem);
+    interp1_uniform<T>(grid(0), grid(grid.n_elem - 1), real.memptr(), imag.memptr(), real.n_elem,
+        query.memptr(), reinterpret_cast<T*>(output.memptr()), query.n_elem, extrapolationValue);
+    return output;
+}
+
+// Bilinear interpolation of a uniformly sampled complex matrix at a fractional (row, column) index. Zero outside the samples.
+template <typename T>
+inline std::complex<T> interp2_uniform(const arma::Mat<std::complex<T>>& values, const double row, const double col)
+{
+    const double lastRow = static_cast<double>(values.n_rows) - 1;
+    const double lastCol = static_cast<double>(values.n_cols) - 1;
+    if (!(row >= 0 && row <= lastRow && col >= 0 && col <= lastCol))
+    {
+        return {0, 0};
+    }
+
+    const unsigned long long i = std::min(static_cast<unsigned long long>(row), static_cast<unsigned long long>(std::max(lastRow - 1, 0.0)));
+    const unsigned long long j = std::min(static_cast<unsigned long long>(col), static_cast<unsigned long long>(std::max(lastCol - 1, 0.0)));
+    const unsigned long long nextI = std::min(i + 1, static_cast<unsigned long long>(lastRow));
+    const unsigned long long nextJ = std::min(j + 1, static_cast<unsigned long long>(lastCol));
+    const T rowWeight = static_cast<T>(row - static_cast<double>(i));
+    const T colWeight = static_cast<T>(col - static_cast<double>(j));
+    const std::complex<T> lower = values.at(i, j) + rowWeight * (values.at(nextI, j) - values.at(i, j));
+    const std::complex<T> upper = values.at(i, nextJ) + rowWeight * (values.at(nextI, nextJ) - values.at(i, nextJ));
+    return lower + colWeight * (upper - lower);
+}
+
+// The fast convolutions run in the precision of their inputs, float or double, through planned_fft.
+template <typename T>
+inline arma::Col<T> fftconv(const arma::Col<std::complex<T>>& first, const arma::Col<std::complex<T>>& second)
 {
-    double length = first.n_elem + second.n_elem - 1;
-    double paddedLength = pow(2, ceil(log2(length)));
-    arma::cx_vec first_fft = arma::fft(first, paddedLength);
-    arma::cx_vec second_fft = arma::fft(second, paddedLength);
-    arma::vec reals = arma::real(arma::ifft(first_fft % second_fft, paddedLength));
-    return length >= reals.n_elem ? reals : reals.head(length);
+    const long long length = first.n_elem + second.n_elem - 1;
+    const long long paddedLength = pow(2, ceil(log2(length)));
+    const arma::Col<std::complex<T>> first_fft = planned_fft(first, paddedLength);
+    const arma::Col<std::complex<T>> second_fft = planned_fft(second, paddedLength);
+    arma::Col<T> reals = arma::real(planned_ifft(arma::Col<std::complex<T>>(first_fft % second_fft), paddedLength));
+    return length >= static_cast<long long>(reals.n_elem) ? reals : reals.head(length);
 }
 
-inline arma::vec fftconv(const arma::cx_vec& first, const arma::cx_vec& second, const long long length, const long long paddedLength)
+template <typename T>
+inline arma::Col<T> fftconv(const arma::Col<std::complex<T>>& first, const arma::Col<std::complex<T>>& second, const long long length,
+    const long long paddedLength)
 {
-    arma::vec reals = arma::real(arma::ifft(arma::fft(first, paddedLength) % arma::fft(second, paddedLength), paddedLength));
-    return length >= reals.n_elem ? reals : reals.head(length);
+    arma::Col<T> reals = arma::real(planned_ifft(arma::Col<std::complex<T>>(planned_fft(first, paddedLength) % planned_fft(second, paddedLength)),
+        paddedLength));
+    return length >= static_cast<long long>(reals.n_elem) ? reals : reals.head(length);
 }
 
-inline arma::vec ffftconv(const arma::cx_vec& first, const arma::cx_vec& second, const long long paddedLength)
+template <typename T>
+inline arma::Col<T> ffftconv(const arma::Col<std::complex<T>>& first, const arma::Col<std::complex<T>>& second, const long long paddedLength)
 {
-    return arma::real(arma::ifft(arma::fft(first, paddedLength) % arma::fft(second, paddedLength), paddedLength));
+    return arma::real(planned_ifft(arma::Col<std::complex<T>>(planned_fft(first, paddedLength) % planned_fft(second, paddedLength)), paddedLength));
 }
 
-inline arma::cx_vec ffftconv_cx(const arma::cx_vec& first, const arma::cx_vec& second, const long long paddedLength)
+template <typename T>
+inline arma::Col<std::complex<T>> ffftconv_cx(const arma::Col<std::complex<T>>& first, const arma::Col<std::complex<T>>& second,
+    const long long paddedLength)
 {
-    return arma::ifft(arma::fft(first, paddedLength) % arma::fft(second, paddedLength), paddedLength);
+    return planned_ifft(arma::Col<std::complex<T>>(planned_fft(first, paddedLength) % planned_fft(second, paddedLength)), paddedLength);
 }
 
 inline arma::vec unwrap(const arma::vec& phase_angles)
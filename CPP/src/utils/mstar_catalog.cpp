@@ -0,0 +1,460 @@
+#include "mstar_catalog.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string_view>
+#include <system_error>
+
+#include "file_utils.h"
+
+namespace
+{
+    enum column_kinds : std::uint8_t
+    {
+        DOUBLES = 0,
+        INT32S = 1,
+        INT8S = 2,
+        STRINGS = 3
+    };
+
+    constexpr char magic[8] = {'M', 'S', 'T', 'A', 'R', 'C', 'A', 'T'};
+
+    class catalog_writer
+    {
+        public:
+            std::string bytes;
+
+            template <typename T>
+            void put(const T& value)
+            {
+                bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+            }
+
+            template <typename T>
+            void column(const std::string_view name, const column_kinds kind, const std::vector<T>& values)
+            {
+                begin(name, kind, values.size());
+                bytes.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+            }
+
+            void column(const std::string_view name, const std::vector<std::string>& values)
+            {
+                begin(name, STRINGS, values.size());
+                std::uint64_t end = 0;
+                put(end);
+                for (const std::string& value : values)
+                {
+                    end += value.size();
+                    put(end);
+                }
+                for (const std::string& value : values)
+                {
+                    bytes.append(value);
+                }
+            }
+
+        private:
+            void begin(const std::string_view name, const column_kinds kind, const std::uint64_t entries)
+            {
+                put(static_cast<std::uint16_t>(name.size()));
+                bytes.append(name);
+                put(kind);
+                put(entries);
+            }
+    };
+
+    class catalog_reader
+    {
+        public:
+            explicit catalog_reader(const std::string& bytes) : bytes(bytes)
+            {
+            }
+
+            template <typename T>
+            bool take(T& value)
+            {
+                return take(&value, sizeof(T));
+            }
+
+            bool take(void* destination, const size_t size)
+            {
+                if (size > bytes.size() - position)
+                {
+                    return false;
+                }
+
+                std::memcpy(destination, bytes.data() + position, size);
+                position += size;
+                return true;
+            }
+
+            bool take(std::string& value, const size_t size)
+            {
+                if (size > bytes.size() - position)
+                {
+                    return false;
+                }
+
+                value.assign(bytes, position, size);
+                position += size;
+                return true;
+            }
+
+            bool skip(const std::uint64_t entries, const size_t width)
+            {
+                if (entries > (bytes.size() - position) / width)
+                {
+                    return false;
+                }
+
+                position += entries * width;
+                return true;
+            }
+
+            // Reads entries values of a fixed size column into values, which must already hold entries elements.
+            template <typename T>
+            bool values(std::vector<T>& values, const std::uint64_t entries)
+            {
+                return entries == values.size() && take(values.data(), entries * sizeof(T));
+            }
+
+            bool strings(std::vector<std::string>& values, const std::uint64_t entries)
+            {
+                // The entry count is checked against the bytes left before anything is sized by it.
+                if (entries >= (bytes.size() - position) / sizeof(std::uint64_t))
+                {
+                    return false;
+                }
+
+                std::vector<std::uint64_t> ends(entries + 1);
+                if (!take(ends.data(), ends.size() * sizeof(std::uint64_t)))
+                {
+                    return false;
+                }
+
+                values.resize(entries);
+                for (std::uint64_t i = 0; i < entries; i++)
+                {
+                    if (ends[i + 1] < ends[i] || !take(values[i], ends[i + 1] - ends[i]))
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            // Passes over a column this catalog does not know.
+            bool skip_column(const std::uint8_t kind, const std::uint64_t entries)
+            {
+                switch (kind)
+                {
+                    case DOUBLES:
+                        return skip(entries, sizeof(double));
+
+                    case INT32S:
+                        return skip(entries, sizeof(std::int32_t));
+
+                    case INT8S:
+                        return skip(entries, 1);
+
+                    case STRINGS:
+                    {
+                        std::vector<std::string> ignored;
+                        return strings(ignored, entries);
+                    }
+                }
+                return false;
+            }
+
+        private:
+            const std::string& bytes;
+
+            size_t position = 0;
+    };
+}
+
+bool mstar_catalog::build(const std::string& mstarPath)
+{
+    if (!std::filesystem::is_directory(mstarPath))
+    {
+        std::cout << "[Error] mstar_catalog could not list <" << mstarPath << ">." << std::endl;
+        return false;
+    }
+
+    std::vector<std::string> found = get_files_in_directory_with_validation(mstarPath, R"(.*\d{3})", R"(\.\D{3})");
+    std::sort(found.begin(), found.end());
+    std::vector<phoenix_header> headers(found.size());
+    std::vector<char> headerRead(found.size(), 0);
+#pragma omp parallel for schedule(dynamic)
+    for (long long i = 0; i < static_cast<long long>(found.size()); i++)
+    {
+        headerRead[i] = read_phoenix_header(found[i], headers[i]);
+    }
+
+    clear();
+    for (size_t i = 0; i < found.size(); i++)
+    {
+        if (!headerRead[i])
+        {
+            std::cout << "[Error] mstar_catalog failed to read the header of <" << found[i] << ">." << std::endl;
+            continue;
+        }
+
+        const phoenix_header& header = headers[i];
+        const size_t code = std::find(targetTypeNames.begin(), targetTypeNames.end(), header.targetType) - targetTypeNames.begin();
+        if (code == targetTypeNames.size())
+        {
+            targetTypeNames.push_back(header.targetType);
+        }
+
+        paths.push_back(found[i]);
+        numRows.push_back(header.numRows);
+        numCols.push_back(header.numCols);
+        targetTypes.push_back(static_cast<std::int32_t>(code));
+        polarizations.push_back(header.polarization ? static_cast<std::int8_t>(*header.polarization) : -1);
+        for (size_t c = 0; c < doubleColumnCount; c++)
+        {
+            doubleColumns[c].push_back(header.*phoenixDoubleFields[c].member);
+        }
+    }
+    return true;
+}
+
+bool mstar_catalog::save(const std::string& catalogPath) const
+{
+    catalog_writer writer;
+    writer.bytes.append(magic, sizeof(magic));
+    writer.put(version);
+    writer.put(static_cast<std::uint32_t>(6 + doubleColumnCount));
+    writer.column("Path", paths);
+    writer.column("NumberOfRows", INT32S, numRows);
+    writer.column("NumberOfColumns", INT32S, numCols);
+    writer.column("TargetTypeNames", targetTypeNames);
+    writer.column("TargetType", INT32S, targetTypes);
+    writer.column("Polarization", INT8S, polarizations);
+    for (size_t c = 0; c < doubleColumnCount; c++)
+    {
+        writer.column(phoenixDoubleFields[c].key, DOUBLES, doubleColumns[c]);
+    }
+
+    // Written aside and renamed over the old catalog, so a reader never sees half of one.
+    const std::string temporaryPath = catalogPath + ".tmp";
+    {
+        std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!stream.write(writer.bytes.data(), static_cast<std::streamsize>(writer.bytes.size())))
+        {
+            std::cout << "[Error] mstar_catalog failed to write <" << catalogPath << ">." << std::endl;
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, catalogPath, error);
+    if (error)
+    {
+        std::cout << "[Error] mstar_catalog failed to write <" << catalogPath << ">: " << error.message() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool mstar_catalog::load(const std::string& catalogPath)
+{
+    clear();
+    std::ifstream stream(catalogPath, std::ios::binary);
+    if (!stream.is_open())
+    {
+        return false;
+    }
+
+    const std::string bytes((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    catalog_reader reader(bytes);
+    char fileMagic[sizeof(magic)];
+    std::uint32_t fileVersion = 0;
+    std::uint32_t columnCount = 0;
+    if (!reader.take(fileMagic, sizeof(fileMagic)) || std::memcmp(fileMagic, magic, sizeof(magic)) != 0
+        || !reader.take(fileVersion) || fileVersion != version || !reader.take(columnCount))
+    {
+        std::cout << "[Error] <" << catalogPath << "> is not an MSTAR catalog." << std::endl;
+        return false;
+    }
+
+    // The paths come first and fix the number of files every other column must have.
+    bool loaded = true;
+    for (std::uint32_t column = 0; loaded && column < columnCount; column++)
+    {
+        std::uint16_t nameLength = 0;
+        std::string name;
+        std::uint8_t kind = 0;
+        std::uint64_t entries = 0;
+        loaded = reader.take(nameLength) && reader.take(name, nameLength) && reader.take(kind) && reader.take(entries);
+        if (!loaded)
+        {
+            break;
+        }
+
+        if (column == 0)
+        {
+            loaded = name == "Path" && kind == STRINGS && reader.strings(paths, entries);
+            resize(paths.size());
+        }
+        else if (name == "NumberOfRows" && kind == INT32S)
+        {
+            loaded = reader.values(numRows, entries);
+        }
+        else if (name == "NumberOfColumns" && kind == INT32S)
+        {
+            loaded = reader.values(numCols, entries);
+        }
+        else if (name == "TargetTypeNames" && kind == STRINGS)
+        {
+            loaded = reader.strings(targetTypeNames, entries);
+        }
+        else if (name == "TargetType" && kind == INT32S)
+        {
+            loaded = reader.values(targetTypes, entries);
+        }
+        else if (name == "Polarization" && kind == INT8S)
+        {
+            loaded = reader.values(polarizations, entries);
+        }
+        else
+        {
+            const auto field = std::find_if(std::begin(phoenixDoubleFields), std::end(phoenixDoubleFields),
+                [&name](const phoenix_double_field& candidate)
+                {
+                    return candidate.key == name;
+                });
+            if (field != std::end(phoenixDoubleFields) && kind == DOUBLES)
+            {
+                loaded = reader.values(doubleColumns[field - std::begin(phoenixDoubleFields)], entries);
+            }
+            else
+            {
+                loaded = reader.skip_column(kind, entries);
+            }
+        }
+    }
+
+    // Codes outside the dictionary or the enum would index past them in header() and find().
+    targetTypeNames.resize(std::max<size_t>(targetTypeNames.size(), 1));
+    for (size_t i = 0; i < targetTypes.size(); i++)
+    {
+        targetTypes[i] = targetTypes[i] >= 0 && static_cast<size_t>(targetTypes[i]) < targetTypeNames.size() ? targetTypes[i] : 0;
+        polarizations[i] = polarizations[i] <= static_cast<std::int8_t>(polarization_types::VV) ? polarizations[i] : -1;
+    }
+
+    if (!loaded)
+    {
+        std::cout << "[Error] <" << catalogPath << "> is cut short or damaged." << std::endl;
+        clear();
+    }
+    return loaded;
+}
+
+bool mstar_catalog::load_or_build(const std::string& catalogPath, const std::string& mstarPath)
+{
+    if (std::filesystem::exists(catalogPath) && load(catalogPath))
+    {
+        return true;
+    }
+    return build(mstarPath) && save(catalogPath);
+}
+
+phoenix_header mstar_catalog::header(const size_t index) const
+{
+    phoenix_header header;
+    header.numRows = numRows[index];
+    header.numCols = numCols[index];
+    header.targetType = targetTypeNames[targetTypes[index]];
+    if (polarizations[index] >= 0)
+    {
+        header.polarization = static_cast<polarization_types>(polarizations[index]);
+    }
+
+    for (size_t c = 0; c < doubleColumnCount; c++)
+    {
+        header.*phoenixDoubleFields[c].member = doubleColumns[c][index];
+    }
+    return header;
+}
+
+std::vector<size_t> mstar_catalog::find(const mstar_query& query) const
+{
+    // The string and enum criteria become lookups by dictionary code and polarization value.
+    std::vector<char> wantedTypes(targetTypeNames.size(), query.targetTypes.empty());
+    for (const std::string& targetType : query.targetTypes)
+    {
+        const auto name = std::find(targetTypeNames.begin(), targetTypeNames.end(), targetType);
+        if (name != targetTypeNames.end())
+        {
+            wantedTypes[name - targetTypeNames.begin()] = 1;
+        }
+    }
+
+    unsigned int wantedPolarizations = query.polarizations.empty() ? ~0u : 0u;
+    for (const polarization_types polarization : query.polarizations)
+    {
+        wantedPolarizations |= 1u << static_cast<int>(polarization);
+    }
+
+    const auto column_of = [this](double phoenix_header::* member) -> const std::vector<double>&
+    {
+        size_t c = 0;
+        while (phoenixDoubleFields[c].member != member)
+        {
+            c++;
+        }
+        return doubleColumns[c];
+    };
+    const std::vector<double>& azimuth = column_of(&phoenix_header::azimuth);
+    const std::vector<double>& depression = column_of(&phoenix_header::depression);
+    const bool azimuthWraps = query.minAzimuth > query.maxAzimuth;
+
+    std::vector<size_t> matches;
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        const bool azimuthMatches = azimuthWraps ? azimuth[i] >= query.minAzimuth || azimuth[i] <= query.maxAzimuth
+            : azimuth[i] >= query.minAzimuth && azimuth[i] <= query.maxAzimuth;
+        const bool polarizationMatches = polarizations[i] >= 0 ? (wantedPolarizations >> polarizations[i]) & 1u : query.polarizations.empty();
+        if (azimuthMatches && polarizationMatches && wantedTypes[targetTypes[i]]
+            && depression[i] >= query.minDepression && depression[i] <= query.maxDepression)
+        {
+            matches.push_back(i);
+        }
+    }
+    return matches;
+}
+
+std::vector<std::string> mstar_catalog::select(const mstar_query& query) const
+{
+    std::vector<std::string> selected;
+    for (const size_t index : find(query))
+    {
+        selected.push_back(paths[index]);
+    }
+    return selected;
+}
+
+void mstar_catalog::resize(const size_t count)
+{
+    numRows.assign(count, 0);
+    numCols.assign(count, 0);
+    targetTypes.assign(count, 0);
+    polarizations.assign(count, -1);
+    for (std::vector<double>& column : doubleColumns)
+    {
+        column.assign(count, 0);
+    }
+}
+
+void mstar_catalog::clear()
+{
+    paths.clear();
+    targetTypeNames.clear();
+    resize(0);
+}
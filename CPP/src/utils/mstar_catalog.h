@@ -0,0 +1,116 @@
+#ifndef MSTAR_CATALOG_H
+#define MSTAR_CATALOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "phoenix_header.h"
+#include "../polarization_types.h"
+
+/*-------------------------------------------------------------------------
+ * Which catalogued MSTAR files to take. Every criterion left at its
+ * default matches every file.
+ *
+ * The azimuth bounds are in degrees and wrap through 0 when minAzimuth >
+ * maxAzimuth, as the imagers' azimuth bounds do; target types are matched
+ * exactly against the TargetType header field.
+ *------------------------------------------------------------------------*/
+struct mstar_query
+{
+    std::vector<std::string> targetTypes;
+
+    double minAzimuth = 0;
+
+    double maxAzimuth = 360;
+
+    double minDepression = -90;
+
+    double maxDepression = 90;
+
+    std::vector<polarization_types> polarizations;
+};
+
+/*-------------------------------------------------------------------------
+ * Index of the Phoenix headers of an MSTAR directory, so files can be
+ * picked by target, azimuth, depression or polarization without reading
+ * any of them.
+ *
+ * build reads only the header of each file, in parallel. The index keeps
+ * one column per field: the path, the image size, the target type
+ * (dictionary coded), the polarization and every floating point field of
+ * phoenix_header, so a query scans a few contiguous arrays.
+ *
+ * On disk the catalog is the same columns, one after another:
+ *
+ *   "MSTARCAT" version:u32 columns:u32
+ *   per column: name length:u16 name kind:u8 entries:u64 values
+ *
+ * with values of kind 0 doubles, 1 int32s, 2 int8s, and 3 strings stored
+ * as entries + 1 end offsets:u64 and then the characters. "Path" holds one
+ * string per file, and "TargetType" holds int32 codes into the string
+ * dictionary "TargetTypeNames"; the floating point columns are named by
+ * their Phoenix keys. Columns are found by name, so unknown ones are
+ * skipped and missing ones read as 0. Values are in native byte order.
+ * The catalog is not refreshed by itself: build it again when files are
+ * added to the directory.
+ *------------------------------------------------------------------------*/
+class mstar_catalog
+{
+    public:
+        // Scans the MSTAR files of a directory, as mstar_aggregator selects them; files whose header cannot be read are left out.
+        bool build(const std::string& mstarPath);
+
+        bool save(const std::string& catalogPath) const;
+
+        bool load(const std::string& catalogPath);
+
+        // Loads catalogPath, or builds it from mstarPath and saves it there if it cannot be loaded.
+        bool load_or_build(const std::string& catalogPath, const std::string& mstarPath);
+
+        size_t size() const
+        {
+            return paths.size();
+        }
+
+        const std::string& path(const size_t index) const
+        {
+            return paths[index];
+        }
+
+        // The catalogued header fields of a file; phoenixLength and nativeLength are not kept.
+        phoenix_header header(size_t index) const;
+
+        // Indices of the matching files, in catalog order.
+        std::vector<size_t> find(const mstar_query& query) const;
+
+        // Paths of the matching files, in catalog order.
+        std::vector<std::string> select(const mstar_query& query) const;
+
+    private:
+        static constexpr std::uint32_t version = 1;
+
+        static constexpr size_t doubleColumnCount = sizeof(phoenixDoubleFields) / sizeof(phoenixDoubleFields[0]);
+
+        std::vector<std::string> paths;
+
+        std::vector<std::int32_t> numRows;
+
+        std::vector<std::int32_t> numCols;
+
+        std::vector<std::string> targetTypeNames;
+
+        std::vector<std::int32_t> targetTypes;
+
+        // polarization_types value, or -1 if the header gives none.
+        std::vector<std::int8_t> polarizations;
+
+        std::vector<double> doubleColumns[doubleColumnCount];
+
+        void resize(size_t count);
+
+        void clear();
+};
+
+#endif //MSTAR_CATALOG_H
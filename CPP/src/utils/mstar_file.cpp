@@ -0,0 +1,43 @@
+#include "mstar_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+mstar_file::mstar_file(const std::string& path)
+{
+    const int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0)
+    {
+        return;
+    }
+
+    struct stat status{};
+    if (fstat(descriptor, &status) == 0 && status.st_size > 0)
+    {
+        void* address = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (address != MAP_FAILED)
+        {
+            mapping = static_cast<const char*>(address);
+            size = status.st_size;
+            madvise(address, size, MADV_SEQUENTIAL);
+        }
+    }
+    close(descriptor);
+    if (mapping == nullptr)
+    {
+        return;
+    }
+
+    valid = parse_phoenix_header(mapping, size, parsedHeader) && parsedHeader.phoenixLength <= size
+        && parsedHeader.numRows >= 0 && parsedHeader.numCols >= 0;
+}
+
+mstar_file::~mstar_file()
+{
+    if (mapping != nullptr)
+    {
+        munmap(const_cast<char*>(mapping), size);
+    }
+}
@@ -0,0 +1,134 @@
+#ifndef MSTAR_FILE_H
+#define MSTAR_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "phoenix_header.h"
+
+/*-------------------------------------------------------------------------
+ * An MSTAR file, memory mapped read-only and decoded in place.
+ *
+ * The file starts with an ASCII Phoenix header, parsed in place into
+ * header(); phoenix_text() returns the text itself as a view into the
+ * mapping. Target chips follow it with big-endian float32 magnitudes and
+ * then phases; full scenes skip a native header and hold big-endian
+ * uint16 magnitudes and 12-bit phases.
+ * read_magnitude and read_phase swap the bytes and convert in one pass
+ * straight into the caller's contiguous storage, in a plain loop the
+ * compiler vectorises. Nothing is allocated and nothing
+ * is shared, so any number of threads may decode files at once; pages
+ * are only read from disk when they are touched, so a header-only pass
+ * costs the header alone.
+ *------------------------------------------------------------------------*/
+class mstar_file
+{
+    public:
+        explicit mstar_file(const std::string& path);
+
+        ~mstar_file();
+
+        mstar_file(const mstar_file&) = delete;
+
+        mstar_file& operator=(const mstar_file&) = delete;
+
+        bool is_open() const
+        {
+            return valid;
+        }
+
+        const phoenix_header& header() const
+        {
+            return parsedHeader;
+        }
+
+        std::string_view phoenix_text() const
+        {
+            return std::string_view(mapping, parsedHeader.phoenixLength);
+        }
+
+        int rows() const
+        {
+            return parsedHeader.numRows;
+        }
+
+        int cols() const
+        {
+            return parsedHeader.numCols;
+        }
+
+        size_t pixel_count() const
+        {
+            return static_cast<size_t>(parsedHeader.numRows) * parsedHeader.numCols;
+        }
+
+        // Target chips hold calibrated float32 pixels; full scenes hold uint16 ones.
+        bool is_chip() const
+        {
+            return parsedHeader.nativeLength == 0;
+        }
+
+        // Decodes the first count magnitudes into destination[0 .. count); false if the file is short.
+        template <typename T>
+        bool read_magnitude(T* destination, const size_t count) const
+        {
+            return read_pixels(0, destination, count);
+        }
+
+        template <typename T>
+        bool read_phase(T* destination, const size_t count) const
+        {
+            return read_pixels(pixel_count(), destination, count);
+        }
+
+    private:
+        const char* mapping = nullptr;
+
+        size_t size = 0;
+
+        bool valid = false;
+
+        phoenix_header parsedHeader;
+
+        template <typename T>
+        bool read_pixels(const size_t first, T* destination, const size_t count) const
+        {
+            const size_t width = is_chip() ? sizeof(std::uint32_t) : sizeof(std::uint16_t);
+            const size_t offset = parsedHeader.phoenixLength + parsedHeader.nativeLength + first * width;
+            if (!valid || count > pixel_count() || offset + count * width > size)
+            {
+                return false;
+            }
+
+            const char* source = mapping + offset;
+            if (is_chip())
+            {
+#pragma omp simd
+                for (size_t i = 0; i < count; i++)
+                {
+                    std::uint32_t bits;
+                    std::memcpy(&bits, source + i * sizeof(bits), sizeof(bits));
+                    bits = __builtin_bswap32(bits);
+                    float value;
+                    std::memcpy(&value, &bits, sizeof(value));
+                    destination[i] = static_cast<T>(value);
+                }
+            }
+            else
+            {
+#pragma omp simd
+                for (size_t i = 0; i < count; i++)
+                {
+                    std::uint16_t bits;
+                    std::memcpy(&bits, source + i * sizeof(bits), sizeof(bits));
+                    destination[i] = static_cast<T>(__builtin_bswap16(bits));
+                }
+            }
+            return true;
+        }
+};
+
+#endif //MSTAR_FILE_H
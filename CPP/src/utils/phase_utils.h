@@ -0,0 +1,157 @@
+#ifndef PHASE_UTILS_H
+#define PHASE_UTILS_H
+
+#include <algorithm>
+#include <armadillo>
+#include <cmath>
+#include <limits>
+
+#include "../phase_correction_modes.h"
+
+// Writes exp(i * wavenumber * range) as interleaved real / imaginary pairs. Written so the cos / sin pair vectorizes.
+template <typename T>
+inline void phase_exact(const T wavenumber, const T* range, T* output, const long long count)
+{
+#pragma omp simd
+    for (long long i = 0; i < count; i++)
+    {
+        const T angle = wavenumber * range[i];
+        output[2 * i] = std::cos(angle);
+        output[2 * i + 1] = std::sin(angle);
+    }
+}
+
+// Largest deviation of a pixel grid from grid(i, j) = grid(0, j) + i * step, with one step shared by every column.
+inline double column_affine_residual(const arma::mat& grid)
+{
+    if (grid.n_rows < 2)
+    {
+        return 0;
+    }
+
+    const double step = (grid(grid.n_rows - 1, 0) - grid(0, 0)) / static_cast<double>(grid.n_rows - 1);
+    double residual = 0;
+    for (unsigned long long j = 0; j < grid.n_cols; j++)
+    {
+        const double columnStart = grid(0, j);
+        for (unsigned long long i = 1; i < grid.n_rows; i++)
+        {
+            residual = std::max(residual, std::abs(grid(i, j) - (columnStart + static_cast<double>(i) * step)));
+        }
+    }
+    return residual;
+}
+
+/*-------------------------------------------------------------------------
+ * Evaluates the per-pulse phase correction exp(i * k * dR) of the imagers.
+ *
+ * EXACT evaluates only the pixels inside the range gate.
+ *
+ * RECURRENCE is for planar wavefronts, where dR is affine in pixel position.
+ * Every anchorInterval rows of a column the phase is evaluated exactly; the
+ * gated pixels between are their anchor rotated by a per-pulse table of
+ * exp(i k m d), so a pulse costs one exact phase per anchor and one complex
+ * product per gated pixel.
+ * Against exact evaluation the phase error of any pixel is at most
+ *
+ *   |k| * (2r + M * (2r + 4 eps R) / (rows - 1)) + 4 M eps
+ *
+ * for anchor interval M, grid residual r (column_affine_residual summed over
+ * the coordinate grids) and grid extent R (an upper bound on |dR|). M is the
+ * largest interval keeping this under the requested tolerance. If even M = 2
+ * cannot, the corrector switches itself back to EXACT.
+ *
+ * eps is the machine epsilon of the precision the phases are evaluated in,
+ * so single precision pipelines usually end up with EXACT at the default
+ * tolerance.
+ *------------------------------------------------------------------------*/
+class phase_corrector
+{
+    public:
+        static constexpr unsigned long long maxAnchorInterval = 256;
+
+        phase_correction_modes mode;
+
+        unsigned long long anchorInterval;
+
+        double errorBound;
+
+        explicit phase_corrector(const phase_correction_modes mode = phase_correction_modes::EXACT, const double maxWavenumber = 0,
+            const unsigned long long rows = 0, const double gridResidual = 0, const double gridExtent = 0, const double tolerance = 1e-6,
+            const double epsilon = std::numeric_limits<double>::epsilon())
+        {
+            this->mode = phase_correction_modes::EXACT;
+            this->anchorInterval = 1;
+            this->errorBound = 0;
+            if (mode != phase_correction_modes::RECURRENCE || rows < 2)
+            {
+                return;
+            }
+
+            const double wavenumber = std::abs(maxWavenumber);
+            const double fixedError = wavenumber * 2 * gridResidual;
+            const double stepError = wavenumber * (2 * gridResidual + 4 * epsilon * gridExtent) / static_cast<double>(rows - 1) + 4 * epsilon;
+            if (fixedError + 2 * stepError > tolerance)
+            {
+                return;
+            }
+
+            this->mode = phase_correction_modes::RECURRENCE;
+            this->anchorInterval = std::min({maxAnchorInterval, static_cast<unsigned long long>(rows),
+                static_cast<unsigned long long>((tolerance - fixedError) / stepError)});
+            this->errorBound = fixedError + static_cast<double>(anchorInterval) * stepError;
+        }
+
+        // Phase correction of the pixels selected by index, where validDR = dR.elem(index). T is float or double.
+        template <typename T>
+        arma::Col<std::complex<T>> evaluate(const double wavenumber, const arma::Mat<T>& dR, const arma::uvec& index, const arma::Col<T>& validDR) const
+        {
+            if (mode == phase_correction_modes::EXACT)
+            {
+                arma::Col<std::complex<T>> output(validDR.n_elem);
+                phase_exact<T>(static_cast<T>(wavenumber), validDR.memptr(), reinterpret_cast<T*>(output.memptr()), validDR.n_elem);
+                return output;
+            }
+            return recurrence(wavenumber, dR, index);
+        }
+
+        // Recurrence phases of the pixels selected by index. The anchors of every column are evaluated exactly, at one in
+        // anchorInterval rows, and each selected pixel is its anchor rotated by the table entry of its distance from it. The
+        // rotation table and anchors are always formed in double precision, then stored as T.
+        template <typename T>
+        arma::Col<std::complex<T>> recurrence(const double wavenumber, const arma::Mat<T>& dR, const arma::uvec& index) const
+        {
+            const unsigned long long rows = dR.n_rows;
+            const double step = (static_cast<double>(dR(rows - 1, 0)) - static_cast<double>(dR(0, 0))) / static_cast<double>(rows - 1);
+            const arma::cx_double rotationStep = std::polar(1.0, wavenumber * step);
+            arma::Col<std::complex<T>> rotation(anchorInterval);
+            arma::cx_double current(1.0, 0.0);
+            for (unsigned long long m = 0; m < anchorInterval; m++)
+            {
+                rotation(m) = std::complex<T>(current);
+                current *= rotationStep;
+            }
+
+            const unsigned long long anchorRows = (rows + anchorInterval - 1) / anchorInterval;
+            arma::Mat<std::complex<T>> anchors(anchorRows, dR.n_cols);
+            for (unsigned long long j = 0; j < dR.n_cols; j++)
+            {
+                for (unsigned long long a = 0; a < anchorRows; a++)
+                {
+                    const double angle = wavenumber * dR(a * anchorInterval, j);
+                    anchors(a, j) = std::complex<T>(static_cast<T>(std::cos(angle)), static_cast<T>(std::sin(angle)));
+                }
+            }
+
+            arma::Col<std::complex<T>> output(index.n_elem);
+            for (unsigned long long k = 0; k < index.n_elem; k++)
+            {
+                const unsigned long long row = index(k) % rows;
+                const unsigned long long col = index(k) / rows;
+                output(k) = anchors(row / anchorInterval, col) * rotation(row % anchorInterval);
+            }
+            return output;
+        }
+};
+
+#endif //PHASE_UTILS_H
@@ -0,0 +1,141 @@
+#include "phoenix_header.h"
+
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#include <string_view>
+#include <unistd.h>
+
+namespace
+{
+    constexpr std::string_view endMarker = "[EndofPhoenixHeader]";
+
+    template <typename T>
+    bool parse_number(const std::string_view value, T& destination)
+    {
+        return std::from_chars(value.data(), value.data() + value.size(), destination).ec == std::errc();
+    }
+
+    std::optional<polarization_types> parse_polarization(const std::string_view value)
+    {
+        if (value == "HH")
+        {
+            return polarization_types::HH;
+        }
+        if (value == "HV")
+        {
+            return polarization_types::HV;
+        }
+        if (value == "VH")
+        {
+            return polarization_types::VH;
+        }
+        if (value == "VV")
+        {
+            return polarization_types::VV;
+        }
+        return std::nullopt;
+    }
+}
+
+bool parse_phoenix_header(const char* text, const size_t size, phoenix_header& header)
+{
+    header = phoenix_header();
+    bool hasLength = false, hasRows = false, hasCols = false;
+    size_t end = size;
+    size_t start = 0;
+    while (start < end)
+    {
+        const char* lineEnd = static_cast<const char*>(std::memchr(text + start, '\n', end - start));
+        const size_t stop = lineEnd != nullptr ? lineEnd - text : end;
+        std::string_view line(text + start, stop - start);
+        start = stop + 1;
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.remove_suffix(1);
+        }
+
+        if (line.compare(0, endMarker.size(), endMarker) == 0)
+        {
+            break;
+        }
+
+        const size_t separator = line.find("= ");
+        if (separator == std::string_view::npos)
+        {
+            continue;
+        }
+
+        const std::string_view key = line.substr(0, separator);
+        std::string_view value = line.substr(separator + 2);
+        while (!value.empty() && value.front() == ' ')
+        {
+            value.remove_prefix(1);
+        }
+
+        if (key == "PhoenixHeaderLength")
+        {
+            hasLength = parse_number(value, header.phoenixLength);
+            end = hasLength && header.phoenixLength < end ? header.phoenixLength : end;
+        }
+        else if (key == "native_header_length")
+        {
+            parse_number(value, header.nativeLength);
+        }
+        else if (key == "NumberOfRows")
+        {
+            hasRows = parse_number(value, header.numRows);
+        }
+        else if (key == "NumberOfColumns")
+        {
+            hasCols = parse_number(value, header.numCols);
+        }
+        else if (key == "TargetType")
+        {
+            header.targetType = std::string(value);
+        }
+        else if (key == "Polarization")
+        {
+            header.polarization = parse_polarization(value);
+        }
+        else
+        {
+            for (const phoenix_double_field& field : phoenixDoubleFields)
+            {
+                if (key == field.key)
+                {
+                    parse_number(value, header.*field.member);
+                    break;
+                }
+            }
+        }
+    }
+    return hasLength && hasRows && hasCols;
+}
+
+bool read_phoenix_header(const std::string& path, phoenix_header& header)
+{
+    const int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0)
+    {
+        return false;
+    }
+
+    // The header length is given in the first kilobyte; the rest of the header, if any, is read once it is known.
+    std::string text(1024, '\0');
+    ssize_t count = pread(descriptor, text.data(), text.size(), 0);
+    text.resize(count > 0 ? count : 0);
+    const bool parsed = parse_phoenix_header(text.data(), text.size(), header);
+    if (header.phoenixLength <= text.size())
+    {
+        // The whole header was in the first read, or its length was never found; either way the first parse stands.
+        close(descriptor);
+        return parsed;
+    }
+
+    text.resize(header.phoenixLength);
+    count = pread(descriptor, text.data(), text.size(), 0);
+    close(descriptor);
+    text.resize(count > 0 ? count : 0);
+    return parse_phoenix_header(text.data(), text.size(), header);
+}
@@ -0,0 +1,123 @@
+#ifndef PHOENIX_HEADER_H
+#define PHOENIX_HEADER_H
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "../polarization_types.h"
+
+/*-------------------------------------------------------------------------
+ * The fields of an MSTAR Phoenix header that the tools use, typed.
+ *
+ * The header is ASCII "Key= value" lines closed by [EndofPhoenixHeader].
+ * parse_phoenix_header makes one pass over it, matching each key against a
+ * fixed table and converting the value in place with std::from_chars, and
+ * stops at the end marker, or after phoenixLength bytes, so the pixels
+ * that follow are never looked at. Angles are in degrees and frequencies
+ * in GHz, as written; fields the header lacks stay 0, and polarization
+ * stays empty unless it is one of HH, HV, VH or VV.
+ *------------------------------------------------------------------------*/
+struct phoenix_header
+{
+    size_t phoenixLength = 0;
+
+    size_t nativeLength = 0;
+
+    int numRows = 0;
+
+    int numCols = 0;
+
+    std::string targetType;
+
+    double azimuth = 0;
+
+    double roll = 0;
+
+    double pitch = 0;
+
+    double yaw = 0;
+
+    double depression = 0;
+
+    double groundPlaneSquint = 0;
+
+    double slantPlaneSquint = 0;
+
+    double range = 0;
+
+    double aimpointLatitude = 0;
+
+    double aimpointLongitude = 0;
+
+    double aimpointElevation = 0;
+
+    double antennaLatitude = 0;
+
+    double antennaLongitude = 0;
+
+    double aircraftAltitude = 0;
+
+    double aircraftHeading = 0;
+
+    double xVelocity = 0;
+
+    double collectionTime = 0;
+
+    double rangeResolution = 0;
+
+    double crossRangeResolution = 0;
+
+    double rangePixelSpacing = 0;
+
+    double crossRangePixelSpacing = 0;
+
+    double centreFrequency = 0;
+
+    double bandwidth = 0;
+
+    std::optional<polarization_types> polarization;
+};
+
+// The floating point fields of phoenix_header, by the Phoenix key they are read from.
+struct phoenix_double_field
+{
+    std::string_view key;
+
+    double phoenix_header::* member;
+};
+
+inline constexpr phoenix_double_field phoenixDoubleFields[] = {
+    {"TargetAz", &phoenix_header::azimuth},
+    {"TargetRoll", &phoenix_header::roll},
+    {"TargetPitch", &phoenix_header::pitch},
+    {"TargetYaw", &phoenix_header::yaw},
+    {"MeasuredDepression", &phoenix_header::depression},
+    {"MeasuredGroundPlaneSquint", &phoenix_header::groundPlaneSquint},
+    {"MeasuredSlantPlaneSquint", &phoenix_header::slantPlaneSquint},
+    {"MeasuredRange", &phoenix_header::range},
+    {"MeasuredAimpointLatitude", &phoenix_header::aimpointLatitude},
+    {"MeasuredAimpointLongitude", &phoenix_header::aimpointLongitude},
+    {"MeasuredAimpointElevation", &phoenix_header::aimpointElevation},
+    {"MeasuredAntennaLatitude", &phoenix_header::antennaLatitude},
+    {"MeasuredAntennaLongitude", &phoenix_header::antennaLongitude},
+    {"MeasuredAircraftAltitude", &phoenix_header::aircraftAltitude},
+    {"MeasuredAircraftHeading", &phoenix_header::aircraftHeading},
+    {"X_Velocity", &phoenix_header::xVelocity},
+    {"CollectionTime", &phoenix_header::collectionTime},
+    {"RangeResolution", &phoenix_header::rangeResolution},
+    {"CrossRangeResolution", &phoenix_header::crossRangeResolution},
+    {"RangePixelSpacing", &phoenix_header::rangePixelSpacing},
+    {"CrossRangePixelSpacing", &phoenix_header::crossRangePixelSpacing},
+    {"CenterFrequency", &phoenix_header::centreFrequency}, // Written with a trailing " GHz", which from_chars stops at
+    {"Bandwidth", &phoenix_header::bandwidth}
+};
+
+// Parses the header at the start of text; false unless the image size and header length were found.
+bool parse_phoenix_header(const char* text, size_t size, phoenix_header& header);
+
+// Reads and parses only the header bytes of an MSTAR file.
+bool read_phoenix_header(const std::string& path, phoenix_header& header);
+
+#endif //PHOENIX_HEADER_H
@@ -0,0 +1,414 @@
+#ifndef PIPELINE_UTILS_H
+#define PIPELINE_UTILS_H
+
+#include <algorithm>
+#include <armadillo>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "bounded_queue.h"
+#include "chip_stack.h"
+#include "file_utils.h"
+#include "image_encoder.h"
+#include "image_sink.h"
+#include "io_utils.h"
+#include "run_manifest.h"
+#include "work_queue.h"
+#include "../output_encodings.h"
+#include "../output_modes.h"
+
+// Runs one stage of the pipeline and returns its result; an exception it throws is reported and counts as a failure.
+template <typename Stage>
+bool run_stage(const std::string& description, Stage stage)
+{
+    try
+    {
+        return stage();
+    }
+    catch (const std::exception& exception)
+    {
+        std::cout << "[Error] " << description << " threw: " << exception.what() << std::endl;
+    }
+    catch (...)
+    {
+        std::cout << "[Error] " << description << " threw an unknown exception." << std::endl;
+    }
+    return false;
+}
+
+/*-------------------------------------------------------------------------
+ * Images inputs one after another with loading, image formation and saving
+ * overlapped: a prefetch thread loads input i + 1 while the calling thread,
+ * with the whole OpenMP team, forms image i and a write-behind thread saves
+ * image i - 1. The stages hand imagers over through queues of queueDepth,
+ * so at most a few files are held in memory at once.
+ *
+ * next(index) sets the index into inputPaths of the next input and returns
+ * false once there are none; it is called from the prefetch thread only.
+ * create(path) returns a std::unique_ptr to a new imager, and load(imager,
+ * path) loads it and returns false if it failed. save(imager, path, saved)
+ * writes its outputs and calls saved(succeeded, outputs) with their paths
+ * once they are on disk: before it returns, or later from another thread
+ * if the outputs are written behind. flush() is called after the last
+ * save and returns once every saved call is made. An input whose load,
+ * get_image_data or save fails or throws is not recorded; the others carry
+ * on. finish(index, succeeded) is called once for every input next hands
+ * out, one call at a time, and only after saved for a saved input; a
+ * skipped input has succeeded. An exception from next ends the run as if
+ * it had returned false. Both queues are closed and both threads joined
+ * however the run ends.
+ *
+ * With a manifest, inputs it holds as up to date for this imager and its
+ * parameters are skipped before they are loaded, and each saved input is
+ * recorded with its outputs; the imager's parameter_string() identifies
+ * the settings. It is taken once, before load, so an input is recorded
+ * under the parameters it was checked against even when load fills some
+ * in from the file. HDF5 is not thread-safe, so hdf5_reader and the savers
+ * serialise their HDF5 calls through hdf5_mutex(); loads and saves take
+ * turns while image formation runs alongside both.
+ *------------------------------------------------------------------------*/
+template <typename Next, typename Create, typename Load, typename Save, typename Flush, typename Finish>
+void pipelined_run(const std::vector<std::string>& inputPaths, Next next, Create create, Load load, Save save, Flush flush, Finish finish,
+    run_manifest* manifest = nullptr, const std::string& imagerName = "", const size_t queueDepth = 1)
+{
+    using imager_pointer = decltype(create(std::string()));
+    struct work_item
+    {
+        int index;
+
+        imager_pointer imager;
+
+        std::string parameters;
+    };
+
+    bounded_queue<work_item> loaded(queueDepth);
+    bounded_queue<work_item> computed(queueDepth);
+    std::mutex finishMutex;
+    const auto finished = [&](const int index, const bool succeeded)
+    {
+        std::lock_guard<std::mutex> lock(finishMutex);
+        run_stage("Finishing <" + inputPaths[index] + ">", [&]
+        {
+            finish(index, succeeded);
+            return true;
+        });
+    };
+
+    // Closing both queues releases whichever stage is still waiting on the other, so the threads can always be joined.
+    struct stage_threads
+    {
+        bounded_queue<work_item>& loaded;
+
+        bounded_queue<work_item>& computed;
+
+        std::thread loader;
+
+        std::thread writer;
+
+        ~stage_threads()
+        {
+            loaded.close();
+            computed.close();
+            if (loader.joinable())
+            {
+                loader.join();
+            }
+            if (writer.joinable())
+            {
+                writer.join();
+            }
+        }
+    } stages{loaded, computed, {}, {}};
+
+    stages.loader = std::thread([&]
+    {
+        int i;
+        while (run_stage("Handing out the next input", [&] { return next(i); }))
+        {
+            imager_pointer imager;
+            std::string parameters;
+            bool skipped = false;
+            const bool succeeded = run_stage("Loading <" + inputPaths[i] + ">", [&]
+            {
+                imager = create(inputPaths[i]);
+                parameters = imager->parameter_string();
+                skipped = manifest != nullptr && manifest->up_to_date(inputPaths[i], imagerName, parameters);
+                return skipped || load(*imager, inputPaths[i]);
+            });
+            if (skipped)
+            {
+                std::cout << "Skipping " << inputPaths[i] << ": unchanged since its outputs were made" << std::endl;
+                finished(i, true);
+                continue;
+            }
+
+            if (!succeeded)
+            {
+                finished(i, false);
+                continue;
+            }
+
+            if (!loaded.push({i, std::move(imager), std::move(parameters)}))
+            {
+                break;
+            }
+        }
+        loaded.close();
+    });
+
+    stages.writer = std::thread([&]
+    {
+        work_item item;
+        while (computed.pop(item))
+        {
+            const int index = item.index;
+            const std::string& path = inputPaths[index];
+
+            // Called once, whichever of save, its writer or a throwing save gets there first.
+            const auto called = std::make_shared<std::atomic<bool>>(false);
+            const std::function<void(bool, const std::vector<std::string>&)> saved =
+                [&, index, called, parameters = item.parameters](const bool succeeded, const std::vector<std::string>& outputs)
+            {
+                if (called->exchange(true))
+                {
+                    return;
+                }
+
+                const std::string& path = inputPaths[index];
+                const bool recorded = succeeded && run_stage("Recording <" + path + ">", [&]
+                {
+                    if (manifest != nullptr && !outputs.empty())
+                    {
+                        manifest->record(path, imagerName, parameters, outputs);
+                    }
+                    return true;
+                });
+                if (!recorded)
+                {
+                    std::cout << "[Error] Failed to save the outputs of <" << path << ">." << std::endl;
+                    finished(index, false);
+                    return;
+                }
+
+                finished(index, true);
+                std::cout << "Completed " << path << " (" << index << ")" << std::endl;
+            };
+
+            if (!run_stage("Saving <" + path + ">", [&]
+            {
+                save(*item.imager, path, saved);
+                return true;
+            }))
+            {
+                saved(false, {});
+            }
+            item.imager.reset();
+        }
+        run_stage("Flushing the saved outputs", [&]
+        {
+            flush();
+            return true;
+        });
+    });
+
+    work_item item;
+    while (loaded.pop(item))
+    {
+        if (!run_stage("Forming the image of <" + inputPaths[item.index] + ">", [&] { return item.imager->get_image_data() == 0; }))
+        {
+            std::cout << "[Error] Image formation failed for <" << inputPaths[item.index] << ">." << std::endl;
+            item.imager.reset();
+            finished(item.index, false);
+            continue;
+        }
+
+        if (!computed.push(std::move(item)))
+        {
+            break;
+        }
+    }
+    computed.close();
+}
+
+// The images an imager hands to batch_run, as the image sink stores them.
+template <typename eT>
+const arma::Mat<eT>& sink_image(const arma::Mat<eT>& image)
+{
+    return image;
+}
+
+template <typename eT>
+const arma::Cube<eT>& sink_image(const chip_stack<eT>& image)
+{
+    return image.data;
+}
+
+// Writes an image batch_run is handed to savePath/saveName.hdf5.
+template <typename eT>
+bool save_image(const arma::Mat<eT>& image, const std::string& savePath, const std::string& saveName, const output_encodings encoding)
+{
+    return save_data(image, savePath, saveName, encoding);
+}
+
+template <typename eT>
+bool save_image(const chip_stack<eT>& image, const std::string& savePath, const std::string& saveName, const output_encodings encoding)
+{
+    return image.save(savePath, saveName, image_encoder(encoding));
+}
+
+/*-------------------------------------------------------------------------
+ * The batch run of an imager driver: pipelined_run over the inputs next
+ * hands out, with each imager loaded by its load() and its images written
+ * in the output mode and encoding.
+ *
+ * fields(imager, write) calls write(field, suffix, image) for every image
+ * to keep, image being an arma::Mat or a chip_stack. With FILES, an input
+ * <file>.<ext> writes savePath/<file><suffix>.hdf5; with CONSOLIDATED, the
+ * image is appended to the <field> group of one image_sink in savePath.
+ * Either way the input is recorded in savePath/run_manifest.tsv once its
+ * images are on disk, a consolidated one with the sink file as its output
+ * and no output checksum, as the sink keeps growing under it.
+ *------------------------------------------------------------------------*/
+template <typename Next, typename Finish, typename Create, typename Fields>
+void batch_run(const std::vector<std::string>& inputPaths, Next next, Finish finish, Create create, Fields fields,
+    const std::string& savePath, const std::string& imagerName, const output_modes outputMode, const output_encodings outputEncoding)
+{
+    const bool consolidated = outputMode == output_modes::CONSOLIDATED;
+    run_manifest manifest(savePath + "/run_manifest.tsv", false, false, !consolidated);
+    std::unique_ptr<image_sink> sink = consolidated ? std::make_unique<image_sink>(savePath, 64, outputEncoding) : nullptr;
+    pipelined_run(inputPaths, next, create,
+        [&imagerName](auto& imager, const std::string& path)
+        {
+            if (imager.load() != 0)
+            {
+                std::cout << "[Error] " << imagerName << " failed for <" << path << ">: data loading." << std::endl;
+                return false;
+            }
+            return true;
+        },
+        [&savePath, &sink, &fields, outputEncoding](const auto& imager, const std::string& path, const auto& saved)
+        {
+            std::string parent, file, extension;
+            get_file_info(path, parent, file, extension);
+            std::vector<std::string> outputs;
+            bool succeeded = true;
+            fields(imager, [&](const std::string& field, const std::string& suffix, const auto& image)
+            {
+                if (sink != nullptr)
+                {
+                    succeeded = sink->append(path, field, sink_image(image)) && succeeded;
+                    return;
+                }
+
+                if (succeeded && save_image(image, savePath, file + suffix, outputEncoding))
+                {
+                    outputs.push_back(savePath + "/" + file + suffix + ".hdf5");
+                    return;
+                }
+                succeeded = false;
+            });
+
+            // Consolidated images are written behind, so the input is done once the sink has flushed them.
+            if (sink != nullptr && succeeded)
+            {
+                sink->commit(path, [saved, sinkPath = sink->path()](const bool written)
+                {
+                    saved(written, {sinkPath});
+                });
+                return;
+            }
+            saved(succeeded, outputs);
+        },
+        [&sink]
+        {
+            if (sink != nullptr)
+            {
+                sink->close();
+            }
+        },
+        finish, &manifest, imagerName + " " + image_encoder::name(outputEncoding) + (consolidated ? " consolidated" : ""));
+}
+
+// batch_run over inputPaths[from..to); returns the indices of the inputs that failed, in order.
+template <typename Create, typename Fields>
+std::vector<int> batch_run(const std::vector<std::string>& inputPaths, const int from, const int to, Create create, Fields fields,
+    const std::string& savePath, const std::string& imagerName, const output_modes outputMode, const output_encodings outputEncoding)
+{
+    int nextIndex = from;
+    std::vector<int> failed;
+    batch_run(inputPaths,
+        [&nextIndex, to](int& index)
+        {
+            index = nextIndex++;
+            return index < to;
+        },
+        [&failed](const int index, const bool succeeded)
+        {
+            if (!succeeded)
+            {
+                failed.push_back(index);
+            }
+        },
+        create, fields, savePath, imagerName, outputMode, outputEncoding);
+    std::sort(failed.begin(), failed.end());
+    return failed;
+}
+
+/*-------------------------------------------------------------------------
+ * batch_run over the inputs a work queue hands this process, claimed
+ * claimBatch at a time as the pipeline asks for them. Saved and skipped
+ * inputs are completed, and failed ones released to the other workers.
+ * Returns the indices of the inputs that failed, in order.
+ *------------------------------------------------------------------------*/
+template <typename Create, typename Fields>
+std::vector<int> batch_run(const std::vector<std::string>& inputPaths, work_queue& queue, Create create, Fields fields,
+    const std::string& savePath, const std::string& imagerName, const output_modes outputMode, const output_encodings outputEncoding,
+    const int claimBatch = 4)
+{
+    std::unordered_map<std::string, int> indices;
+    for (int i = 0; i < static_cast<int>(inputPaths.size()); i++)
+    {
+        indices.emplace(inputPaths[i], i);
+    }
+
+    std::vector<std::string> batch;
+    size_t position = 0;
+    std::vector<int> failed;
+    batch_run(inputPaths,
+        [&](int& index)
+        {
+            if (position == batch.size())
+            {
+                position = 0;
+                if (!queue.claim(batch, claimBatch))
+                {
+                    return false;
+                }
+            }
+            index = indices.at(batch[position++]);
+            return true;
+        },
+        [&](const int index, const bool succeeded)
+        {
+            if (succeeded)
+            {
+                queue.complete(inputPaths[index]);
+                return;
+            }
+            queue.release(inputPaths[index]);
+            failed.push_back(index);
+        },
+        create, fields, savePath, imagerName, outputMode, outputEncoding);
+    std::sort(failed.begin(), failed.end());
+    return failed;
+}
+
+#endif //PIPELINE_UTILS_H
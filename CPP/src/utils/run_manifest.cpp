@@ -0,0 +1,162 @@
+#include "run_manifest.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <zlib.h>
+
+namespace
+{
+    // Fields may not contain the separators, so tabs and newlines in them are replaced by spaces.
+    std::string sanitise(std::string field)
+    {
+        for (char& character : field)
+        {
+            character = character == '\t' || character == '\n' ? ' ' : character;
+        }
+        return field;
+    }
+}
+
+run_manifest::run_manifest(const std::string& manifestPath, const bool hashContents, const bool verifyOutputs, const bool hashOutputs)
+    : manifestPath(manifestPath), hashContents(hashContents), verifyOutputs(verifyOutputs), hashOutputs(hashOutputs)
+{
+    std::ifstream stream(manifestPath);
+    std::string line;
+    while (std::getline(stream, line))
+    {
+        std::vector<std::string> fields;
+        std::istringstream lineStream(line);
+        std::string field;
+        while (std::getline(lineStream, field, '\t'))
+        {
+            fields.push_back(field);
+        }
+
+        if (fields.size() < 8)
+        {
+            continue;
+        }
+
+        try
+        {
+            entry item;
+            item.input.size = std::stoull(fields[1]);
+            item.input.modified = std::stoll(fields[2]);
+            item.input.contentCrc = static_cast<std::uint32_t>(std::stoul(fields[3]));
+            item.imager = fields[4];
+            item.parameters = fields[5];
+            item.outputCrc = static_cast<std::uint32_t>(std::stoul(fields[6]));
+            item.outputs.assign(fields.begin() + 7, fields.end());
+            entries[fields[0]] = item;
+        }
+        catch (const std::exception&)
+        {
+            // A line cut short by a crash; the input it describes is simply imaged again.
+        }
+    }
+}
+
+bool run_manifest::up_to_date(const std::string& inputPath, const std::string& imager, const std::string& parameters) const
+{
+    entry item;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto existing = entries.find(inputPath);
+        if (existing == entries.end())
+        {
+            return false;
+        }
+        item = existing->second;
+    }
+
+    fingerprint current;
+    if (item.imager != sanitise(imager) || item.parameters != sanitise(parameters) || !fingerprint_of(inputPath, current)
+        || current.size != item.input.size || current.modified != item.input.modified || current.contentCrc != item.input.contentCrc)
+    {
+        return false;
+    }
+
+    for (const std::string& output : item.outputs)
+    {
+        if (!std::filesystem::exists(output))
+        {
+            return false;
+        }
+    }
+
+    std::uint32_t outputCrc;
+    return !verifyOutputs || !hashOutputs || (checksum(item.outputs, outputCrc) && outputCrc == item.outputCrc);
+}
+
+bool run_manifest::record(const std::string& inputPath, const std::string& imager, const std::string& parameters, const std::vector<std::string>& outputPaths)
+{
+    entry item;
+    item.imager = sanitise(imager);
+    item.parameters = sanitise(parameters);
+    item.outputs = outputPaths;
+    if (!fingerprint_of(inputPath, item.input) || (hashOutputs && !checksum(outputPaths, item.outputCrc)))
+    {
+        std::cout << "[Error] Failed to fingerprint <" << inputPath << "> for the run manifest." << std::endl;
+        return false;
+    }
+
+    std::ostringstream line;
+    line << sanitise(inputPath) << '\t' << item.input.size << '\t' << item.input.modified << '\t' << item.input.contentCrc
+        << '\t' << item.imager << '\t' << item.parameters << '\t' << item.outputCrc;
+    for (const std::string& output : outputPaths)
+    {
+        line << '\t' << sanitise(output);
+    }
+    line << '\n';
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::ofstream stream(manifestPath, std::ios::app);
+    const std::string text = line.str();
+    stream.write(text.data(), static_cast<std::streamsize>(text.size()));
+    stream.flush();
+    entries[inputPath] = item;
+    return static_cast<bool>(stream);
+}
+
+bool run_manifest::checksum(const std::vector<std::string>& paths, std::uint32_t& crc)
+{
+    uLong running = crc32(0L, Z_NULL, 0);
+    std::vector<char> buffer(1 << 20);
+    for (const std::string& path : paths)
+    {
+        std::ifstream stream(path, std::ios::binary);
+        if (!stream.is_open())
+        {
+            return false;
+        }
+
+        while (stream)
+        {
+            stream.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            running = crc32(running, reinterpret_cast<const Bytef*>(buffer.data()), static_cast<uInt>(stream.gcount()));
+        }
+    }
+    crc = static_cast<std::uint32_t>(running);
+    return true;
+}
+
+bool run_manifest::fingerprint_of(const std::string& path, fingerprint& output) const
+{
+    std::error_code error;
+    output.size = std::filesystem::file_size(path, error);
+    if (error)
+    {
+        return false;
+    }
+
+    output.modified = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+    if (error)
+    {
+        return false;
+    }
+
+    output.contentCrc = 0;
+    return !hashContents || checksum({path}, output.contentCrc);
+}
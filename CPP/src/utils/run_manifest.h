@@ -0,0 +1,81 @@
+#ifndef RUN_MANIFEST_H
+#define RUN_MANIFEST_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*-------------------------------------------------------------------------
+ * Record of the inputs a batch run has already imaged, so a re-run only
+ * images inputs that are new or have changed.
+ *
+ * The manifest is an append-only, tab-separated file with one line per
+ * completed input:
+ *
+ *   path  size  mtime  content crc32  imager  parameters  output crc32  outputs
+ *
+ * An input is up to date when its latest line matches its current size and
+ * modification time (and content crc32, if contents are hashed), was made
+ * by the same imager with the same parameters, and every output it lists
+ * still exists. The content crc32 is 0 unless hashContents is set; the
+ * output crc32 covers the listed outputs in order, and is checked again
+ * only if verifyOutputs is set, as both mean reading whole files. Without
+ * hashOutputs the output crc32 is 0 and never checked, for outputs that
+ * later inputs keep appending to, such as an image_sink file.
+ *
+ * Lines are appended with a single write each, so several workers may share
+ * one manifest; a line cut short by a crash is ignored when it is read back.
+ *------------------------------------------------------------------------*/
+class run_manifest
+{
+    public:
+        explicit run_manifest(const std::string& manifestPath, bool hashContents = false, bool verifyOutputs = false, bool hashOutputs = true);
+
+        bool up_to_date(const std::string& inputPath, const std::string& imager, const std::string& parameters) const;
+
+        bool record(const std::string& inputPath, const std::string& imager, const std::string& parameters, const std::vector<std::string>& outputPaths);
+
+        // zlib crc32 of the files in order, as one stream; false if any cannot be read.
+        static bool checksum(const std::vector<std::string>& paths, std::uint32_t& crc);
+
+    private:
+        struct fingerprint
+        {
+            std::uintmax_t size = 0;
+
+            long long modified = 0;
+
+            std::uint32_t contentCrc = 0;
+        };
+
+        struct entry
+        {
+            fingerprint input;
+
+            std::string imager;
+
+            std::string parameters;
+
+            std::uint32_t outputCrc = 0;
+
+            std::vector<std::string> outputs;
+        };
+
+        std::string manifestPath;
+
+        bool hashContents;
+
+        bool verifyOutputs;
+
+        bool hashOutputs;
+
+        std::unordered_map<std::string, entry> entries;
+
+        mutable std::mutex mutex;
+
+        bool fingerprint_of(const std::string& path, fingerprint& output) const;
+};
+
+#endif //RUN_MANIFEST_H
@@ -0,0 +1,288 @@
+#include "work_queue.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <fcntl.h>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    // Holds an exclusive flock on the queue file for the lifetime of the object.
+    class queue_lock
+    {
+        public:
+            explicit queue_lock(const int descriptor) : descriptor(descriptor)
+            {
+                while (flock(descriptor, LOCK_EX) != 0 && errno == EINTR)
+                {
+                }
+            }
+
+            ~queue_lock()
+            {
+                flock(descriptor, LOCK_UN);
+            }
+
+            queue_lock(const queue_lock&) = delete;
+
+            queue_lock& operator=(const queue_lock&) = delete;
+
+        private:
+            const int descriptor;
+    };
+}
+
+work_queue::work_queue(const std::string& queuePath, const std::vector<std::string>& inputPaths) : queuePath(queuePath)
+{
+    descriptor = open(queuePath.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (descriptor < 0)
+    {
+        std::cout << "[Error] Failed to open the work queue <" << queuePath << ">." << std::endl;
+        return;
+    }
+
+    queue_lock lock(descriptor);
+    bool usable = replay();
+    if (usable && !inputs.empty())
+    {
+        const std::unordered_set<std::string> listed(inputPaths.begin(), inputPaths.end());
+        usable = listed.size() == inputs.size() && std::all_of(inputs.begin(), inputs.end(), [&listed](const entry& item)
+        {
+            return listed.count(item.path) != 0;
+        });
+        if (!usable)
+        {
+            std::cout << "[Error] The work queue <" << queuePath << "> lists other inputs; delete it to start over." << std::endl;
+        }
+    }
+    else if (usable)
+    {
+        std::vector<std::pair<std::uintmax_t, std::string>> sizes;
+        for (const std::string& path : inputPaths)
+        {
+            std::error_code error;
+            const std::uintmax_t size = std::filesystem::file_size(path, error);
+            sizes.emplace_back(error ? 0 : size, path);
+        }
+
+        // Largest first; equal sizes keep their order in the input list.
+        std::stable_sort(sizes.begin(), sizes.end(), [](const auto& first, const auto& second)
+        {
+            return first.first > second.first;
+        });
+        std::vector<entry> entries;
+        for (const auto& [size, path] : sizes)
+        {
+            entries.push_back({'P', 0, path});
+        }
+        usable = append_entries(entries);
+    }
+
+    if (!usable)
+    {
+        close(descriptor);
+        descriptor = -1;
+    }
+}
+
+work_queue::~work_queue()
+{
+    if (descriptor >= 0)
+    {
+        close(descriptor);
+    }
+}
+
+bool work_queue::claim(std::vector<std::string>& paths, const int count)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    paths.clear();
+    if (descriptor < 0)
+    {
+        return false;
+    }
+
+    queue_lock lock(descriptor);
+    if (!replay())
+    {
+        return false;
+    }
+
+    const long long pid = getpid();
+    std::vector<entry> claims;
+    for (size_t i = firstOpen; i < inputs.size() && static_cast<int>(claims.size()) < count; i++)
+    {
+        const entry& item = inputs[i];
+        const bool abandoned = item.status == 'C' && item.pid != pid && !process_alive(item.pid);
+        if (abandoned)
+        {
+            std::cout << "Reclaiming " << item.path << " from stopped worker " << item.pid << std::endl;
+        }
+
+        const bool pending = item.status == 'P' || (item.status == 'R' && released.count(item.path) == 0);
+        if (pending || abandoned)
+        {
+            claims.push_back({'C', pid, item.path});
+        }
+    }
+
+    if (claims.empty() || !append_entries(claims))
+    {
+        return false;
+    }
+
+    for (const entry& item : claims)
+    {
+        claimed.insert(item.path);
+        paths.push_back(item.path);
+    }
+    return true;
+}
+
+bool work_queue::complete(const std::string& path)
+{
+    return finish(path, 'D');
+}
+
+bool work_queue::release(const std::string& path)
+{
+    return finish(path, 'R');
+}
+
+bool work_queue::finish(const std::string& path, const char status)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    if (descriptor < 0 || claimed.erase(path) == 0)
+    {
+        return false;
+    }
+
+    // Whatever failed here would most likely fail again, so this worker leaves the retry to the others.
+    if (status == 'R')
+    {
+        released.insert(path);
+    }
+
+    queue_lock lock(descriptor);
+    return append_entries({{status, static_cast<long long>(getpid()), path}});
+}
+
+bool work_queue::replay()
+{
+    struct stat status;
+    if (fstat(descriptor, &status) != 0)
+    {
+        std::cout << "[Error] Failed to read the work queue <" << queuePath << ">." << std::endl;
+        return false;
+    }
+
+    // A file shorter than what was replayed has been rewritten, so it is replayed from the start.
+    if (status.st_size < replayedBytes)
+    {
+        inputs.clear();
+        positions.clear();
+        firstOpen = 0;
+        replayedBytes = 0;
+    }
+
+    std::string contents;
+    char buffer[4096];
+    ssize_t count;
+    off_t offset = replayedBytes;
+    while ((count = pread(descriptor, buffer, sizeof(buffer), offset)) > 0)
+    {
+        contents.append(buffer, count);
+        offset += count;
+    }
+
+    if (count < 0)
+    {
+        std::cout << "[Error] Failed to read the work queue <" << queuePath << ">." << std::endl;
+        return false;
+    }
+
+    // Only whole lines are replayed. A line cut short by a crash is ignored and the input it changed keeps its earlier
+    // status; so are lines for paths the queue never listed as pending.
+    const size_t end = contents.rfind('\n');
+    if (end == std::string::npos)
+    {
+        return true;
+    }
+    replayedBytes += end + 1;
+
+    std::istringstream stream(contents.substr(0, end + 1));
+    std::string line;
+    while (std::getline(stream, line))
+    {
+        std::istringstream lineStream(line);
+        entry item{};
+        if (!(lineStream >> item.status >> item.pid) || lineStream.get() != ' ' || !std::getline(lineStream, item.path))
+        {
+            continue;
+        }
+
+        // The first line of a path fixes its place in the queue and the latest its status.
+        const auto found = positions.find(item.path);
+        if (found == positions.end())
+        {
+            if (item.status == 'P')
+            {
+                positions.emplace(item.path, inputs.size());
+                inputs.push_back(std::move(item));
+            }
+            continue;
+        }
+
+        if (item.status != 'D')
+        {
+            firstOpen = std::min(firstOpen, found->second);
+        }
+        inputs[found->second] = std::move(item);
+    }
+
+    while (firstOpen < inputs.size() && inputs[firstOpen].status == 'D')
+    {
+        firstOpen++;
+    }
+    return true;
+}
+
+bool work_queue::append_entries(const std::vector<entry>& entries) const
+{
+    std::ostringstream stream;
+    for (const entry& item : entries)
+    {
+        stream << item.status << ' ' << item.pid << ' ' << item.path << '\n';
+    }
+
+    // O_APPEND puts each write at the end of the file, and the flock keeps other workers' lines from landing in between.
+    const std::string contents = stream.str();
+    size_t offset = 0;
+    while (offset < contents.size())
+    {
+        const ssize_t count = write(descriptor, contents.data() + offset, contents.size() - offset);
+        if (count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            std::cout << "[Error] Failed to write the work queue <" << queuePath << ">." << std::endl;
+            return false;
+        }
+        offset += count;
+    }
+    return true;
+}
+
+bool work_queue::process_alive(const long long pid)
+{
+    return pid > 0 && (kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM);
+}
@@ -0,0 +1,95 @@
+#ifndef WORK_QUEUE_H
+#define WORK_QUEUE_H
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/*-------------------------------------------------------------------------
+ * Input queue shared by any number of worker processes on one machine.
+ *
+ * The queue is a small text file next to the data. Its first worker lists
+ * every input as pending, largest file first so the long runs start early
+ * and the short ones fill in at the end; after that, every change of an
+ * input's status is appended as a line of its own:
+ *
+ *   <P(ending) | C(laimed) | D(one) | R(eleased)> <pid> <input path>
+ *
+ * and an input's status is its latest line. Inputs are keyed by path, so
+ * a queue made for another input list is refused rather than handing out
+ * the wrong files.
+ *
+ * Every read or append holds an exclusive flock, which the kernel releases
+ * if its holder dies. Each process keeps the log it has replayed and reads
+ * only the lines appended since, so a claim costs the new lines rather than
+ * the whole file. Before handing out inputs, claims held by processes
+ * that no longer exist count as pending, so the inputs of a crashed worker
+ * are picked up by the others. A released input is pending for every
+ * worker but the one that released it. The file is created by the first
+ * worker to open it; delete it to start over. One process may call it
+ * from several threads.
+ *------------------------------------------------------------------------*/
+class work_queue
+{
+    public:
+        work_queue(const std::string& queuePath, const std::vector<std::string>& inputPaths);
+
+        ~work_queue();
+
+        // Claims up to count pending inputs for this process, in queue order; false once none are left.
+        bool claim(std::vector<std::string>& paths, int count = 1);
+
+        // Marks an input claimed by this process as done.
+        bool complete(const std::string& path);
+
+        // Hands an input claimed by this process back, for another worker to retry.
+        bool release(const std::string& path);
+
+        work_queue(const work_queue&) = delete;
+
+        work_queue& operator=(const work_queue&) = delete;
+
+    private:
+        struct entry
+        {
+            char status;
+
+            long long pid;
+
+            std::string path;
+        };
+
+        std::string queuePath;
+
+        int descriptor = -1;
+
+        // The flock is shared by every thread of the process, so they take turns here first.
+        std::mutex mutex;
+
+        std::unordered_set<std::string> claimed;
+
+        std::unordered_set<std::string> released;
+
+        // The replayed log: every input in queue order with its latest entry, and where each path sits in it.
+        std::vector<entry> inputs;
+
+        std::unordered_map<std::string, size_t> positions;
+
+        // Every input before this one is done.
+        size_t firstOpen = 0;
+
+        // The bytes of the file replayed so far, always up to the end of a line.
+        long long replayedBytes = 0;
+
+        bool replay();
+
+        bool append_entries(const std::vector<entry>& entries) const;
+
+        bool finish(const std::string& path, char status);
+
+        static bool process_alive(long long pid);
+};
+
+#endif //WORK_QUEUE_H
@@ -0,0 +1,106 @@
+#ifndef WORK_STEALING_QUEUE_H
+#define WORK_STEALING_QUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/*-------------------------------------------------------------------------
+ * A fixed set of work items, numbered 0..itemCount-1, shared out between
+ * workers.
+ *
+ * Each worker starts with a contiguous range of items and takes them from
+ * the front, in order. A worker whose range is empty steals the last item
+ * of another worker's range, so consecutive items stay with one worker for
+ * as long as the load is even. A range is a single 64-bit word holding
+ * (begin, end), updated by compare-and-swap, so owner and thieves never
+ * take the same item. Ranges sit on separate cache lines.
+ *------------------------------------------------------------------------*/
+class work_stealing_queue
+{
+    public:
+        work_stealing_queue(const unsigned long long itemCount, const unsigned long long workerCount)
+            : ranges(workerCount > 0 ? workerCount : 1)
+        {
+            const unsigned long long count = ranges.size();
+            for (unsigned long long w = 0; w < count; w++)
+            {
+                ranges[w].bounds.store(pack(itemCount * w / count, itemCount * (w + 1) / count), std::memory_order_relaxed);
+            }
+        }
+
+        // Takes the next item of the worker's own range, or steals one; false once every item has been taken.
+        bool next(const unsigned long long worker, unsigned long long& item)
+        {
+            const unsigned long long count = ranges.size();
+            const unsigned long long own = worker % count;
+            if (take_front(ranges[own].bounds, item))
+            {
+                return true;
+            }
+
+            for (unsigned long long offset = 1; offset < count; offset++)
+            {
+                if (take_back(ranges[(own + offset) % count].bounds, item))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    private:
+        struct alignas(64) range
+        {
+            std::atomic<std::uint64_t> bounds{0};
+        };
+
+        std::vector<range> ranges;
+
+        static std::uint64_t pack(const std::uint64_t begin, const std::uint64_t end)
+        {
+            return begin << 32 | end;
+        }
+
+        static bool take_front(std::atomic<std::uint64_t>& bounds, unsigned long long& item)
+        {
+            std::uint64_t current = bounds.load(std::memory_order_relaxed);
+            while (true)
+            {
+                const std::uint64_t begin = current >> 32;
+                const std::uint64_t end = current & 0xFFFFFFFFu;
+                if (begin >= end)
+                {
+                    return false;
+                }
+
+                if (bounds.compare_exchange_weak(current, pack(begin + 1, end), std::memory_order_acq_rel, std::memory_order_relaxed))
+                {
+                    item = begin;
+                    return true;
+                }
+            }
+        }
+
+        static bool take_back(std::atomic<std::uint64_t>& bounds, unsigned long long& item)
+        {
+            std::uint64_t current = bounds.load(std::memory_order_relaxed);
+            while (true)
+            {
+                const std::uint64_t begin = current >> 32;
+                const std::uint64_t end = current & 0xFFFFFFFFu;
+                if (begin >= end)
+                {
+                    return false;
+                }
+
+                if (bounds.compare_exchange_weak(current, pack(begin, end - 1), std::memory_order_acq_rel, std::memory_order_relaxed))
+                {
+                    item = end - 1;
+                    return true;
+                }
+            }
+        }
+};
+
+#endif //WORK_STEALING_QUEUE_H
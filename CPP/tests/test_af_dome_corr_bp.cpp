@@ -0,0 +1,67 @@
+#include <armadillo>
+
+#include "test_framework.h"
+#include "../src/algs/af_dome_corr_bp.h"
+
+namespace
+{
+    constexpr int pulseCount = 40;
+
+    // A 16 x 12 pixel scene seen by 40 pulses over 4 degrees of azimuth, with random phase history over 64 frequencies.
+    af_dome_corr_bp synthetic_dome()
+    {
+        arma::arma_rng::set_seed(11);
+        af_dome_corr_bp imager("synthetic", polarization_types::HH, 10, 8, 128, 16, 12, 0, 0);
+        imager.azim = arma::linspace<arma::mat>(10, 14, pulseCount);
+        imager.elevation = arma::mat(pulseCount, 1, arma::fill::value(30));
+        imager.frequencyGHz = arma::linspace<arma::mat>(9.6, 9.6 + 63 * 1e-3, 64);
+        imager.polarized_phase = arma::randn<arma::cx_mat>(64, pulseCount);
+        return imager;
+    }
+
+    double relative_difference(const arma::mat& actual, const arma::mat& expected)
+    {
+        return arma::norm(arma::vectorise(actual - expected)) / arma::norm(arma::vectorise(expected));
+    }
+}
+
+// Every lag but the zero lag sums to the streamed full sum.
+TEST_CASE(lags, window_sums_to_the_full_sum)
+{
+    af_dome_corr_bp fullSum = synthetic_dome();
+    CHECK(fullSum.get_image_data() == 0);
+
+    af_dome_corr_bp window = synthetic_dome();
+    window.set_lag_window(1, 2 * pulseCount - 2);
+    CHECK(window.get_image_data() == 0);
+    CHECK(window.lagImageData.n_slices == 2 * pulseCount - 2);
+    CHECK(relative_difference(window.imageData, fullSum.imageData) < 1e-9);
+}
+
+// Leading and trailing lags keep only the pulses they pair, and match the same lags of the whole pulse buffer.
+TEST_CASE(lags, selected_lags_match_the_whole_buffer)
+{
+    af_dome_corr_bp all = synthetic_dome();
+    all.set_lag_window(0, 2 * pulseCount - 2);
+    CHECK(all.get_image_data() == 0);
+
+    const arma::uvec selections[] = {{1, 2, 5}, {0}, {pulseCount - 1, pulseCount}, {2 * pulseCount - 3, 2 * pulseCount - 2}, {3, 2 * pulseCount - 4}};
+    for (const arma::uvec& selected : selections)
+    {
+        af_dome_corr_bp imager = synthetic_dome();
+        imager.set_lags(selected);
+        CHECK(imager.get_image_data() == 0);
+        CHECK(imager.lagImageData.n_slices == selected.n_elem);
+        for (arma::uword k = 0; k < selected.n_elem && k < imager.lagImageData.n_slices; k++)
+        {
+            CHECK(relative_difference(imager.lagImageData.slice(k), all.lagImageData.slice(selected(k))) < 1e-9);
+        }
+    }
+}
+
+TEST_CASE(lags, rejects_lags_beyond_the_series)
+{
+    af_dome_corr_bp imager = synthetic_dome();
+    imager.set_lags({2 * pulseCount - 1});
+    CHECK(imager.get_image_data() != 0);
+}
@@ -0,0 +1,52 @@
+#include <armadillo>
+
+#include "test_framework.h"
+#include "../src/constants.h"
+#include "../src/algs/af_dome_pfa.h"
+
+namespace
+{
+    // Point targets on pixels of an 11 x 9 grid with 1 m spacing, seen by 40 pulses over 4 degrees of azimuth at
+    // 30 degrees elevation, 64 frequencies from 9.6 GHz in 3 MHz steps.
+    af_dome_pfa point_targets()
+    {
+        const int pulseCount = 40;
+        const int frequencyCount = 64;
+        af_dome_pfa imager("point targets", polarization_types::HH, 10, 8, 128, 11, 9, 0, 0);
+        imager.azim = arma::linspace<arma::mat>(10, 14, pulseCount);
+        imager.elevation = arma::mat(pulseCount, 1, arma::fill::value(30));
+        imager.frequencyGHz = 9.6 + arma::regspace<arma::mat>(0, frequencyCount - 1) * 3e-3;
+
+        const double targets[][3] = {{2, -1, 1}, {-3, 2, 0.7}};
+        imager.polarized_phase = arma::cx_mat(frequencyCount, pulseCount, arma::fill::zeros);
+        for (int p = 0; p < pulseCount; p++)
+        {
+            const double lookX = std::cos(30 * radian) * std::cos(imager.azim(p) * radian);
+            const double lookY = std::cos(30 * radian) * std::sin(imager.azim(p) * radian);
+            for (int k = 0; k < frequencyCount; k++)
+            {
+                const double wavenumber = 4 * pi * imager.frequencyGHz(k) * 1e9 / c;
+                for (const auto& target : targets)
+                {
+                    imager.polarized_phase(k, p) += target[2] * std::polar(1.0, -wavenumber * (target[0] * lookX + target[1] * lookY));
+                }
+            }
+        }
+        return imager;
+    }
+}
+
+TEST_CASE(pfa, matches_back_projection)
+{
+    const af_dome_pfa::back_projection_comparison comparison = af_dome_pfa::compare_with_back_projection(point_targets());
+    CHECK(comparison.peaksAgree);
+    CHECK(comparison.correlation > 0.99);
+    CHECK_NEAR(comparison.peakRatio, 1, 0.15);
+}
+
+TEST_CASE(pfa, rejects_wide_apertures)
+{
+    af_dome_pfa imager = point_targets();
+    imager.azim = arma::linspace<arma::mat>(0, 100, imager.azim.n_elem);
+    CHECK(imager.get_image_data() != 0);
+}
@@ -0,0 +1,34 @@
+#include <armadillo>
+#include <cstdint>
+
+#include "test_framework.h"
+#include "../src/algs/back_projection_core.h"
+
+// Every pixel column of the buffer starts on its own cache line, and the padding rows are zero.
+TEST_CASE(back_projection, buffer_columns_are_cache_line_aligned)
+{
+    for (const unsigned long long pulses : {1ULL, 3ULL, 4ULL, 37ULL})
+    {
+        buffered_accumulation accumulation(pulses, 10);
+        CHECK(accumulation.buffer.n_rows >= pulses);
+        CHECK(accumulation.buffer.n_rows * sizeof(arma::cx_double) % 64 == 0);
+        CHECK(reinterpret_cast<std::uintptr_t>(accumulation.buffer.memptr()) % 64 == 0);
+        CHECK(accumulation.buffer.n_cols == 10);
+        CHECK(arma::all(arma::vectorise(accumulation.buffer) == arma::cx_double(0, 0)));
+    }
+}
+
+// Tiles that cannot be shared take every pulse in one item, and are narrowed so each worker still has several.
+TEST_CASE(back_projection, unshared_tiles_keep_whole_pulse_ranges)
+{
+    const tile_layout shared = tile_layout::fit<double>(64, 512, 1000, 8);
+    CHECK(shared.pulseBlock < 1000);
+
+    const tile_layout whole = tile_layout::fit<double>(64, 512, 1000, 8, false);
+    CHECK(whole.pulseBlock == 1000);
+    CHECK((512 + whole.tileCols - 1) / whole.tileCols >= tile_layout::itemsPerWorker * 8);
+
+    const tile_layout narrow = tile_layout::fit<double>(64, 3, 1000, 8, false);
+    CHECK(narrow.tileCols == 1);
+    CHECK(narrow.pulseBlock == 1000);
+}
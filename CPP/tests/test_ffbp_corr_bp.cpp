@@ -0,0 +1,75 @@
+#include <armadillo>
+
+#include "test_framework.h"
+#include "../src/constants.h"
+#include "../src/algs/ffbp_corr_bp.h"
+#include "../src/utils/matrix_math.h"
+
+namespace
+{
+    // Point targets in a 24 x 20 pixel flat scene, 10 m across, seen by 48 pulses over 3 degrees of azimuth at 30 degrees
+    // elevation, 64 frequencies from 9.6 GHz in 3 MHz steps. Each target is the response sample_corr_bp focuses at a pixel
+    // of differential range dR: a range profile peak at dR whose phase is exp(4 pi i freqMin dR / c).
+    ffbp_corr_bp point_targets()
+    {
+        const int pulseCount = 48;
+        const int frequencyCount = 64;
+        ffbp_corr_bp imager("point targets", false);
+        imager.numXSamples = 24;
+        imager.numYSamples = 20;
+        imager.frequencyStepSize = 3e6;
+        imager.freqMin = 9.6e9;
+        imager.freqMax = imager.freqMin + (frequencyCount - 1) * imager.frequencyStepSize;
+        mesh_grid(imager.pixelX, imager.pixelY, arma::linspace(-5, 5, imager.numXSamples), arma::linspace(-4, 4, imager.numYSamples));
+        imager.pixelZ = arma::mat(imager.numXSamples, imager.numYSamples, arma::fill::zeros);
+        imager.antAzim = arma::linspace(0, 3, pulseCount);
+        imager.antElev = arma::vec(pulseCount).fill(30);
+
+        const double targets[][3] = {{2, -1, 1}, {-3, 2, 0.7}};
+        imager.phase = arma::cx_mat(frequencyCount, pulseCount, arma::fill::zeros);
+        for (int p = 0; p < pulseCount; p++)
+        {
+            const double lookX = std::cos(30 * radian) * std::cos(imager.antAzim(p) * radian);
+            const double lookY = std::cos(30 * radian) * std::sin(imager.antAzim(p) * radian);
+            for (int k = 0; k < frequencyCount; k++)
+            {
+                const double wavenumber = 4 * pi * (imager.freqMin - k * imager.frequencyStepSize) / c;
+                for (const auto& target : targets)
+                {
+                    imager.phase(k, p) += target[2] * std::polar(1.0, wavenumber * (target[0] * lookX + target[1] * lookY));
+                }
+            }
+        }
+        return imager;
+    }
+}
+
+// The factorized image puts the targets where direct back-projection does, and finer subimages bring it closer.
+TEST_CASE(ffbp, matches_back_projection)
+{
+    ffbp_corr_bp imager = point_targets();
+    const ffbp_corr_bp::direct_comparison coarse = ffbp_corr_bp::compare_with_direct(imager);
+    CHECK(coarse.peaksAgree);
+    CHECK(coarse.correlation > 0.99);
+
+    imager.rangeOversampling = 4;
+    imager.crossRangeOversampling = 4;
+    const ffbp_corr_bp::direct_comparison fine = ffbp_corr_bp::compare_with_direct(imager);
+    CHECK(fine.peaksAgree);
+    CHECK(fine.correlation > 0.999);
+    CHECK(fine.relativeError < 0.15);
+    CHECK(fine.relativeError < coarse.relativeError);
+    CHECK_NEAR(fine.peakRatio, 1, 0.15);
+}
+
+// A phase history without pulses, or pixel grids of another size than the image, fail instead of imaging.
+TEST_CASE(ffbp, rejects_inconsistent_inputs)
+{
+    ffbp_corr_bp imager = point_targets();
+    imager.pixelX = imager.pixelX.rows(1, imager.pixelX.n_rows - 1);
+    CHECK(imager.get_image_data() != 0);
+
+    imager = point_targets();
+    imager.phase.reset();
+    CHECK(imager.get_image_data() != 0);
+}
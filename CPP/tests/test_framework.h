@@ -0,0 +1,83 @@
+#ifndef TEST_FRAMEWORK_H
+#define TEST_FRAMEWORK_H
+
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*-------------------------------------------------------------------------
+ * A minimal test registry. TEST_CASE(group, name) defines a test and
+ * registers it under its group; CPP_tests runs the groups named on its
+ * command line, or every group without arguments, and ctest runs one group
+ * per test. CHECK and CHECK_NEAR report a failure and carry on, so one run
+ * lists every broken expectation of a test.
+ *------------------------------------------------------------------------*/
+struct test_case
+{
+    std::string group;
+
+    std::string name;
+
+    void (*run)();
+};
+
+inline std::vector<test_case>& test_registry()
+{
+    static std::vector<test_case> registry;
+    return registry;
+}
+
+inline int& test_failures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+struct test_registration
+{
+    test_registration(const char* group, const char* name, void (*run)())
+    {
+        test_registry().push_back({group, name, run});
+    }
+};
+
+// An empty directory for a test's files, under the system temporary directory.
+inline std::string test_directory(const std::string& name)
+{
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "CPP_tests" / name;
+    std::filesystem::remove_all(path);
+    std::filesystem::create_directories(path);
+    return path.string() + "/";
+}
+
+#define TEST_CASE(group, name) \
+    static void group##_##name(); \
+    static const test_registration group##_##name##_registration(#group, #name, group##_##name); \
+    static void group##_##name()
+
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            test_failures()++; \
+            std::cout << "[Error] " << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed." << std::endl; \
+        } \
+    } while (false)
+
+#define CHECK_NEAR(actual, expected, tolerance) \
+    do \
+    { \
+        const double checkActual = (actual); \
+        const double checkExpected = (expected); \
+        if (!(std::abs(checkActual - checkExpected) <= (tolerance))) \
+        { \
+            test_failures()++; \
+            std::cout << "[Error] " << __FILE__ << ":" << __LINE__ << ": CHECK_NEAR(" #actual ", " #expected ") failed: " \
+                << checkActual << " vs " << checkExpected << ", tolerance " << (tolerance) << "." << std::endl; \
+        } \
+    } while (false)
+
+#endif //TEST_FRAMEWORK_H
@@ -0,0 +1,152 @@
+#include <armadillo>
+#include <cmath>
+#include <hdf5.h>
+#include <string>
+#include <vector>
+
+#include "test_framework.h"
+#include "../src/utils/hdf5_reader.h"
+#include "../src/utils/image_encoder.h"
+
+namespace
+{
+    // A complex image whose magnitudes fall evenly in dB from 2 down to 80 dB below, past the 60 dB every dB encoding keeps.
+    arma::cx_mat falling_image()
+    {
+        arma::cx_mat image(16, 8);
+        for (arma::uword i = 0; i < image.n_elem; i++)
+        {
+            const double magnitude = 2 * std::pow(10.0, -4.0 * i / (image.n_elem - 1));
+            image(i) = std::polar(magnitude, 0.3 * i);
+        }
+        return image;
+    }
+
+    double read_attribute(const hid_t dataset, const char* name)
+    {
+        double value = 0;
+        const hid_t attribute = H5Aopen(dataset, name, H5P_DEFAULT);
+        if (attribute >= 0)
+        {
+            H5Aread(attribute, H5T_NATIVE_DOUBLE, &value);
+            H5Aclose(attribute);
+        }
+        return value;
+    }
+
+    // Writes the image in an encoding, reads it back converted to double by HDF5, and decodes it with the stored scale and offset.
+    bool round_trip(const output_encodings encoding, const arma::cx_mat& image, const bool complex, std::vector<double>& decoded)
+    {
+        const std::string path = test_directory("image_encoder_" + image_encoder::name(encoding) + (complex ? "_complex" : "_real"))
+            + "image.hdf5";
+        const arma::mat magnitudes = arma::abs(image);
+        const double* values = complex ? reinterpret_cast<const double*>(image.memptr()) : magnitudes.memptr();
+        const hid_t file = H5Fcreate(path.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+        const bool written = file >= 0
+            && image_encoder(encoding).write(file, "dataset", {image.n_cols, image.n_rows}, values, complex);
+        if (file >= 0)
+        {
+            H5Fclose(file);
+        }
+        if (!written)
+        {
+            return false;
+        }
+
+        const hid_t readFile = H5Fopen(path.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+        const hid_t dataset = H5Dopen2(readFile, "dataset", H5P_DEFAULT);
+        const bool magnitudeOnly = encoding != output_encodings::NATIVE && encoding != output_encodings::FLOAT;
+        const bool stored = complex && !magnitudeOnly;
+        decoded.assign(image.n_elem * (stored ? 2 : 1), 0);
+        const hid_t type = stored ? hdf5_memory_type<std::complex<double>>() : hdf5_memory_type<double>();
+        const bool read = H5Dread(dataset, type, H5S_ALL, H5S_ALL, H5P_DEFAULT, decoded.data()) >= 0;
+        H5Tclose(type);
+
+        if (magnitudeOnly)
+        {
+            const double scale = read_attribute(dataset, "scale");
+            const double offset = read_attribute(dataset, "offset");
+            for (double& value : decoded)
+            {
+                value = encoding == output_encodings::MAGNITUDE_HALF ? value * scale : value * scale + offset;
+            }
+        }
+        H5Dclose(dataset);
+        H5Fclose(readFile);
+        return read;
+    }
+}
+
+// NATIVE keeps every bit and FLOAT keeps float precision, of real and of complex images.
+TEST_CASE(encoding, lossless_and_float_round_trip)
+{
+    const arma::cx_mat image = falling_image();
+    for (const bool complex : {false, true})
+    {
+        const arma::mat magnitudes = arma::abs(image);
+        const double* values = complex ? reinterpret_cast<const double*>(image.memptr()) : magnitudes.memptr();
+        const size_t count = image.n_elem * (complex ? 2 : 1);
+
+        std::vector<double> decoded;
+        CHECK(round_trip(output_encodings::NATIVE, image, complex, decoded));
+        for (size_t i = 0; i < count && decoded.size() == count; i++)
+        {
+            CHECK(decoded[i] == values[i]);
+        }
+
+        CHECK(round_trip(output_encodings::FLOAT, image, complex, decoded));
+        for (size_t i = 0; i < count && decoded.size() == count; i++)
+        {
+            CHECK_NEAR(decoded[i], values[i], 1e-7 * std::abs(values[i]));
+        }
+    }
+}
+
+// MAGNITUDE_HALF stores magnitude over peak as IEEE binary16, so each magnitude comes back within half a float16 step.
+TEST_CASE(encoding, half_precision_round_trip)
+{
+    const arma::cx_mat image = falling_image();
+    const double peak = arma::abs(image).max();
+    for (const bool complex : {false, true})
+    {
+        std::vector<double> decoded;
+        CHECK(round_trip(output_encodings::MAGNITUDE_HALF, image, complex, decoded));
+        CHECK(decoded.size() == image.n_elem);
+        for (size_t i = 0; i < decoded.size(); i++)
+        {
+            // binary16 has 11 significant bits down to 2^-14 of the peak, and steps of 2^-24 of it below.
+            const double magnitude = std::abs(image(i));
+            CHECK_NEAR(decoded[i], magnitude, std::max(magnitude * std::pow(2.0, -11), peak * std::pow(2.0, -25)));
+        }
+    }
+}
+
+// The dB encodings keep 60 dB below the peak to half a quantisation step, and clamp anything weaker to the 60 dB floor.
+TEST_CASE(encoding, decibel_round_trip_clamps_at_dynamic_range)
+{
+    const arma::cx_mat image = falling_image();
+    const double peakDb = 20 * std::log10(arma::abs(image).max());
+    for (const output_encodings encoding : {output_encodings::DB_UINT8, output_encodings::DB_UINT16})
+    {
+        const double step = 60.0 / (encoding == output_encodings::DB_UINT8 ? 255 : 65535);
+        for (const bool complex : {false, true})
+        {
+            std::vector<double> decoded;
+            CHECK(round_trip(encoding, image, complex, decoded));
+            CHECK(decoded.size() == image.n_elem);
+            int clamped = 0;
+            for (size_t i = 0; i < decoded.size(); i++)
+            {
+                const double db = 20 * std::log10(std::abs(image(i)));
+                if (db < peakDb - 60)
+                {
+                    CHECK_NEAR(decoded[i], peakDb - 60, 1e-9);
+                    clamped++;
+                    continue;
+                }
+                CHECK_NEAR(decoded[i], db, step / 2 + 1e-9);
+            }
+            CHECK(clamped > 0);
+        }
+    }
+}
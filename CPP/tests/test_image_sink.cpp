@@ -0,0 +1,91 @@
+#include <armadillo>
+#include <hdf5.h>
+#include <string>
+#include <vector>
+
+#include "test_framework.h"
+#include "../src/utils/hdf5_reader.h"
+#include "../src/utils/image_sink.h"
+
+namespace
+{
+    // The dimensions of a dataset in the sink file, or none if it does not exist.
+    std::vector<hsize_t> dataset_dimensions(const std::string& path, const std::string& name)
+    {
+        std::vector<hsize_t> dimensions;
+        const hid_t file = H5Fopen(path.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+        if (file < 0)
+        {
+            return dimensions;
+        }
+
+        if (hdf5_link_exists(file, name))
+        {
+            const hid_t dataset = H5Dopen2(file, name.c_str(), H5P_DEFAULT);
+            const hid_t space = H5Dget_space(dataset);
+            dimensions.resize(H5Sget_simple_extent_ndims(space));
+            H5Sget_simple_extent_dims(space, dimensions.data(), nullptr);
+            H5Sclose(space);
+            H5Dclose(dataset);
+        }
+        H5Fclose(file);
+        return dimensions;
+    }
+}
+
+// Images of another size or type than their field's first go to a group of their own, and the rest of the batch is still written.
+TEST_CASE(sink, odd_sized_images_get_their_own_group)
+{
+    const std::string directory = test_directory("image_sink");
+    image_sink sink(directory, 8);
+    CHECK(sink.append("first", "image", arma::mat(4, 3, arma::fill::randu)));
+    CHECK(sink.append("odd", "image", arma::mat(5, 2, arma::fill::randu)));
+    CHECK(sink.append("second", "image", arma::mat(4, 3, arma::fill::randu)));
+    CHECK(sink.append("complex", "image", arma::cx_mat(4, 3, arma::fill::randu)));
+    CHECK(sink.append("third", "image", arma::mat(4, 3, arma::fill::randu)));
+    CHECK(sink.close());
+
+    CHECK(dataset_dimensions(sink.path(), "image/data") == (std::vector<hsize_t>{3, 3, 4}));
+    CHECK(dataset_dimensions(sink.path(), "image/source") == std::vector<hsize_t>{3});
+    CHECK(dataset_dimensions(sink.path(), "image_5x2/data") == (std::vector<hsize_t>{1, 2, 5}));
+    CHECK(dataset_dimensions(sink.path(), "image_5x2/source") == std::vector<hsize_t>{1});
+    CHECK(dataset_dimensions(sink.path(), "image_4x3_complex/data") == (std::vector<hsize_t>{1, 3, 4}));
+
+    // A later run appending to the file keeps sending each size to the group it went to before.
+    image_sink again(directory, 8);
+    CHECK(again.path() == sink.path());
+    CHECK(again.append("fourth", "image", arma::mat(5, 2, arma::fill::randu)));
+    CHECK(again.append("fifth", "image", arma::mat(4, 3, arma::fill::randu)));
+    CHECK(again.close());
+    CHECK(dataset_dimensions(sink.path(), "image/data") == (std::vector<hsize_t>{4, 3, 4}));
+    CHECK(dataset_dimensions(sink.path(), "image_5x2/data") == (std::vector<hsize_t>{2, 2, 5}));
+}
+
+// A source is reported written only once the batch holding its images is flushed, and a second sink on the directory takes a file of its own.
+TEST_CASE(sink, commits_wait_for_the_flush)
+{
+    const std::string directory = test_directory("image_sink_commits");
+    std::vector<std::string> written;
+    image_sink sink(directory, 2);
+    CHECK(sink.path() == directory + "/images.hdf5");
+    CHECK(sink.append("first", "image", arma::mat(4, 3, arma::fill::randu)));
+    CHECK(sink.append("first", "corr", arma::mat(4, 3, arma::fill::randu)));
+    CHECK(sink.append("second", "image", arma::mat(4, 3, arma::fill::randu)));
+    sink.commit("first", [&written](const bool succeeded)
+    {
+        written.push_back(succeeded ? "first" : "first failed");
+    });
+    sink.commit("second", [&written](const bool succeeded)
+    {
+        written.push_back(succeeded ? "second" : "second failed");
+    });
+
+    image_sink other(directory, 2);
+    CHECK(other.path() == directory + "/images_1.hdf5");
+    CHECK(other.close());
+
+    CHECK(written.empty());
+    CHECK(sink.close());
+    CHECK(written == (std::vector<std::string>{"first", "second"}));
+    CHECK(dataset_dimensions(sink.path(), "image/data") == (std::vector<hsize_t>{2, 3, 4}));
+}
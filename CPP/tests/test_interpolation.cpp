@@ -0,0 +1,109 @@
+#include <armadillo>
+
+#include "test_framework.h"
+#include "../src/utils/matrix_math.h"
+#include "../src/utils/stopwatch.h"
+
+namespace
+{
+    // arma::interp1 over the real and imaginary parts, the computation interp1_uniform replaces.
+    template <typename T>
+    arma::Col<std::complex<T>> paired_interp1(const arma::Col<T>& grid, const arma::Col<std::complex<T>>& values,
+        const arma::Col<T>& query, const std::complex<T> extrapolationValue)
+    {
+        arma::Col<T> real;
+        arma::Col<T> imag;
+        arma::interp1(grid, arma::Col<T>(arma::real(values)), query, real, "linear", extrapolationValue.real());
+        arma::interp1(grid, arma::Col<T>(arma::imag(values)), query, imag, "linear", extrapolationValue.imag());
+        return arma::Col<std::complex<T>>(real, imag);
+    }
+
+    // Grid ends, points just inside and outside them, a point on every grid node and random points covering the grid and beyond.
+    template <typename T>
+    arma::Col<T> edge_queries(const arma::Col<T>& grid)
+    {
+        const T first = grid(0);
+        const T last = grid(grid.n_elem - 1);
+        const T span = last - first;
+        const arma::Col<T> edges = {first, last, first + span * T(1e-4), last - span * T(1e-4),
+            first - span * T(1e-4), last + span * T(1e-4), first - span, last + span};
+        const arma::Col<T> spread = first - span / 4 + arma::randu<arma::Col<T>>(500) * span * T(1.5);
+        return arma::join_cols(edges, grid, spread);
+    }
+
+    template <typename T>
+    void check_against_interp1(const arma::Col<T>& grid, const std::complex<T> extrapolationValue, const double tolerance)
+    {
+        const arma::Col<std::complex<T>> values(arma::randn<arma::Col<T>>(grid.n_elem), arma::randn<arma::Col<T>>(grid.n_elem));
+        const arma::Col<T> query = edge_queries(grid);
+        const arma::Col<std::complex<T>> expected = paired_interp1(grid, values, query, extrapolationValue);
+
+        const arma::Col<std::complex<T>> interleaved = interp1_uniform(grid, values, query, extrapolationValue);
+        const arma::Col<std::complex<T>> split = interp1_uniform(grid, arma::Col<T>(arma::real(values)), arma::Col<T>(arma::imag(values)),
+            query, extrapolationValue);
+        CHECK(interleaved.n_elem == query.n_elem);
+        CHECK_NEAR(arma::abs(interleaved - expected).max(), 0, tolerance);
+        CHECK_NEAR(arma::abs(split - expected).max(), 0, tolerance);
+
+        // The two queries just outside the grid and the two a whole span away.
+        for (arma::uword i = 4; i < 8; i++)
+        {
+            CHECK(interleaved(i) == extrapolationValue);
+            CHECK(split(i) == extrapolationValue);
+        }
+    }
+}
+
+TEST_CASE(interpolation, matches_interp1_on_non_multiple_steps)
+{
+    arma::arma_rng::set_seed(1);
+    // Spacings which are not multiples of the grid start, nor exactly representable.
+    check_against_interp1<double>(arma::linspace<arma::vec>(0.3, 7.1, 37), {0, 0}, 1e-12);
+    check_against_interp1<double>(arma::linspace<arma::vec>(-2.0 / 3.0, 1e3 / 7.0, 1001), {0, 0}, 1e-12);
+    check_against_interp1<double>(arma::linspace<arma::vec>(1.0, 1.1, 2), {0, 0}, 1e-12);
+    check_against_interp1<float>(arma::linspace<arma::fvec>(0.3f, 7.1f, 37), {0, 0}, 1e-5);
+}
+
+TEST_CASE(interpolation, applies_extrapolation_value_outside_the_grid)
+{
+    arma::arma_rng::set_seed(2);
+    check_against_interp1<double>(arma::linspace<arma::vec>(0.3, 7.1, 37), {-5, 2}, 1e-12);
+    check_against_interp1<float>(arma::linspace<arma::fvec>(-1.5f, 0.25f, 129), {3, -1}, 1e-5);
+
+    const arma::vec grid = arma::linspace<arma::vec>(0.3, 7.1, 37);
+    const arma::cx_vec values = arma::randn<arma::cx_vec>(grid.n_elem);
+    const arma::cx_vec ends = interp1_uniform(grid, values, arma::vec({grid(0), grid(grid.n_elem - 1)}), {-5, 2});
+    CHECK_NEAR(std::abs(ends(0) - values(0)), 0, 1e-12);
+    CHECK_NEAR(std::abs(ends(1) - values(values.n_elem - 1)), 0, 1e-12);
+}
+
+// Prints the time of the fused kernel against the paired arma::interp1 calls it replaces, for a range profile of back-projection size.
+TEST_CASE(interpolation, timing)
+{
+    arma::arma_rng::set_seed(3);
+    const arma::vec grid = arma::linspace<arma::vec>(-75.0, 75.0, 4096);
+    const arma::cx_vec values = arma::randn<arma::cx_vec>(grid.n_elem);
+    const arma::vec query = arma::randu<arma::vec>(1 << 20) * 150.0 - 75.0;
+    const int repeats = 10;
+
+    stopwatch timer;
+    arma::cx_vec paired;
+    for (int i = 0; i < repeats; i++)
+    {
+        paired = paired_interp1(grid, values, query, {0, 0});
+    }
+    const long long pairedMicroseconds = timer.elapsed_microseconds();
+
+    timer.restart();
+    arma::cx_vec fused;
+    for (int i = 0; i < repeats; i++)
+    {
+        fused = interp1_uniform(grid, values, query);
+    }
+    const long long fusedMicroseconds = std::max(timer.elapsed_microseconds(), 1LL);
+
+    CHECK_NEAR(arma::abs(fused - paired).max(), 0, 1e-12);
+    std::cout << "[Timing] interp1 of " << query.n_elem << " queries on " << grid.n_elem << " samples, " << repeats << " repeats" << std::endl;
+    std::cout << "    paired arma::interp1: " << pairedMicroseconds << " us, interp1_uniform: " << fusedMicroseconds << " us, speedup "
+        << static_cast<double>(pairedMicroseconds) / static_cast<double>(fusedMicroseconds) << std::endl;
+}
@@ -0,0 +1,30 @@
+#include <iostream>
+#include <set>
+#include <string>
+
+#include "test_framework.h"
+
+int main(const int argc, char** argv)
+{
+    const std::set<std::string> groups(argv + 1, argv + argc);
+    int ran = 0;
+    for (const test_case& test : test_registry())
+    {
+        if (!groups.empty() && groups.count(test.group) == 0)
+        {
+            continue;
+        }
+
+        const int failuresBefore = test_failures();
+        test.run();
+        std::cout << (test_failures() == failuresBefore ? "[Passed] " : "[Failed] ") << test.group << "." << test.name << std::endl;
+        ran++;
+    }
+
+    if (ran == 0)
+    {
+        std::cout << "[Error] No tests matched." << std::endl;
+        return 1;
+    }
+    return test_failures() == 0 ? 0 : 1;
+}
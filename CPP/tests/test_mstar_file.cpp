@@ -0,0 +1,189 @@
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "test_framework.h"
+#include "../src/utils/mstar_catalog.h"
+#include "../src/utils/mstar_file.h"
+#include "../src/utils/phoenix_header.h"
+
+namespace
+{
+    // Big-endian float32 bit patterns and the values the original mstar2raw swaps them to on a little-endian machine.
+    const std::vector<std::uint32_t> chipMagnitudeBits = {0x3F800000, 0x3F000000, 0x40000000, 0x3E800000, 0x40400000, 0x3E000000};
+    const std::vector<float> chipMagnitudes = {1.0f, 0.5f, 2.0f, 0.25f, 3.0f, 0.125f};
+    const std::vector<std::uint32_t> chipPhaseBits = {0x40490FDB, 0xBF800000, 0x00000000, 0x3FC90FDB, 0xC0490FDB, 0x3F000000};
+    const std::vector<float> chipPhases = {3.14159274f, -1.0f, 0.0f, 1.57079637f, -3.14159274f, 0.5f};
+
+    // Big-endian uint16 full scene pixels; phases keep only 12 bits.
+    const std::vector<std::uint16_t> sceneMagnitudes = {0x0001, 0x0100, 0x1234, 0xFFFF, 0x0080, 0x8000};
+    const std::vector<std::uint16_t> scenePhases = {0x0000, 0x0FFF, 0x0800, 0x0001, 0x0010, 0x0100};
+
+    // A Phoenix header of 2 rows and 3 columns, padded with filler lines to at least minimumLength and its length written in.
+    std::string phoenix_text(const size_t nativeLength, const size_t minimumLength, const std::string& targetType = "t72_tank",
+        const std::string& azimuth = "47.25")
+    {
+        std::string body = "NumberOfColumns= 3\nNumberOfRows= 2\nTargetType= " + targetType + "\nPolarization= HH\n"
+            "native_header_length= " + std::to_string(nativeLength) + "\n";
+        while (body.size() < minimumLength)
+        {
+            body += "Filler= 0123456789012345678901234567890123456789\n";
+        }
+        body += "TargetAz= " + azimuth + "\nMeasuredDepression= 15.0\nCenterFrequency= 9.60 GHz\nBandwidth= 0.591 GHz\n"
+            "[EndofPhoenixHeader]\n";
+
+        const std::string start = "[PhoenixHeaderVer01.04]\nPhoenixHeaderLength= ";
+        const size_t length = start.size() + 6 + 1 + body.size();
+        std::string digits = std::to_string(length);
+        digits.insert(0, 6 - digits.size(), '0');
+        return start + digits + "\n" + body;
+    }
+
+    template <typename T>
+    void write_big_endian(std::ofstream& stream, const std::vector<T>& values)
+    {
+        for (const T value : values)
+        {
+            for (int shift = 8 * (sizeof(T) - 1); shift >= 0; shift -= 8)
+            {
+                stream.put(static_cast<char>((value >> shift) & 0xFF));
+            }
+        }
+    }
+
+    void write_chip(const std::string& path, const size_t minimumLength, const std::string& targetType, const std::string& azimuth)
+    {
+        std::ofstream stream(path, std::ios::binary);
+        stream << phoenix_text(0, minimumLength, targetType, azimuth);
+        write_big_endian(stream, chipMagnitudeBits);
+        write_big_endian(stream, chipPhaseBits);
+    }
+
+    std::string write_chip(const std::string& name, const size_t minimumLength)
+    {
+        const std::string path = test_directory("mstar_file_" + name) + name;
+        write_chip(path, minimumLength, "t72_tank", "47.25");
+        return path;
+    }
+
+    std::string write_scene(const std::string& name)
+    {
+        const std::string path = test_directory("mstar_file_" + name) + name;
+        std::ofstream stream(path, std::ios::binary);
+        stream << phoenix_text(512, 0) << std::string(512, 'N');
+        write_big_endian(stream, sceneMagnitudes);
+        write_big_endian(stream, scenePhases);
+        return path;
+    }
+
+    void check_header(const phoenix_header& header, const size_t nativeLength)
+    {
+        CHECK(header.numRows == 2);
+        CHECK(header.numCols == 3);
+        CHECK(header.nativeLength == nativeLength);
+        CHECK(header.targetType == "t72_tank");
+        CHECK(header.polarization == polarization_types::HH);
+        CHECK_NEAR(header.azimuth, 47.25, 1e-12);
+        CHECK_NEAR(header.depression, 15.0, 1e-12);
+        CHECK_NEAR(header.centreFrequency, 9.6, 1e-12);
+        CHECK_NEAR(header.bandwidth, 0.591, 1e-12);
+    }
+}
+
+// A target chip decodes to the byte-swapped float32 magnitudes and phases mstar2raw gave.
+TEST_CASE(mstar, chip_matches_golden_pixels)
+{
+    const mstar_file file(write_chip("chip", 0));
+    CHECK(file.is_open());
+    CHECK(file.is_chip());
+    check_header(file.header(), 0);
+    CHECK(file.phoenix_text().size() == file.header().phoenixLength);
+
+    std::vector<double> magnitudes(6), phases(6);
+    CHECK(file.read_magnitude(magnitudes.data(), 6));
+    CHECK(file.read_phase(phases.data(), 6));
+    for (size_t i = 0; i < 6; i++)
+    {
+        CHECK(magnitudes[i] == chipMagnitudes[i]);
+        CHECK(phases[i] == chipPhases[i]);
+    }
+
+    // A read past the pixels is refused.
+    CHECK(!file.read_phase(phases.data(), 7));
+}
+
+// A full scene skips its native header and decodes the byte-swapped uint16 magnitudes and phases.
+TEST_CASE(mstar, full_scene_matches_golden_pixels)
+{
+    const mstar_file file(write_scene("scene"));
+    CHECK(file.is_open());
+    CHECK(!file.is_chip());
+    check_header(file.header(), 512);
+
+    std::vector<std::uint16_t> magnitudes(6), phases(6);
+    CHECK(file.read_magnitude(magnitudes.data(), 6));
+    CHECK(file.read_phase(phases.data(), 6));
+    CHECK(magnitudes == sceneMagnitudes);
+    CHECK(phases == scenePhases);
+}
+
+// The header-only read gives the same header as the mapped file, including past the first kilobyte.
+TEST_CASE(mstar, header_read_matches_mapped_header)
+{
+    for (const std::string& path : {write_chip("short_header", 0), write_chip("long_header", 3000), write_scene("scene_header")})
+    {
+        const mstar_file file(path);
+        phoenix_header header;
+        CHECK(read_phoenix_header(path, header));
+        CHECK(header.phoenixLength == file.header().phoenixLength);
+        check_header(header, file.header().nativeLength);
+    }
+
+    phoenix_header header;
+    CHECK(!read_phoenix_header(test_directory("mstar_file_missing") + "missing", header));
+    const std::string path = test_directory("mstar_file_not_mstar") + "not_mstar";
+    std::ofstream(path) << "NumberOfRows= 2\nNumberOfColumns= 3\n";
+    CHECK(!read_phoenix_header(path, header));
+}
+
+// A catalog built from a directory keeps its headers through save and load, and a query picks files by target and wrapping azimuth.
+TEST_CASE(mstar, catalog_round_trip_and_query)
+{
+    const std::string directory = test_directory("mstar_catalog");
+    write_chip(directory + "HB03333.015", 0, "t72_tank", "350.5");
+    write_chip(directory + "HB03334.015", 0, "bmp2_tank", "10.0");
+    write_chip(directory + "HB03335.015", 0, "t72_tank", "180.0");
+    std::ofstream(directory + "HB03336.015") << "not an MSTAR file\n";
+    std::ofstream(directory + "HB03333.JPG") << "skipped by name\n";
+
+    mstar_catalog built;
+    CHECK(built.build(directory));
+    CHECK(built.size() == 3);
+    const std::string catalogPath = test_directory("mstar_catalog_file") + "MSTAR.catalog";
+    CHECK(built.save(catalogPath));
+
+    mstar_catalog catalog;
+    CHECK(catalog.load(catalogPath));
+    CHECK(catalog.size() == 3);
+    for (size_t i = 0; i < catalog.size() && catalog.size() == built.size(); i++)
+    {
+        CHECK(catalog.path(i) == built.path(i));
+        CHECK(catalog.header(i).targetType == built.header(i).targetType);
+        CHECK(catalog.header(i).azimuth == built.header(i).azimuth);
+        CHECK_NEAR(catalog.header(i).centreFrequency, 9.6, 1e-12);
+        CHECK(catalog.header(i).polarization == polarization_types::HH);
+    }
+
+    mstar_query query;
+    CHECK(catalog.find(query) == (std::vector<size_t>{0, 1, 2}));
+    query.targetTypes = {"t72_tank"};
+    CHECK(catalog.find(query) == (std::vector<size_t>{0, 2}));
+    query.minAzimuth = 340;
+    query.maxAzimuth = 20;
+    CHECK(catalog.select(query) == std::vector<std::string>{directory + "HB03333.015"});
+    query.targetTypes.clear();
+    CHECK(catalog.find(query) == (std::vector<size_t>{0, 1}));
+    query.minDepression = 16;
+    CHECK(catalog.find(query).empty());
+}
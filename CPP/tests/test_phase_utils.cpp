@@ -0,0 +1,100 @@
+#include <armadillo>
+
+#include "test_framework.h"
+#include "../src/algs/sample_corr_bp.h"
+#include "../src/utils/matrix_math.h"
+#include "../src/utils/phase_utils.h"
+#include "../src/utils/stopwatch.h"
+
+namespace
+{
+    // Differential range of a planar wavefront over a transposed mesh grid, affine down every column as the imagers' grids are.
+    arma::mat planar_range(const arma::uword rows, const arma::uword cols, const double azimuth, const double elevation)
+    {
+        arma::mat xGrid;
+        arma::mat yGrid;
+        mesh_grid(xGrid, yGrid, arma::linspace(-20, 20, cols), arma::linspace(-15, 15, rows));
+        return (std::cos(elevation) * std::cos(azimuth)) * xGrid.t() + (std::cos(elevation) * std::sin(azimuth)) * yGrid.t();
+    }
+
+    arma::cx_vec exact_phase(const double wavenumber, const arma::vec& range)
+    {
+        arma::cx_vec output(range.n_elem);
+        phase_exact<double>(wavenumber, range.memptr(), reinterpret_cast<double*>(output.memptr()), range.n_elem);
+        return output;
+    }
+}
+
+// The recurrence stays within its error bound of the exact phase on the gated pixels it is asked for.
+TEST_CASE(phase, recurrence_within_error_bound)
+{
+    arma::arma_rng::set_seed(5);
+    const double wavenumber = 4.0 * 9.6e9 * 3.14159265358979 / 299792458.0;
+    for (const double azimuth : {0.1, 0.9, 2.5})
+    {
+        const arma::mat dR = planar_range(200, 150, azimuth, 0.5);
+        const phase_corrector corrector(phase_correction_modes::RECURRENCE, wavenumber, dR.n_rows, column_affine_residual(dR),
+            arma::abs(dR).max(), 1e-6);
+        CHECK(corrector.mode == phase_correction_modes::RECURRENCE);
+        CHECK(corrector.anchorInterval > 1);
+        CHECK(corrector.errorBound <= 1e-6);
+
+        const arma::uvec index = arma::find(arma::randu<arma::mat>(dR.n_rows, dR.n_cols) > 0.3);
+        const arma::vec validDR = dR.elem(index);
+        const arma::cx_vec recurrence = corrector.evaluate(wavenumber, dR, index, validDR);
+        CHECK(recurrence.n_elem == index.n_elem);
+        CHECK(arma::abs(arma::arg(recurrence % arma::conj(exact_phase(wavenumber, validDR)))).max() <= corrector.errorBound);
+    }
+}
+
+TEST_CASE(phase, non_affine_grid_falls_back_to_exact)
+{
+    arma::mat dR = planar_range(64, 64, 0.3, 0.5);
+    dR += 1e-3 * arma::square(dR);
+    const phase_corrector corrector(phase_correction_modes::RECURRENCE, 400, dR.n_rows, column_affine_residual(dR), arma::abs(dR).max(), 1e-6);
+    CHECK(corrector.mode == phase_correction_modes::EXACT);
+}
+
+TEST_CASE(phase, imagers_default_to_exact)
+{
+    const sample_corr_bp imager("synthetic");
+    CHECK(imager.phaseCorrectionMode == phase_correction_modes::EXACT);
+}
+
+// Prints the time and the largest phase error of each mode over the pulses of a 512 x 512 grid with most pixels gated in.
+TEST_CASE(phase, timing)
+{
+    arma::arma_rng::set_seed(6);
+    const double wavenumber = 4.0 * 9.6e9 * 3.14159265358979 / 299792458.0;
+    const int pulses = 64;
+    const arma::vec azimuths = arma::linspace(0, 0.1, pulses);
+    std::vector<arma::mat> ranges;
+    std::vector<arma::uvec> indices;
+    for (int p = 0; p < pulses; p++)
+    {
+        ranges.push_back(planar_range(512, 512, azimuths(p), 0.5));
+        indices.push_back(arma::find(arma::randu<arma::mat>(512, 512) > 0.1));
+    }
+
+    const phase_corrector exact(phase_correction_modes::EXACT);
+    const phase_corrector recurrence(phase_correction_modes::RECURRENCE, wavenumber, 512, column_affine_residual(ranges[0]),
+        arma::abs(ranges[0]).max(), 1e-6);
+    long long microseconds[2] = {0, 0};
+    double maxError = 0;
+    for (int p = 0; p < pulses; p++)
+    {
+        const arma::vec validDR = ranges[p].elem(indices[p]);
+        stopwatch timer;
+        const arma::cx_vec exactPhase = exact.evaluate(wavenumber, ranges[p], indices[p], validDR);
+        microseconds[0] += timer.elapsed_microseconds();
+        timer.restart();
+        const arma::cx_vec recurrencePhase = recurrence.evaluate(wavenumber, ranges[p], indices[p], validDR);
+        microseconds[1] += timer.elapsed_microseconds();
+        maxError = std::max(maxError, arma::abs(arma::arg(recurrencePhase % arma::conj(exactPhase))).max());
+    }
+
+    CHECK(maxError <= recurrence.errorBound);
+    std::cout << "[Timing] phase correction of " << pulses << " pulses over 512 x 512 pixels" << std::endl;
+    std::cout << "    exact: " << microseconds[0] << " us, recurrence: " << microseconds[1] << " us (anchor interval "
+        << recurrence.anchorInterval << "), largest phase error " << maxError << " rad, bound " << recurrence.errorBound << std::endl;
+}
@@ -0,0 +1,245 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "test_framework.h"
+#include "../src/utils/pipeline_utils.h"
+#include "../src/utils/run_manifest.h"
+
+namespace
+{
+    // Stands in for an imager whose load() fills in a setting from its input, as target_cp_corr_bp's once did with sceneSize.
+    struct file_imager
+    {
+        std::string dataPath;
+
+        std::string setting = "unset";
+
+        explicit file_imager(const std::string& dataPath) : dataPath(dataPath)
+        {
+        }
+
+        static int& loads()
+        {
+            static int count = 0;
+            return count;
+        }
+
+        int load()
+        {
+            loads()++;
+            std::ifstream stream(dataPath);
+            return std::getline(stream, setting) ? 0 : -1;
+        }
+
+        int get_image_data()
+        {
+            return 0;
+        }
+
+        std::string parameter_string() const
+        {
+            return "setting=" + setting;
+        }
+    };
+
+    // One batch run over every input, with a fresh manifest read back from manifestPath as a new process would; returns the failed indices.
+    std::vector<int> run_all(const std::vector<std::string>& inputPaths, const std::string& manifestPath, const std::string& outputPath)
+    {
+        run_manifest manifest(manifestPath);
+        int nextIndex = 0;
+        std::vector<int> failed;
+        pipelined_run(inputPaths,
+            [&nextIndex, &inputPaths](int& index)
+            {
+                index = nextIndex++;
+                return index < static_cast<int>(inputPaths.size());
+            },
+            [](const std::string& path)
+            {
+                return std::make_unique<file_imager>(path);
+            },
+            [](file_imager& imager, const std::string&)
+            {
+                return imager.load() == 0;
+            },
+            [&outputPath](const file_imager& imager, const std::string& path, const auto& saved)
+            {
+                const std::string output = outputPath + std::filesystem::path(path).stem().string() + ".out";
+                std::ofstream(output) << imager.setting;
+                saved(true, {output});
+            },
+            []
+            {
+            },
+            [&failed](const int index, const bool succeeded)
+            {
+                if (!succeeded)
+                {
+                    failed.push_back(index);
+                }
+            },
+            &manifest, "file_imager");
+        return failed;
+    }
+}
+
+// A recorded input is skipped on the next run even though load() changes its parameter string; inputs that failed or changed are imaged again.
+TEST_CASE(pipeline, manifest_skips_recorded_inputs)
+{
+    const std::string directory = test_directory("pipeline_manifest");
+    const std::vector<std::string> inputPaths = {directory + "first.txt", directory + "second.txt", directory + "missing.txt"};
+    std::ofstream(inputPaths[0]) << "10";
+    std::ofstream(inputPaths[1]) << "20";
+    const std::string manifestPath = directory + "run_manifest.tsv";
+
+    file_imager::loads() = 0;
+    CHECK(run_all(inputPaths, manifestPath, directory) == std::vector<int>{2});
+    CHECK(file_imager::loads() == 3);
+    CHECK(std::filesystem::exists(directory + "first.out"));
+    CHECK(!std::filesystem::exists(directory + "missing.out"));
+
+    file_imager::loads() = 0;
+    CHECK(run_all(inputPaths, manifestPath, directory) == std::vector<int>{2});
+    CHECK(file_imager::loads() == 1);
+
+    std::ofstream(inputPaths[0]) << "100";
+    file_imager::loads() = 0;
+    CHECK(run_all(inputPaths, manifestPath, directory) == std::vector<int>{2});
+    CHECK(file_imager::loads() == 2);
+}
+
+// An input whose load, image formation or save throws fails on its own; the run carries on and ends normally.
+TEST_CASE(pipeline, throwing_stages_fail_their_inputs)
+{
+    struct throwing_imager
+    {
+        std::string dataPath;
+
+        int get_image_data()
+        {
+            if (dataPath == "image")
+            {
+                throw std::runtime_error("image formation");
+            }
+            return 0;
+        }
+
+        std::string parameter_string() const
+        {
+            return "";
+        }
+    };
+
+    const std::vector<std::string> inputPaths = {"load", "image", "save", "good", "create"};
+    int nextIndex = 0;
+    std::vector<int> failed;
+    std::vector<int> succeeded;
+    pipelined_run(inputPaths,
+        [&nextIndex, &inputPaths](int& index)
+        {
+            index = nextIndex++;
+            return index < static_cast<int>(inputPaths.size());
+        },
+        [](const std::string& path)
+        {
+            if (path == "create")
+            {
+                throw std::runtime_error("create");
+            }
+            return std::make_unique<throwing_imager>(throwing_imager{path});
+        },
+        [](throwing_imager&, const std::string& path)
+        {
+            if (path == "load")
+            {
+                throw std::runtime_error("load");
+            }
+            return true;
+        },
+        [](const throwing_imager&, const std::string& path, const auto& saved)
+        {
+            if (path == "save")
+            {
+                throw std::runtime_error("save");
+            }
+            saved(true, {});
+        },
+        []
+        {
+        },
+        [&failed, &succeeded](const int index, const bool done)
+        {
+            (done ? succeeded : failed).push_back(index);
+        });
+    std::sort(failed.begin(), failed.end());
+    CHECK(failed == (std::vector<int>{0, 1, 2, 4}));
+    CHECK(succeeded == std::vector<int>{3});
+}
+
+// A consolidated run finishes an input only once the sink has flushed its image, and a later run skips what is in the sink.
+TEST_CASE(pipeline, consolidated_runs_resume)
+{
+    struct sink_imager
+    {
+        std::string dataPath;
+
+        arma::mat image = arma::mat(4, 3, arma::fill::randu);
+
+        int load()
+        {
+            file_imager::loads()++;
+            return std::filesystem::exists(dataPath) ? 0 : -1;
+        }
+
+        int get_image_data()
+        {
+            return 0;
+        }
+
+        std::string parameter_string() const
+        {
+            return "";
+        }
+    };
+
+    const std::string directory = test_directory("pipeline_consolidated");
+    std::vector<std::string> inputPaths;
+    for (const std::string name : {"first", "second", "third"})
+    {
+        inputPaths.push_back(directory + name + ".txt");
+        std::ofstream(inputPaths.back()) << name;
+    }
+
+    const auto run = [&]
+    {
+        return batch_run(inputPaths, 0, static_cast<int>(inputPaths.size()),
+            [](const std::string& path)
+            {
+                return std::make_unique<sink_imager>(sink_imager{path});
+            },
+            [](const sink_imager& imager, const auto& write)
+            {
+                write("image", "", imager.image);
+            },
+            directory + "output", "sink_imager", output_modes::CONSOLIDATED, output_encodings::NATIVE);
+    };
+
+    file_imager::loads() = 0;
+    CHECK(run().empty());
+    CHECK(file_imager::loads() == 3);
+    CHECK(std::filesystem::exists(directory + "output/images.hdf5"));
+
+    file_imager::loads() = 0;
+    CHECK(run().empty());
+    CHECK(file_imager::loads() == 0);
+
+    std::ofstream(inputPaths[1]) << "changed";
+    file_imager::loads() = 0;
+    CHECK(run().empty());
+    CHECK(file_imager::loads() == 1);
+}
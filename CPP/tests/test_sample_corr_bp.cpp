@@ -0,0 +1,50 @@
+#include <armadillo>
+
+#include "test_framework.h"
+#include "../src/algs/sample_corr_bp.h"
+#include "../src/utils/matrix_math.h"
+
+namespace
+{
+    // A 24 x 20 pixel flat scene, 10 m across, seen by 48 pulses over 3 degrees of azimuth with random phase history.
+    sample_corr_bp synthetic_scene()
+    {
+        arma::arma_rng::set_seed(7);
+        sample_corr_bp imager("synthetic", true);
+        imager.numXSamples = 24;
+        imager.numYSamples = 20;
+        imager.frequencyStepSize = 1e6;
+        imager.freqMin = 9.6e9;
+        mesh_grid(imager.pixelX, imager.pixelY, arma::linspace(-5, 5, imager.numXSamples), arma::linspace(-4, 4, imager.numYSamples));
+        imager.pixelZ = arma::mat(imager.numXSamples, imager.numYSamples, arma::fill::zeros);
+        imager.antAzim = arma::linspace(0, 3, 48);
+        imager.antElev = arma::vec(48).fill(30);
+        imager.phase = arma::randn<arma::cx_mat>(64, 48);
+        return imager;
+    }
+}
+
+// The closed-form STREAMING correlated image against the original per-pixel FFT autocorrelation of the BUFFERED mode,
+// under both phase correction modes.
+TEST_CASE(correlation, streaming_matches_buffered)
+{
+    sample_corr_bp imager = synthetic_scene();
+    imager.set_phase_correction(phase_correction_modes::RECURRENCE);
+    CHECK(sample_corr_bp::correlation_mode_error(imager) < 1e-9);
+
+    imager.set_phase_correction(phase_correction_modes::EXACT);
+    CHECK(sample_corr_bp::correlation_mode_error(imager) < 1e-9);
+}
+
+// Both modes form the same uncorrelated image.
+TEST_CASE(correlation, modes_share_the_image)
+{
+    sample_corr_bp streaming = synthetic_scene();
+    streaming.correlationMode = correlation_modes::STREAMING;
+    streaming.get_image_data();
+    sample_corr_bp buffered = synthetic_scene();
+    buffered.correlationMode = correlation_modes::BUFFERED;
+    buffered.get_image_data();
+    CHECK(arma::norm(arma::vectorise(streaming.finalImage)) > 0);
+    CHECK(arma::norm(arma::vectorise(streaming.finalImage - buffered.finalImage)) <= 1e-9 * arma::norm(arma::vectorise(buffered.finalImage)));
+}
@@ -0,0 +1,68 @@
+#include <armadillo>
+#include <cmath>
+
+#include "test_framework.h"
+#include "../src/constants.h"
+#include "../src/algs/target_cp_omega_k.h"
+
+namespace
+{
+    // Point targets in a 24 x 24 pixel scene, 10 m across, seen from a straight track 1 km away and 400 m up: 128 pulses
+    // 0.25 m apart, 64 frequencies from 9.6 GHz in 5 MHz steps, motion compensated to the scene centre.
+    target_cp_omega_k straight_track()
+    {
+        const int pulseCount = 128;
+        const int frequencyCount = 64;
+        target_cp_omega_k imager("straight track", 4, 24, 24, 0, 0, false);
+        imager.sceneSize = 10;
+        imager.antX = arma::mat(pulseCount, 1, arma::fill::value(1000));
+        imager.antY = (arma::regspace<arma::mat>(0, pulseCount - 1) - (pulseCount - 1) / 2.0) * 0.25;
+        imager.antZ = arma::mat(pulseCount, 1, arma::fill::value(400));
+        imager.radius = arma::sqrt(arma::square(imager.antX) + arma::square(imager.antY) + arma::square(imager.antZ));
+        imager.azim = arma::mat(pulseCount, 1);
+        for (int p = 0; p < pulseCount; p++)
+        {
+            imager.azim(p) = std::fmod(std::atan2(imager.antY(p), imager.antX(p)) / radian + 360, 360);
+        }
+        imager.frequencyGHz = 9.6 + arma::regspace<arma::mat>(0, frequencyCount - 1) * 5e-3;
+
+        const double targets[][3] = {{2, -1, 1}, {-3, 2, 0.7}};
+        imager.phase = arma::cx_mat(frequencyCount, pulseCount, arma::fill::zeros);
+        for (int p = 0; p < pulseCount; p++)
+        {
+            for (const auto& target : targets)
+            {
+                const double differentialRange = std::sqrt(std::pow(imager.antX(p) - target[0], 2) + std::pow(imager.antY(p) - target[1], 2)
+                    + std::pow(imager.antZ(p), 2)) - imager.radius(p);
+                for (int k = 0; k < frequencyCount; k++)
+                {
+                    const double wavenumber = 4 * pi * imager.frequencyGHz(k) * 1e9 / c;
+                    imager.phase(k, p) += target[2] * std::polar(1.0, -wavenumber * differentialRange);
+                }
+            }
+        }
+        return imager;
+    }
+}
+
+// Omega-k forms the real image back-projection does, with the same amplitude and phase reference.
+TEST_CASE(omega_k, matches_back_projection)
+{
+    const target_cp_omega_k::back_projection_comparison comparison = target_cp_omega_k::compare_with_back_projection(straight_track());
+    CHECK(comparison.peaksAgree);
+    CHECK(comparison.correlation > 0.98);
+    CHECK(comparison.relativeError < 0.2);
+}
+
+// A track bent by more than the tolerance is refused, and the power image is kept apart from the correlated image.
+TEST_CASE(omega_k, rejects_curved_tracks)
+{
+    target_cp_omega_k imager = straight_track();
+    imager.correlated = true;
+    CHECK(imager.get_image_data() == 0);
+    CHECK(imager.powerImageData.n_elem == imager.imageData.n_elem);
+    CHECK(imager.correlatedImageData.is_empty());
+
+    imager.antX(imager.antX.n_elem / 2) += 1;
+    CHECK(imager.get_image_data() != 0);
+}
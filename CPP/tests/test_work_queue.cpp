@@ -0,0 +1,98 @@
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "test_framework.h"
+#include "../src/utils/work_queue.h"
+
+namespace
+{
+    std::string read_file(const std::string& path)
+    {
+        std::ifstream stream(path);
+        std::ostringstream contents;
+        contents << stream.rdbuf();
+        return contents.str();
+    }
+}
+
+// Inputs are handed out largest first in batches, completed or released by path, and every change is appended.
+TEST_CASE(queue, claims_completes_and_releases_by_path)
+{
+    const std::string directory = test_directory("work_queue");
+    const std::vector<std::string> inputPaths = {directory + "small.dat", directory + "large.dat", directory + "medium.dat"};
+    std::ofstream(inputPaths[0]) << "1";
+    std::ofstream(inputPaths[1]) << "12345";
+    std::ofstream(inputPaths[2]) << "123";
+    const std::string queuePath = directory + "inputs.queue";
+
+    work_queue queue(queuePath, inputPaths);
+    std::vector<std::string> batch;
+    CHECK(queue.claim(batch, 2));
+    CHECK(batch == (std::vector<std::string>{inputPaths[1], inputPaths[2]}));
+    CHECK(!queue.complete(inputPaths[0]));
+
+    const std::string claimedLog = read_file(queuePath);
+    CHECK(queue.complete(inputPaths[1]));
+    CHECK(queue.release(inputPaths[2]));
+    CHECK(!queue.complete(inputPaths[2]));
+    const std::string finishedLog = read_file(queuePath);
+    CHECK(finishedLog.compare(0, claimedLog.size(), claimedLog) == 0);
+
+    // The released input is left to other workers.
+    CHECK(queue.claim(batch, 2));
+    CHECK(batch == std::vector<std::string>{inputPaths[0]});
+    CHECK(queue.complete(inputPaths[0]));
+    CHECK(!queue.claim(batch, 2));
+    CHECK(batch.empty());
+
+    work_queue other(queuePath, inputPaths);
+    CHECK(other.claim(batch, 2));
+    CHECK(batch == std::vector<std::string>{inputPaths[2]});
+    CHECK(other.complete(inputPaths[2]));
+    CHECK(!other.claim(batch, 2));
+}
+
+// A queue made for another input list hands nothing out.
+TEST_CASE(queue, refuses_other_inputs)
+{
+    const std::string directory = test_directory("work_queue_inputs");
+    const std::string queuePath = directory + "inputs.queue";
+    {
+        work_queue queue(queuePath, {directory + "first.dat", directory + "second.dat"});
+    }
+
+    work_queue queue(queuePath, {directory + "first.dat", directory + "third.dat"});
+    std::vector<std::string> batch;
+    CHECK(!queue.claim(batch, 2));
+}
+
+// Each queue sees the lines the others append after its last read, and a line only counts once it is whole.
+TEST_CASE(queue, replays_appended_lines)
+{
+    const std::string directory = test_directory("work_queue_tail");
+    const std::vector<std::string> inputPaths = {directory + "small.dat", directory + "large.dat", directory + "medium.dat"};
+    std::ofstream(inputPaths[0]) << "1";
+    std::ofstream(inputPaths[1]) << "12345";
+    std::ofstream(inputPaths[2]) << "123";
+    const std::string queuePath = directory + "inputs.queue";
+
+    work_queue first(queuePath, inputPaths);
+    work_queue second(queuePath, inputPaths);
+    std::vector<std::string> batch;
+    CHECK(first.claim(batch));
+    CHECK(batch == std::vector<std::string>{inputPaths[1]});
+    CHECK(second.claim(batch));
+    CHECK(batch == std::vector<std::string>{inputPaths[2]});
+    CHECK(first.claim(batch));
+    CHECK(batch == std::vector<std::string>{inputPaths[0]});
+    CHECK(!first.claim(batch));
+
+    std::ofstream(queuePath, std::ios::app) << "R 1 ";
+    CHECK(!first.claim(batch));
+    std::ofstream(queuePath, std::ios::app) << inputPaths[2] << "\n";
+    CHECK(first.claim(batch));
+    CHECK(batch == std::vector<std::string>{inputPaths[2]});
+}